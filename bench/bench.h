@@ -0,0 +1,196 @@
+/**
+ * \file bench.h
+ *
+ * \brief Common benchmarking definitions, structures, and functions.
+ *
+ * End users shouldn't need to consume anything from this file, but library
+ * developers will want to consult it when adding benchmarks.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_BENCH_H
+#define LIBRBR_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Required for printf. */
+#include <stdio.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+/* Required for memcpy, strlen. */
+#include <string.h>
+
+#include "RBRInstrument.h"
+#include "RBRBinner.h"
+#include "RBRCastDetector.h"
+#include "RBRDownsampler.h"
+#include "RBRStatistics.h"
+#include "RBRParser.h"
+
+/**
+ * \brief A single benchmark.
+ *
+ * The harness calls `run` with increasing iteration counts until one call
+ * takes long enough to time reliably, then reports the time taken per
+ * iteration (“operation”).
+ */
+typedef struct Benchmark
+{
+    /** \brief The name reported in benchmark output. */
+    const char *name;
+    /**
+     * \brief A benchmark-specific parameter; e.g., a channel count.
+     *
+     * Lets one set of functions be registered several times.
+     */
+    int32_t parameter;
+    /**
+     * \brief Prepare benchmark state before timing begins.
+     *
+     * Optional. Should set Benchmark.bytes if throughput is meaningful.
+     * Returning false skips the benchmark.
+     */
+    bool (*setup)(struct Benchmark *benchmark);
+    /** \brief Perform the benchmarked operation \a iterations times. */
+    void (*run)(struct Benchmark *benchmark, int64_t iterations);
+    /** \brief Release benchmark state. Optional. */
+    void (*teardown)(struct Benchmark *benchmark);
+    /** \brief The number of bytes processed by each operation, or 0. */
+    int64_t bytes;
+    /** \brief Arbitrary state for use by the benchmark functions. */
+    void *state;
+} Benchmark;
+
+/**
+ * \brief Somewhere for benchmarks to put results so the compiler can't
+ * discard the work which produced them.
+ */
+extern volatile int64_t benchSink;
+
+/**
+ * \brief Open an instrument whose reads cycle endlessly through a buffer.
+ *
+ * The instrument is first fed \a preamble (enough to get through
+ * RBRInstrument_open()), then \a data over and over. Writes are discarded.
+ * Samples are delivered to \a sample, if given.
+ *
+ * \param [out] instrument the opened instrument
+ * \param [in] preamble data to be read once before \a data
+ * \param [in] data data to be read repeatedly
+ * \param [in] sample called for each sample parsed, or `NULL`
+ * \return #RBRINSTRUMENT_SUCCESS if the instrument was opened
+ */
+RBRInstrumentError BenchInstrument_open(RBRInstrument **instrument,
+                                        const char *preamble,
+                                        const char *data,
+                                        RBRInstrumentSampleCallback sample);
+
+/**
+ * \brief Close an instrument opened by BenchInstrument_open().
+ *
+ * \param [in] instrument the instrument
+ */
+void BenchInstrument_close(RBRInstrument *instrument);
+
+/** \brief The number of synthetic samples pushed by each operation. */
+#define BENCH_SAMPLES 1024
+
+/**
+ * \brief Fill in the channels and readings of a synthetic sample.
+ *
+ * \param [in] index the zero-based index of the sample
+ * \param [out] sample the sample, with its timestamp already set
+ */
+typedef void (*BenchSampleGenerator)(int32_t index,
+                                     RBRInstrumentSample *sample);
+
+/**
+ * \brief State for benchmarks which push synthetic samples into an object.
+ */
+typedef struct BenchSamples
+{
+    /** \brief The object being benchmarked; e.g., an RBRBinner. */
+    void *object;
+    /** \brief The samples pushed by each operation. */
+    RBRInstrumentSample samples[BENCH_SAMPLES];
+} BenchSamples;
+
+/**
+ * \brief Set up a BenchSamples as the benchmark state.
+ *
+ * The samples are timestamped as though taken at 16Hz, and \a generate fills
+ * in the rest. The benchmark then only has to set BenchSamples.object.
+ *
+ * \param [in,out] benchmark the benchmark
+ * \param [in] generate fills in each sample
+ * \return true if the state was allocated
+ */
+bool BenchSamples_setup(Benchmark *benchmark, BenchSampleGenerator generate);
+
+/**
+ * \brief Release a BenchSamples set up by BenchSamples_setup().
+ *
+ * The object being benchmarked must be released by the caller.
+ *
+ * \param [in,out] benchmark the benchmark
+ */
+void BenchSamples_teardown(Benchmark *benchmark);
+
+bool bench_parseResponse_setup(Benchmark *benchmark);
+void bench_parseResponse_run(Benchmark *benchmark, int64_t iterations);
+void bench_parseResponse_teardown(Benchmark *benchmark);
+
+bool bench_readSample_setup(Benchmark *benchmark);
+void bench_readSample_run(Benchmark *benchmark, int64_t iterations);
+void bench_readSample_teardown(Benchmark *benchmark);
+
+bool bench_crc_setup(Benchmark *benchmark);
+void bench_crc_run(Benchmark *benchmark, int64_t iterations);
+void bench_crc_teardown(Benchmark *benchmark);
+
+bool bench_parseSampleTime_setup(Benchmark *benchmark);
+void bench_parseSampleTime_run(Benchmark *benchmark, int64_t iterations);
+
+bool bench_parseScheduleTime_setup(Benchmark *benchmark);
+void bench_parseScheduleTime_run(Benchmark *benchmark, int64_t iterations);
+
+void bench_toSampleTime_run(Benchmark *benchmark, int64_t iterations);
+
+void bench_toScheduleTime_run(Benchmark *benchmark, int64_t iterations);
+
+bool bench_parseEasyParse_setup(Benchmark *benchmark);
+void bench_parseEasyParse_run(Benchmark *benchmark, int64_t iterations);
+void bench_parseEasyParse_teardown(Benchmark *benchmark);
+
+bool bench_parseSelected_setup(Benchmark *benchmark);
+
+void bench_parseColumns_run(Benchmark *benchmark, int64_t iterations);
+
+void bench_parseNext_run(Benchmark *benchmark, int64_t iterations);
+
+bool bench_bin_setup(Benchmark *benchmark);
+void bench_bin_run(Benchmark *benchmark, int64_t iterations);
+void bench_bin_teardown(Benchmark *benchmark);
+
+bool bench_cast_setup(Benchmark *benchmark);
+void bench_cast_run(Benchmark *benchmark, int64_t iterations);
+void bench_cast_teardown(Benchmark *benchmark);
+
+bool bench_downsample_setup(Benchmark *benchmark);
+void bench_downsample_run(Benchmark *benchmark, int64_t iterations);
+void bench_downsample_teardown(Benchmark *benchmark);
+
+bool bench_statistics_setup(Benchmark *benchmark);
+void bench_statistics_run(Benchmark *benchmark, int64_t iterations);
+void bench_statistics_teardown(Benchmark *benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_BENCH_H */
@@ -0,0 +1,121 @@
+/**
+ * \file binner.c
+ *
+ * \brief Benchmarks for host-side binning.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+
+static RBRInstrumentError bench_bin_bin(
+    const struct RBRBinner *binner,
+    const struct RBRInstrumentSample *const bin)
+{
+    /* Unused. */
+    (void) binner;
+
+    benchSink += bin->timestamp;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Synthesizes a CTD profiling at 16Hz from the surface to 100dbar. */
+static void bench_bin_sample(int32_t i, RBRInstrumentSample *sample)
+{
+    sample->channels = 3;
+    sample->readings[0] = 40.0 + (i % 17) * 0.01;
+    sample->readings[1] = 12.0 - i * 0.005;
+    sample->readings[2] = i * 100.0 / BENCH_SAMPLES;
+}
+
+bool bench_bin_setup(Benchmark *benchmark)
+{
+    if (!BenchSamples_setup(benchmark, bench_bin_sample))
+    {
+        return false;
+    }
+
+    /* Bin by time when the parameter is 0, or by depth otherwise. */
+    RBRBinnerConfig config = {
+        .postprocessing = {
+            .channels = {
+                .count = 5,
+                .channels = {
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_MEAN,
+                        .label = "conductivity_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_STD,
+                        .label = "conductivity_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_MEAN,
+                        .label = "temperature_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_STD,
+                        .label = "temperature_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_SAMPLE_COUNT,
+                        .label = "pressure_00"
+                    }
+                }
+            },
+            .binReference = "tstamp",
+            .binFilter = RBRINSTRUMENT_POSTPROCESSING_BINFILTER_NONE,
+            .binSize = 1000.0,
+            .tstampMin = RBRINSTRUMENT_DATETIME_MIN,
+            .tstampMax = RBRINSTRUMENT_DATETIME_MAX,
+            .depthMin = 0.0,
+            .depthMax = 100.0
+        },
+        .channels = 3,
+        .labels = {"conductivity_00", "temperature_00", "pressure_00"},
+        .bin = bench_bin_bin
+    };
+    if (benchmark->parameter != 0)
+    {
+        strcpy(config.postprocessing.binReference, "pressure_00");
+        config.postprocessing.binSize = 1.0;
+    }
+    RBRBinner *binner = NULL;
+    if (RBRBinner_init(&binner, &config, NULL, NULL) != RBRINSTRUMENT_SUCCESS)
+    {
+        BenchSamples_teardown(benchmark);
+        return false;
+    }
+
+    ((BenchSamples *) benchmark->state)->object = binner;
+    return true;
+}
+
+void bench_bin_run(Benchmark *benchmark, int64_t iterations)
+{
+    BenchSamples *state = benchmark->state;
+    RBRBinner *binner = state->object;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        for (int32_t j = 0; j < BENCH_SAMPLES; j++)
+        {
+            RBRBinner_push(binner, &state->samples[j]);
+        }
+        RBRBinner_flush(binner);
+    }
+}
+
+void bench_bin_teardown(Benchmark *benchmark)
+{
+    BenchSamples *state = benchmark->state;
+    RBRBinner_destroy(state->object);
+    BenchSamples_teardown(benchmark);
+}
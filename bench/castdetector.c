@@ -0,0 +1,98 @@
+/**
+ * \file castdetector.c
+ *
+ * \brief Benchmarks for host-side cast detection.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+
+static RBRInstrumentError bench_cast_event(
+    const struct RBRCastDetector *detector,
+    const struct RBRInstrumentEvent *const event)
+{
+    /* Unused. */
+    (void) detector;
+
+    benchSink += event->timestamp;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Synthesizes a CTD at 16Hz yo-yoing between the surface and 32dbar, with a
+ * hold at each end. */
+static void bench_cast_sample(int32_t i, RBRInstrumentSample *sample)
+{
+    int32_t phase = i % 256;
+    double pressure;
+    if (phase < 64)
+    {
+        pressure = 0.0;
+    }
+    else if (phase < 128)
+    {
+        pressure = (phase - 64) * 0.5;
+    }
+    else if (phase < 192)
+    {
+        pressure = 32.0;
+    }
+    else
+    {
+        pressure = (256 - phase) * 0.5;
+    }
+    sample->channels = 3;
+    sample->readings[0] = 40.0 + (i % 17) * 0.01;
+    sample->readings[1] = 12.0 - i * 0.005;
+    sample->readings[2] = pressure + (i % 3) * 0.01;
+}
+
+bool bench_cast_setup(Benchmark *benchmark)
+{
+    if (!BenchSamples_setup(benchmark, bench_cast_sample))
+    {
+        return false;
+    }
+
+    RBRCastDetectorConfig config = {
+        .channel = 2,
+        .castThreshold = 2.0,
+        .soakThreshold = 0.2,
+        .soakDuration = 2000,
+        .event = bench_cast_event
+    };
+    RBRCastDetector *detector = NULL;
+    if (RBRCastDetector_init(&detector, &config, NULL)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        BenchSamples_teardown(benchmark);
+        return false;
+    }
+
+    ((BenchSamples *) benchmark->state)->object = detector;
+    return true;
+}
+
+void bench_cast_run(Benchmark *benchmark, int64_t iterations)
+{
+    BenchSamples *state = benchmark->state;
+    RBRCastDetector *detector = state->object;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        for (int32_t j = 0; j < BENCH_SAMPLES; j++)
+        {
+            RBRCastDetector_push(detector, &state->samples[j]);
+        }
+        RBRCastDetector_flush(detector);
+    }
+}
+
+void bench_cast_teardown(Benchmark *benchmark)
+{
+    BenchSamples *state = benchmark->state;
+    RBRCastDetector_destroy(state->object);
+    BenchSamples_teardown(benchmark);
+}
@@ -0,0 +1,78 @@
+/**
+ * \file downsampler.c
+ *
+ * \brief Benchmarks for downsampling.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+
+/** \brief The number of channels in each sample. */
+#define BENCH_DOWNSAMPLE_CHANNELS 4
+/** \brief The number of points kept for each channel. */
+#define BENCH_DOWNSAMPLE_CAPACITY 512
+
+/* Synthesizes a deployment sampling at 16Hz. */
+static void bench_downsample_sample(int32_t i, RBRInstrumentSample *sample)
+{
+    sample->channels = BENCH_DOWNSAMPLE_CHANNELS;
+    for (int32_t channel = 0; channel < sample->channels; channel++)
+    {
+        sample->readings[channel] = channel * 10.0 + (i % 37) * 0.25;
+    }
+}
+
+bool bench_downsample_setup(Benchmark *benchmark)
+{
+    if (!BenchSamples_setup(benchmark, bench_downsample_sample))
+    {
+        return false;
+    }
+
+    RBRDownsamplerConfig config = {
+        .method = (RBRDownsamplerMethod) benchmark->parameter,
+        .channels = BENCH_DOWNSAMPLE_CHANNELS,
+        .capacity = BENCH_DOWNSAMPLE_CAPACITY,
+        .bucketSize = 1
+    };
+    RBRDownsampler *downsampler = NULL;
+    if (RBRDownsampler_init(&downsampler, &config, NULL, NULL)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        BenchSamples_teardown(benchmark);
+        return false;
+    }
+
+    ((BenchSamples *) benchmark->state)->object = downsampler;
+    return true;
+}
+
+void bench_downsample_run(Benchmark *benchmark, int64_t iterations)
+{
+    BenchSamples *state = benchmark->state;
+    RBRDownsampler *downsampler = state->object;
+
+    /* The same downsampler is used throughout, so most iterations measure
+     * the steady state of buckets which have long since grown large. */
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        for (int32_t j = 0; j < BENCH_SAMPLES; j++)
+        {
+            RBRDownsampler_push(downsampler, &state->samples[j]);
+        }
+    }
+
+    int32_t length;
+    RBRDownsampler_getPoints(downsampler, 0, &length);
+    benchSink += length;
+}
+
+void bench_downsample_teardown(Benchmark *benchmark)
+{
+    BenchSamples *state = benchmark->state;
+    RBRDownsampler_destroy(state->object);
+    BenchSamples_teardown(benchmark);
+}
@@ -0,0 +1,269 @@
+/**
+ * \file instrument.c
+ *
+ * \brief Benchmarks for instrument communication hot paths.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+#include "RBRInstrumentInternal.h"
+
+/* Responses taken from the Logger3 channels test. */
+static const char *responses[] = {
+    "channel 1 type = temp09, module = 1, status = on, "
+    "settlingtime = 50, readtime = 260, equation = tmp, "
+    "userunits = C, gain = none, availablegains = none, "
+    "derived = off, label = temperature_00 || "
+    "channel 2 type = pres24, module = 2, status = on, "
+    "settlingtime = 50, readtime = 290, equation = corr_pres2, "
+    "userunits = dbar, gain = none, availablegains = none, "
+    "derived = off, label = pressure_00 || channel 3 type = pres08, "
+    "module = 240, status = on, settlingtime = 0, readtime = 0, "
+    "equation = deri_seapres, userunits = dbar, gain = none, "
+    "availablegains = none, derived = on, label = seapressure_00 || "
+    "channel 4 type = dpth01, module = 241, status = on, "
+    "settlingtime = 0, readtime = 0, equation = deri_depth, "
+    "userunits = m, gain = none, availablegains = none, derived = on, "
+    "label = depth_00 || channel 5 type = cnt_00, module = 242, "
+    "status = on, settlingtime = 0, readtime = 0, equation = none, "
+    "userunits = counts, gain = none, availablegains = none, "
+    "derived = on, label = count_00",
+    "calibration 1 label = temperature_00, datetime = 20000401000000, "
+    "c0 = 3.5000000e-003, c1 = -250.00002e-006, c2 = 2.7000000e-006, "
+    "c3 = 23.000000e-009 || calibration 2 label = pressure_00, "
+    "datetime = 20000401000000, c0 = 0.0000000e+000, "
+    "c1 = 1.0000000e+000, c2 = 0.0000000e+000, c3 = 0.0000000e+000, "
+    "x0 = 0.0000000e+000, x1 = 0.0000000e+000, x2 = 0.0000000e+000, "
+    "x3 = 0.0000000e+000, x4 = 0.0000000e+000, x5 = 0.0000000e+000, "
+    "n0 = 6 || calibration 3 label = seapressure_00, "
+    "datetime = 20000401000000, n0 = 2, n1 = value || calibration 4 "
+    "label = depth_00, datetime = 20000401000000, n0 = 2, n1 = value "
+    "|| calibration 5 label = count_00, datetime = 20000401000000, "
+    "n0 = value"
+};
+
+typedef struct ParseResponseState
+{
+    RBRInstrument instrument;
+    const char *response;
+    char buffer[RBRINSTRUMENT_RESPONSE_BUFFER_MAX];
+} ParseResponseState;
+
+bool bench_parseResponse_setup(Benchmark *benchmark)
+{
+    ParseResponseState *state;
+    if ((state = calloc(1, sizeof(ParseResponseState))) == NULL)
+    {
+        return false;
+    }
+
+    state->response = responses[benchmark->parameter];
+    benchmark->bytes = strlen(state->response) + 1;
+    benchmark->state = state;
+    return true;
+}
+
+void bench_parseResponse_run(Benchmark *benchmark, int64_t iterations)
+{
+    ParseResponseState *state = benchmark->state;
+    char *command;
+    RBRInstrumentResponseParameter parameter;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        /* Parsing is destructive, so every iteration needs a fresh copy. */
+        memcpy(state->buffer, state->response, benchmark->bytes);
+        state->instrument.response.response = state->buffer;
+
+        command = NULL;
+        do
+        {
+            RBRInstrument_parseResponse(&state->instrument,
+                                        &command,
+                                        &parameter);
+            benchSink += parameter.index;
+        } while (parameter.key != NULL);
+    }
+}
+
+void bench_parseResponse_teardown(Benchmark *benchmark)
+{
+    free(benchmark->state);
+}
+
+#define BENCH_L3_PREAMBLE \
+    "RBR RBRduo3 1.090 999999" \
+    RBRINSTRUMENT_COMMAND_TERMINATOR \
+    "id model = RBRoem3, version = 1.090, serial = 999999, fwtype = 104" \
+    RBRINSTRUMENT_COMMAND_TERMINATOR
+
+#define BENCH_SAMPLE_LINES 4
+
+static const char *sampleLines =
+    "2019-06-13 12:34:56.000, 12.3456, 10.1234, 35.1234, 0.0012"
+    RBRINSTRUMENT_COMMAND_TERMINATOR
+    "2019-06-13 12:34:56.063, 12.3461, 10.1301, 35.1229, 0.0011"
+    RBRINSTRUMENT_COMMAND_TERMINATOR
+    "2019-06-13 12:34:56.125, 12.3467, 10.1388, 35.1240, 0.0013"
+    RBRINSTRUMENT_COMMAND_TERMINATOR
+    "2019-06-13 12:34:56.188, 12.3470, 10.1402, 35.1236, 0.0012"
+    RBRINSTRUMENT_COMMAND_TERMINATOR;
+
+static RBRInstrumentError bench_readSample_sample(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentSample *const sample)
+{
+    /* Unused. */
+    (void) instrument;
+
+    benchSink += sample->timestamp;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+bool bench_readSample_setup(Benchmark *benchmark)
+{
+    RBRInstrument *instrument;
+    if (BenchInstrument_open(&instrument,
+                             BENCH_L3_PREAMBLE,
+                             sampleLines,
+                             bench_readSample_sample)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        return false;
+    }
+
+    /* Make sure we're timing sample parsing and not error handling. */
+    if (RBRInstrument_readSample(instrument) != RBRINSTRUMENT_SUCCESS)
+    {
+        BenchInstrument_close(instrument);
+        return false;
+    }
+
+    benchmark->bytes = strlen(sampleLines) / BENCH_SAMPLE_LINES;
+    benchmark->state = instrument;
+    return true;
+}
+
+void bench_readSample_run(Benchmark *benchmark, int64_t iterations)
+{
+    RBRInstrument *instrument = benchmark->state;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        RBRInstrument_readSample(instrument);
+    }
+}
+
+void bench_readSample_teardown(Benchmark *benchmark)
+{
+    BenchInstrument_close(benchmark->state);
+}
+
+bool bench_crc_setup(Benchmark *benchmark)
+{
+    uint8_t *data;
+    if ((data = malloc(benchmark->parameter)) == NULL)
+    {
+        return false;
+    }
+
+    uint32_t x = 1;
+    for (int32_t i = 0; i < benchmark->parameter; i++)
+    {
+        x = x * 1103515245 + 12345;
+        data[i] = x >> 16;
+    }
+
+    benchmark->bytes = benchmark->parameter;
+    benchmark->state = data;
+    return true;
+}
+
+void bench_crc_run(Benchmark *benchmark, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        benchSink += RBRInstrument_calculateCrc(benchmark->state,
+                                                benchmark->parameter);
+    }
+}
+
+void bench_crc_teardown(Benchmark *benchmark)
+{
+    free(benchmark->state);
+}
+
+static const char *sampleTime = "2019-06-13 12:34:56.789";
+static const char *scheduleTime = "20190613123456";
+
+bool bench_parseSampleTime_setup(Benchmark *benchmark)
+{
+    benchmark->bytes = RBRINSTRUMENT_SAMPLE_TIME_LEN;
+    return true;
+}
+
+void bench_parseSampleTime_run(Benchmark *benchmark, int64_t iterations)
+{
+    /* Unused. */
+    (void) benchmark;
+
+    RBRInstrumentDateTime timestamp;
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        RBRInstrumentDateTime_parseSampleTime(sampleTime, &timestamp, NULL);
+        benchSink += timestamp;
+    }
+}
+
+bool bench_parseScheduleTime_setup(Benchmark *benchmark)
+{
+    benchmark->bytes = RBRINSTRUMENT_SCHEDULE_TIME_LEN;
+    return true;
+}
+
+void bench_parseScheduleTime_run(Benchmark *benchmark, int64_t iterations)
+{
+    /* Unused. */
+    (void) benchmark;
+
+    RBRInstrumentDateTime timestamp;
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        RBRInstrumentDateTime_parseScheduleTime(scheduleTime,
+                                                &timestamp,
+                                                NULL);
+        benchSink += timestamp;
+    }
+}
+
+void bench_toSampleTime_run(Benchmark *benchmark, int64_t iterations)
+{
+    /* Unused. */
+    (void) benchmark;
+
+    char s[RBRINSTRUMENT_SAMPLE_TIME_LEN + 1];
+    RBRInstrumentDateTime timestamp = 1560429296789LL;
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        /* Step by an odd number of milliseconds so every field changes. */
+        RBRInstrumentDateTime_toSampleTime(timestamp + i * 1000063LL, s);
+        benchSink += s[RBRINSTRUMENT_SAMPLE_TIME_LEN - 1];
+    }
+}
+
+void bench_toScheduleTime_run(Benchmark *benchmark, int64_t iterations)
+{
+    /* Unused. */
+    (void) benchmark;
+
+    char s[RBRINSTRUMENT_SCHEDULE_TIME_LEN + 1];
+    RBRInstrumentDateTime timestamp = 1560429296000LL;
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        RBRInstrumentDateTime_toScheduleTime(timestamp + i * 1000063LL, s);
+        benchSink += s[RBRINSTRUMENT_SCHEDULE_TIME_LEN - 1];
+    }
+}
@@ -0,0 +1,520 @@
+/**
+ * \file main.c
+ *
+ * \brief Runner for library benchmarks.
+ *
+ * Each benchmark is run for at least #BENCH_MIN_TIME_NSEC, and the best of
+ * #BENCH_ROUNDS rounds is reported. Results are printed as tab-separated
+ * values, one benchmark per line, so they can be collected and compared over
+ * time:
+ *
+ *     benchmark	iterations	ns/op	MB/s
+ *
+ * Throughput is reported as `-` for benchmarks where it isn't meaningful.
+ * If arguments are given, only benchmarks whose names begin with one of them
+ * are run.
+ *
+ * The library is benchmarked as built: for meaningful numbers, build it with
+ * optimizations enabled; e.g., `make clean && make CC='cc -O2' bench`.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for clock_gettime, struct timespec in time.h. */
+#define _POSIX_C_SOURCE 200112L
+
+/* Required for clock_gettime, struct timespec. */
+#include <time.h>
+
+#include "bench.h"
+
+/** \brief The least time for which each round of a benchmark should run. */
+#define BENCH_MIN_TIME_NSEC 200000000
+/** \brief The number of timed rounds of each benchmark. */
+#define BENCH_ROUNDS 3
+
+volatile int64_t benchSink;
+
+static Benchmark benchmarks[] = {
+    {
+        .name = "parseResponse/channels",
+        .parameter = 0,
+        .setup = bench_parseResponse_setup,
+        .run = bench_parseResponse_run,
+        .teardown = bench_parseResponse_teardown
+    },
+    {
+        .name = "parseResponse/calibration",
+        .parameter = 1,
+        .setup = bench_parseResponse_setup,
+        .run = bench_parseResponse_run,
+        .teardown = bench_parseResponse_teardown
+    },
+    {
+        .name = "readSample/caltext01",
+        .setup = bench_readSample_setup,
+        .run = bench_readSample_run,
+        .teardown = bench_readSample_teardown
+    },
+    {
+        .name = "calculateCrc/4096",
+        .parameter = 4096,
+        .setup = bench_crc_setup,
+        .run = bench_crc_run,
+        .teardown = bench_crc_teardown
+    },
+    {
+        .name = "DateTime/parseSampleTime",
+        .setup = bench_parseSampleTime_setup,
+        .run = bench_parseSampleTime_run
+    },
+    {
+        .name = "DateTime/parseScheduleTime",
+        .setup = bench_parseScheduleTime_setup,
+        .run = bench_parseScheduleTime_run
+    },
+    {
+        .name = "DateTime/toSampleTime",
+        .setup = bench_parseSampleTime_setup,
+        .run = bench_toSampleTime_run
+    },
+    {
+        .name = "DateTime/toScheduleTime",
+        .setup = bench_parseScheduleTime_setup,
+        .run = bench_toScheduleTime_run
+    },
+    {
+        .name = "RBRParser_parse/easyparse/1ch",
+        .parameter = 1,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parse/easyparse/4ch",
+        .parameter = 4,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parse/easyparse/12ch",
+        .parameter = 12,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parse/easyparse/32ch",
+        .parameter = RBRINSTRUMENT_CHANNEL_MAX,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_next/easyparse/1ch",
+        .parameter = 1,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseNext_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_next/easyparse/4ch",
+        .parameter = 4,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseNext_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_next/easyparse/12ch",
+        .parameter = 12,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseNext_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_next/easyparse/32ch",
+        .parameter = RBRINSTRUMENT_CHANNEL_MAX,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseNext_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parse/selected/4ch",
+        .parameter = 4,
+        .setup = bench_parseSelected_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parse/selected/32ch",
+        .parameter = RBRINSTRUMENT_CHANNEL_MAX,
+        .setup = bench_parseSelected_setup,
+        .run = bench_parseEasyParse_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parseColumns/easyparse/1ch",
+        .parameter = 1,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseColumns_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parseColumns/easyparse/4ch",
+        .parameter = 4,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseColumns_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parseColumns/easyparse/12ch",
+        .parameter = 12,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseColumns_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRParser_parseColumns/easyparse/32ch",
+        .parameter = RBRINSTRUMENT_CHANNEL_MAX,
+        .setup = bench_parseEasyParse_setup,
+        .run = bench_parseColumns_run,
+        .teardown = bench_parseEasyParse_teardown
+    },
+    {
+        .name = "RBRDownsampler_push/decimate/4ch",
+        .parameter = RBRDOWNSAMPLER_DECIMATE,
+        .setup = bench_downsample_setup,
+        .run = bench_downsample_run,
+        .teardown = bench_downsample_teardown
+    },
+    {
+        .name = "RBRDownsampler_push/minmax/4ch",
+        .parameter = RBRDOWNSAMPLER_MIN_MAX,
+        .setup = bench_downsample_setup,
+        .run = bench_downsample_run,
+        .teardown = bench_downsample_teardown
+    },
+    {
+        .name = "RBRDownsampler_push/lttb/4ch",
+        .parameter = RBRDOWNSAMPLER_LTTB,
+        .setup = bench_downsample_setup,
+        .run = bench_downsample_run,
+        .teardown = bench_downsample_teardown
+    },
+    {
+        .name = "RBRBinner_push/time/3ch",
+        .parameter = 0,
+        .setup = bench_bin_setup,
+        .run = bench_bin_run,
+        .teardown = bench_bin_teardown
+    },
+    {
+        .name = "RBRBinner_push/depth/3ch",
+        .parameter = 1,
+        .setup = bench_bin_setup,
+        .run = bench_bin_run,
+        .teardown = bench_bin_teardown
+    },
+    {
+        .name = "RBRCastDetector_push",
+        .setup = bench_cast_setup,
+        .run = bench_cast_run,
+        .teardown = bench_cast_teardown
+    },
+    {
+        .name = "RBRStatistics_push/4ch",
+        .parameter = 0,
+        .setup = bench_statistics_setup,
+        .run = bench_statistics_run,
+        .teardown = bench_statistics_teardown
+    },
+    {
+        .name = "RBRStatistics_push/4ch/3q",
+        .parameter = 3,
+        .setup = bench_statistics_setup,
+        .run = bench_statistics_run,
+        .teardown = bench_statistics_teardown
+    },
+    {0}
+};
+
+typedef struct BenchIOBuffers
+{
+    const char *preamble;
+    int32_t preambleSize;
+    int32_t preamblePos;
+    const char *data;
+    int32_t dataSize;
+    int32_t dataPos;
+} BenchIOBuffers;
+
+static RBRInstrumentError BenchIOBuffers_time(
+    const struct RBRInstrument *instrument,
+    RBRInstrumentDateTime *time)
+{
+    /* Unused. */
+    (void) instrument;
+
+    *time = 0;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError BenchIOBuffers_sleep(
+    const struct RBRInstrument *instrument,
+    RBRInstrumentDateTime time)
+{
+    /* Unused. */
+    (void) instrument;
+    (void) time;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError BenchIOBuffers_read(
+    const struct RBRInstrument *instrument,
+    void *data,
+    int32_t *size)
+{
+    BenchIOBuffers *buffers;
+    buffers = (BenchIOBuffers *) RBRInstrument_getUserData(instrument);
+
+    int32_t length;
+    if (buffers->preamblePos < buffers->preambleSize)
+    {
+        length = buffers->preambleSize - buffers->preamblePos;
+        if (length > *size)
+        {
+            length = *size;
+        }
+        memcpy(data, buffers->preamble + buffers->preamblePos, length);
+        buffers->preamblePos += length;
+    }
+    else
+    {
+        /* Fill the whole request, wrapping around as many times as needed,
+         * the way a busy instrument would. */
+        uint8_t *destination = data;
+        length = 0;
+        while (length < *size)
+        {
+            int32_t chunk = buffers->dataSize - buffers->dataPos;
+            if (chunk > *size - length)
+            {
+                chunk = *size - length;
+            }
+            memcpy(destination + length,
+                   buffers->data + buffers->dataPos,
+                   chunk);
+            length += chunk;
+            buffers->dataPos += chunk;
+            if (buffers->dataPos == buffers->dataSize)
+            {
+                buffers->dataPos = 0;
+            }
+        }
+    }
+
+    *size = length;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError BenchIOBuffers_write(
+    const struct RBRInstrument *instrument,
+    const void *const data,
+    int32_t size)
+{
+    /* Unused. */
+    (void) instrument;
+    (void) data;
+    (void) size;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError BenchInstrument_open(RBRInstrument **instrument,
+                                        const char *preamble,
+                                        const char *data,
+                                        RBRInstrumentSampleCallback sample)
+{
+    BenchIOBuffers *buffers;
+    RBRInstrumentSample *sampleBuffer = NULL;
+    RBRInstrumentError err;
+
+    if ((buffers = malloc(sizeof(BenchIOBuffers))) == NULL)
+    {
+        return RBRINSTRUMENT_ALLOCATION_FAILURE;
+    }
+    if (sample != NULL
+        && (sampleBuffer = malloc(sizeof(RBRInstrumentSample))) == NULL)
+    {
+        free(buffers);
+        return RBRINSTRUMENT_ALLOCATION_FAILURE;
+    }
+
+    *buffers = (BenchIOBuffers) {
+        .preamble = preamble,
+        .preambleSize = strlen(preamble),
+        .data = data,
+        .dataSize = strlen(data)
+    };
+
+    RBRInstrumentCallbacks callbacks = {
+        .time = BenchIOBuffers_time,
+        .sleep = BenchIOBuffers_sleep,
+        .read = BenchIOBuffers_read,
+        .write = BenchIOBuffers_write,
+        .sample = sample,
+        .sampleBuffer = sampleBuffer
+    };
+
+    *instrument = NULL;
+    err = RBRInstrument_open(instrument,
+                             &callbacks,
+                             /* command timeout */ 0,
+                             buffers);
+    if (err != RBRINSTRUMENT_SUCCESS)
+    {
+        free(sampleBuffer);
+        free(buffers);
+    }
+    return err;
+}
+
+void BenchInstrument_close(RBRInstrument *instrument)
+{
+    if (instrument == NULL)
+    {
+        return;
+    }
+
+    free(instrument->callbacks.sampleBuffer);
+    free(RBRInstrument_getUserData(instrument));
+    RBRInstrument_close(instrument);
+}
+
+bool BenchSamples_setup(Benchmark *benchmark, BenchSampleGenerator generate)
+{
+    BenchSamples *state;
+    if ((state = calloc(1, sizeof(BenchSamples))) == NULL)
+    {
+        return false;
+    }
+
+    for (int32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        state->samples[i].timestamp = 1560429296000LL + i * 63;
+        generate(i, &state->samples[i]);
+    }
+
+    benchmark->state = state;
+    return true;
+}
+
+void BenchSamples_teardown(Benchmark *benchmark)
+{
+    free(benchmark->state);
+    benchmark->state = NULL;
+}
+
+static int64_t benchNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+static int64_t benchTime(Benchmark *benchmark, int64_t iterations)
+{
+    int64_t start = benchNow();
+    benchmark->run(benchmark, iterations);
+    return benchNow() - start;
+}
+
+static bool benchSelected(const Benchmark *benchmark, int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        return true;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(benchmark->name, argv[i], strlen(argv[i])) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    printf("benchmark\titerations\tns/op\tMB/s\n");
+
+    for (Benchmark *benchmark = benchmarks;
+         benchmark->name != NULL;
+         benchmark++)
+    {
+        if (!benchSelected(benchmark, argc, argv))
+        {
+            continue;
+        }
+
+        if (benchmark->setup != NULL && !benchmark->setup(benchmark))
+        {
+            fprintf(stderr, "%s: setup failed; skipping.\n", benchmark->name);
+            continue;
+        }
+
+        /* Find an iteration count which runs for long enough to time. */
+        int64_t iterations = 1;
+        int64_t elapsed;
+        while ((elapsed = benchTime(benchmark, iterations))
+               < BENCH_MIN_TIME_NSEC)
+        {
+            if (elapsed < BENCH_MIN_TIME_NSEC / 100)
+            {
+                iterations *= 100;
+            }
+            else
+            {
+                iterations = iterations * BENCH_MIN_TIME_NSEC / elapsed + 1;
+            }
+        }
+
+        int64_t best = elapsed;
+        for (int32_t round = 1; round < BENCH_ROUNDS; round++)
+        {
+            elapsed = benchTime(benchmark, iterations);
+            if (elapsed < best)
+            {
+                best = elapsed;
+            }
+        }
+
+        double nsPerOp = (double) best / iterations;
+        printf("%s\t%" PRIi64 "\t%.1f\t",
+               benchmark->name,
+               iterations,
+               nsPerOp);
+        if (benchmark->bytes > 0)
+        {
+            /* Bytes per nanosecond is gigabytes per second. */
+            printf("%.2f\n", benchmark->bytes / nsPerOp * 1000.0);
+        }
+        else
+        {
+            printf("-\n");
+        }
+
+        if (benchmark->teardown != NULL)
+        {
+            benchmark->teardown(benchmark);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
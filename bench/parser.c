@@ -0,0 +1,209 @@
+/**
+ * \file parser.c
+ *
+ * \brief Benchmarks for the dataset parser.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+
+/** \brief The number of samples parsed by each operation. */
+#define BENCH_EASYPARSE_SAMPLES 1024
+
+typedef struct ParseEasyParseState
+{
+    RBRParser *parser;
+    RBRInstrumentSample sample;
+    uint8_t *data;
+    int32_t size;
+    RBRParserColumns columns;
+    RBRParserRecord record;
+} ParseEasyParseState;
+
+static RBRInstrumentError bench_parseEasyParse_sample(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentSample *const sample)
+{
+    /* Unused. */
+    (void) parser;
+
+    benchSink += sample->timestamp;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+bool bench_parseEasyParse_setup(Benchmark *benchmark)
+{
+    int32_t channels = benchmark->parameter;
+    ParseEasyParseState *state;
+    if ((state = calloc(1, sizeof(ParseEasyParseState))) == NULL)
+    {
+        return false;
+    }
+
+    int32_t sampleSize = sizeof(RBRInstrumentDateTime)
+                         + sizeof(float) * channels;
+    state->size = sampleSize * BENCH_EASYPARSE_SAMPLES;
+    if ((state->data = malloc(state->size)) == NULL)
+    {
+        free(state);
+        return false;
+    }
+
+    /* Synthesize a deployment sampling at 16Hz. */
+    for (int32_t i = 0; i < BENCH_EASYPARSE_SAMPLES; i++)
+    {
+        uint8_t *sample = state->data + i * sampleSize;
+        RBRInstrumentDateTime timestamp = 1560429296000LL + i * 63;
+        memcpy(sample, &timestamp, sizeof(timestamp));
+        for (int32_t channel = 0; channel < channels; channel++)
+        {
+            float reading = channel * 10.0f + i * 0.001f;
+            memcpy(sample
+                   + sizeof(RBRInstrumentDateTime)
+                   + channel * sizeof(float),
+                   &reading,
+                   sizeof(reading));
+        }
+    }
+
+    /* One column block serves both the timestamps and the readings. */
+    double *block = malloc(sizeof(double)
+                           * BENCH_EASYPARSE_SAMPLES
+                           * (channels + 1));
+    if (block == NULL)
+    {
+        free(state->data);
+        free(state);
+        return false;
+    }
+    state->columns.capacity = BENCH_EASYPARSE_SAMPLES;
+    state->columns.timestamps = (RBRInstrumentDateTime *) block;
+    for (int32_t channel = 0; channel < channels; channel++)
+    {
+        state->columns.readings[channel] = block
+                                           + (channel + 1)
+                                           * BENCH_EASYPARSE_SAMPLES;
+    }
+
+    RBRParserCallbacks callbacks = {
+        .sample = bench_parseEasyParse_sample,
+        .sampleBuffer = &state->sample
+    };
+    RBRParserConfig config = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+        .formatConfig.easyParse = {
+            .channels = channels
+        }
+    };
+    if (RBRParser_init(&state->parser, &callbacks, &config, NULL)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        free(block);
+        free(state->data);
+        free(state);
+        return false;
+    }
+
+    benchmark->bytes = state->size;
+    benchmark->state = state;
+    return true;
+}
+
+bool bench_parseSelected_setup(Benchmark *benchmark)
+{
+    if (!bench_parseEasyParse_setup(benchmark))
+    {
+        return false;
+    }
+
+    /* Re-create the parser to decode only two channels, and only the
+     * samples from the second half of the deployment. */
+    ParseEasyParseState *state = benchmark->state;
+    RBRParserCallbacks callbacks = {
+        .sample = bench_parseEasyParse_sample,
+        .sampleBuffer = &state->sample
+    };
+    RBRParserConfig config = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+        .formatConfig.easyParse = {
+            .channels = benchmark->parameter,
+            .selectedChannelCount = 2,
+            .selectedChannels = {0, benchmark->parameter - 1},
+            .startTime = 1560429296000LL + BENCH_EASYPARSE_SAMPLES / 2 * 63
+        }
+    };
+    RBRParser_destroy(state->parser);
+    state->parser = NULL;
+    if (RBRParser_init(&state->parser, &callbacks, &config, NULL)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        free(state->columns.timestamps);
+        free(state->data);
+        free(state);
+        return false;
+    }
+
+    return true;
+}
+
+void bench_parseEasyParse_run(Benchmark *benchmark, int64_t iterations)
+{
+    ParseEasyParseState *state = benchmark->state;
+    int32_t size;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        size = state->size;
+        RBRParser_parse(state->parser,
+                        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                        state->data,
+                        &size);
+    }
+}
+
+void bench_parseColumns_run(Benchmark *benchmark, int64_t iterations)
+{
+    ParseEasyParseState *state = benchmark->state;
+    int32_t size;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        size = state->size;
+        state->columns.length = 0;
+        RBRParser_parseColumns(state->parser,
+                               state->data,
+                               &size,
+                               &state->columns);
+        benchSink += state->columns.timestamps[0];
+    }
+}
+
+void bench_parseNext_run(Benchmark *benchmark, int64_t iterations)
+{
+    ParseEasyParseState *state = benchmark->state;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        RBRParser_setBuffer(state->parser,
+                            RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                            state->data,
+                            state->size);
+        while (RBRParser_next(state->parser, &state->record)
+               == RBRINSTRUMENT_SUCCESS)
+        {
+            benchSink += state->record.value.sample.timestamp;
+        }
+    }
+}
+
+void bench_parseEasyParse_teardown(Benchmark *benchmark)
+{
+    ParseEasyParseState *state = benchmark->state;
+    RBRParser_destroy(state->parser);
+    free(state->columns.timestamps);
+    free(state->data);
+    free(state);
+}
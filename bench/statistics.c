@@ -0,0 +1,74 @@
+/**
+ * \file statistics.c
+ *
+ * \brief Benchmarks for streaming per-channel statistics.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "bench.h"
+
+/* Synthesizes a CTD with a dissolved oxygen sensor which occasionally
+ * reports an error. */
+static void bench_statistics_sample(int32_t i, RBRInstrumentSample *sample)
+{
+    sample->channels = 4;
+    sample->readings[0] = 40.0 + (i % 17) * 0.01;
+    sample->readings[1] = 12.0 - i * 0.005;
+    sample->readings[2] = i * 100.0 / BENCH_SAMPLES;
+    sample->readings[3] = (i % 97 == 0)
+        ? RBRInstrumentReading_setError(RBRINSTRUMENT_READING_FLAG_ERROR, 1)
+        : 250.0 + (i % 13) * 0.1;
+}
+
+bool bench_statistics_setup(Benchmark *benchmark)
+{
+    if (!BenchSamples_setup(benchmark, bench_statistics_sample))
+    {
+        return false;
+    }
+
+    /* The parameter is the number of quantiles to estimate. */
+    RBRStatisticsConfig config = {
+        .channels = 4,
+        .quantileCount = benchmark->parameter,
+        .quantiles = {0.5, 0.05, 0.95}
+    };
+    RBRStatistics *statistics = NULL;
+    if (RBRStatistics_init(&statistics, &config, NULL, NULL)
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        BenchSamples_teardown(benchmark);
+        return false;
+    }
+
+    ((BenchSamples *) benchmark->state)->object = statistics;
+    return true;
+}
+
+void bench_statistics_run(Benchmark *benchmark, int64_t iterations)
+{
+    BenchSamples *state = benchmark->state;
+    RBRStatistics *statistics = state->object;
+    RBRStatisticsChannel summary;
+
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        for (int32_t j = 0; j < BENCH_SAMPLES; j++)
+        {
+            RBRStatistics_push(statistics, &state->samples[j]);
+        }
+        RBRStatistics_getChannel(statistics, 0, &summary);
+        benchSink += summary.count;
+        RBRStatistics_reset(statistics);
+    }
+}
+
+void bench_statistics_teardown(Benchmark *benchmark)
+{
+    BenchSamples *state = benchmark->state;
+    RBRStatistics_destroy(state->object);
+    BenchSamples_teardown(benchmark);
+}
@@ -0,0 +1,334 @@
+/**
+ * \file posix-bin.c
+ *
+ * \brief Example of using the library to bin an EasyParse sample dataset by
+ * time or depth on the host in a POSIX environment.
+ *
+ * This performs the same job as instrument post-processing (see
+ * posix-postprocessing.c), but on a downloaded dataset, and without needing
+ * instrument firmware which supports it. The deployment header gives the
+ * channel labels by which the reference and aggregated channels are named.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for clock_gettime in time.h. */
+#define _POSIX_C_SOURCE 200112L
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for open. */
+#include <fcntl.h>
+/* Required for fprintf, printf, snprintf, sscanf. */
+#include <stdio.h>
+/* Required for EXIT_FAILURE, EXIT_SUCCESS, strtod. */
+#include <stdlib.h>
+/* Required for memset, strcmp, strerror. */
+#include <string.h>
+/* Required for mmap, munmap, posix_madvise. */
+#include <sys/mman.h>
+/* Required for fstat, open, struct stat. */
+#include <sys/stat.h>
+/* Required for clock_gettime. */
+#include <time.h>
+/* Required for close. */
+#include <unistd.h>
+
+#include "RBRBinner.h"
+#include "RBRParser.h"
+
+/**
+ * \brief The deepest depth bin boundary, in dbar.
+ *
+ * Deeper than any ocean, so bins are bounded only by the data.
+ */
+#define DEPTH_MAX 11000.0f
+
+static int64_t now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+RBRInstrumentError binnerBin(const struct RBRBinner *binner,
+                             const struct RBRInstrumentSample *const bin)
+{
+    int64_t *bins = RBRBinner_getUserData(binner);
+    ++*bins;
+
+    printf("%" PRIi64, bin->timestamp);
+    for (int32_t i = 0; i < bin->channels; i++)
+    {
+        printf(", %lf", bin->readings[i]);
+    }
+    printf("\n");
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError parserSample(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentSample *const sample)
+{
+    return RBRBinner_push(RBRParser_getUserData(parser), sample);
+}
+
+/**
+ * \brief Parse a post-processing channel given as “function(label)”; e.g.,
+ * “mean(temperature_00)”.
+ *
+ * \return 0 on success, or -1 if the channel couldn't be parsed
+ */
+static int parseChannel(const char *s,
+                        RBRInstrumentPostprocessingChannelsList *channels)
+{
+    char function[16];
+    char label[RBRINSTRUMENT_CHANNEL_LABEL_MAX + 1];
+    char close;
+    if (channels->count == RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX
+        || sscanf(s, "%15[^(](%31[^)]%c", function, label, &close) != 3
+        || close != ')')
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_COUNT; i++)
+    {
+        const char *name = RBRInstrumentPostprocessingAggregate_name(i);
+        if (strcmp(function, name) == 0)
+        {
+            channels->channels[channels->count].function = i;
+            snprintf(channels->channels[channels->count].label,
+                     sizeof(channels->channels[channels->count].label),
+                     "%s",
+                     label);
+            ++channels->count;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * \brief Map a whole file into memory for reading.
+ *
+ * \return 0 on success, or -1 with an explanation printed on failure
+ */
+static int mapFile(const char *programName,
+                   const char *path,
+                   void **data,
+                   int64_t *size)
+{
+    int fd;
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        fprintf(stderr, "%s: Failed to open %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+        return -1;
+    }
+
+    int result = -1;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0)
+    {
+        fprintf(stderr, "%s: Failed to stat %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+    }
+    else if ((*size = fileStat.st_size) == 0)
+    {
+        *data = NULL;
+        result = 0;
+    }
+    else if ((*data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0))
+             == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: Failed to map %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+    }
+    else
+    {
+        posix_madvise(*data, *size, POSIX_MADV_SEQUENTIAL);
+        result = 0;
+    }
+
+    close(fd);
+    return result;
+}
+
+static void unmapFile(void *data, int64_t size)
+{
+    if (size > 0)
+    {
+        munmap(data, size);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    int status = EXIT_SUCCESS;
+
+    if (argc < 6)
+    {
+        fprintf(stderr,
+                "Usage: %s file header-file tstamp|reference bin-size"
+                " function(label)...\n"
+                "\n"
+                "Bins the samples of an EasyParse sample data file (dataset"
+                " 1) by time\n"
+                "(given \"tstamp\" and a bin size in milliseconds) or by"
+                " depth (given a\n"
+                "pressure channel label and a bin size in dbar). The"
+                " deployment header\n"
+                "(dataset 2) gives the channel labels. Functions are mean,"
+                " std, and count.\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    RBRBinnerConfig binnerConfig;
+    memset(&binnerConfig, 0, sizeof(binnerConfig));
+    RBRInstrumentPostprocessing *postprocessing =
+        &binnerConfig.postprocessing;
+    snprintf(postprocessing->binReference,
+             sizeof(postprocessing->binReference),
+             "%s",
+             argv[3]);
+    postprocessing->binFilter = RBRINSTRUMENT_POSTPROCESSING_BINFILTER_NONE;
+    postprocessing->binSize = strtod(argv[4], NULL);
+    postprocessing->tstampMin = RBRINSTRUMENT_DATETIME_MIN;
+    postprocessing->tstampMax = RBRINSTRUMENT_DATETIME_MAX;
+    postprocessing->depthMin = 0.0f;
+    postprocessing->depthMax = DEPTH_MAX;
+    for (int i = 5; i < argc; i++)
+    {
+        if (parseChannel(argv[i], &postprocessing->channels) < 0)
+        {
+            fprintf(stderr, "%s: Invalid channel \"%s\"!\n",
+                    programName,
+                    argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    binnerConfig.bin = binnerBin;
+
+    /* The deployment header gives both the parser configuration and the
+     * labels of the channels in each sample. */
+    void *headerData;
+    int64_t headerSize;
+    if (mapFile(programName, argv[2], &headerData, &headerSize) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    RBRParserDeploymentHeader header;
+    memset(&header, 0, sizeof(header));
+    RBRParserConfig parserConfig;
+    int32_t parsedHeaderSize = (headerSize > INT32_MAX) ? INT32_MAX
+                                                          : headerSize;
+    RBRInstrumentError err;
+    if ((err = RBRParser_parseDeploymentHeader(headerData,
+                                               &parsedHeaderSize,
+                                               &header))
+        != RBRINSTRUMENT_SUCCESS
+        || (err = RBRParserDeploymentHeader_getConfig(&header, &parserConfig))
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to parse deployment header: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        unmapFile(headerData, headerSize);
+        return EXIT_FAILURE;
+    }
+    unmapFile(headerData, headerSize);
+
+    for (int32_t i = 0; i < header.channelCount; i++)
+    {
+        if (header.channels[i].status)
+        {
+            snprintf(binnerConfig.labels[binnerConfig.channels],
+                     sizeof(binnerConfig.labels[binnerConfig.channels]),
+                     "%s",
+                     header.channels[i].label);
+            ++binnerConfig.channels;
+        }
+    }
+
+    int64_t bins = 0;
+    RBRBinner *binner = NULL;
+    if ((err = RBRBinner_init(&binner, &binnerConfig, NULL, &bins))
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to initialize binner: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        return EXIT_FAILURE;
+    }
+
+    RBRParser *parser = NULL;
+    RBRInstrumentSample sampleBuffer;
+    RBRParserCallbacks parserCallbacks = {
+        .sample = parserSample,
+        .sampleBuffer = &sampleBuffer
+    };
+    if ((err = RBRParser_init(&parser,
+                              &parserCallbacks,
+                              &parserConfig,
+                              binner)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to initialize parser: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+        goto binnerCleanup;
+    }
+
+    void *dataset;
+    int64_t datasetSize;
+    if (mapFile(programName, argv[1], &dataset, &datasetSize) < 0)
+    {
+        status = EXIT_FAILURE;
+        goto parserCleanup;
+    }
+
+    int64_t start = now();
+    int64_t parsedSize = datasetSize;
+    if ((err = RBRParser_parseBuffer(
+             parser,
+             RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+             dataset,
+             &parsedSize)) != RBRINSTRUMENT_SUCCESS
+        || (err = RBRBinner_flush(binner)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to bin file: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+    }
+    else
+    {
+        fprintf(stderr, "%s: Binned %" PRIi64 " bytes into %" PRIi64
+                " bins in %.3fms.\n",
+                programName,
+                parsedSize,
+                bins,
+                (now() - start) / 1000000.0);
+    }
+
+    unmapFile(dataset, datasetSize);
+parserCleanup:
+    RBRParser_destroy(parser);
+binnerCleanup:
+    RBRBinner_destroy(binner);
+
+    return status;
+}
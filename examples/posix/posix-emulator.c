@@ -0,0 +1,1270 @@
+/**
+ * \file posix-emulator.c
+ *
+ * \brief A virtual instrument on a pseudo-terminal.
+ *
+ * Opens a pseudo-terminal, prints the path of its slave device, and answers
+ * commands written to it the way an instrument would, so that the library and
+ * the other examples can be exercised end to end without hardware. For
+ * example:
+ *
+ *     $ ./posix-emulator -p 250 &
+ *     /dev/pts/3
+ *     $ ./posix-stream /dev/pts/3
+ *
+ * The emulator speaks the Logger3 command language. It covers identification,
+ * link and serial settings, channels, sampling, deployment, memory formats,
+ * meminfo, readdata (with CRC), streaming, and fetch; commands it doesn't
+ * understand get the same “invalid command” error a real instrument would
+ * give. Most settings are simply stored and echoed back. With `-2`, the
+ * emulator identifies itself as a Logger2 instrument and uses the Logger2
+ * forms of link, stop, verify, and read data; other commands keep their
+ * Logger3 forms.
+ *
+ * Sample data is generated from the sample timestamp, so memory contents are
+ * stable across reads and match what was streamed. Memory is always in the
+ * calbin00 (EasyParse) format.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for posix_openpt, grantpt, unlockpt, ptsname in stdlib.h,
+ * getopt in unistd.h, and clock_gettime, nanosleep, gmtime_r in time.h. */
+#define _XOPEN_SOURCE 600
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for O_NOCTTY, O_RDWR, open. */
+#include <fcntl.h>
+/* Required for sin. */
+#include <math.h>
+/* Required for va_end, va_list, va_start. */
+#include <stdarg.h>
+/* Required for fflush, fprintf, printf, snprintf, sscanf, vsnprintf. */
+#include <stdio.h>
+/* Required for grantpt, posix_openpt, ptsname, strtol, unlockpt. */
+#include <stdlib.h>
+/* Required for memcpy, strchr, strcmp, strcspn, strerror, strlen, strspn,
+ * strstr, strtok. */
+#include <string.h>
+/* Required for select. */
+#include <sys/select.h>
+/* Required for tcgetattr, tcsetattr, struct termios. */
+#include <termios.h>
+/* Required for clock_gettime, gmtime_r, nanosleep, strftime. */
+#include <time.h>
+/* Required for close, getopt, read, write. */
+#include <unistd.h>
+
+#include "RBRInstrument.h"
+
+#define EMULATOR_LINE_MAX 512
+#define EMULATOR_RESPONSE_MAX 4096
+#define EMULATOR_VALUE_MAX 96
+#define EMULATOR_PARAMETERS_MAX 8
+#define EMULATOR_CHANNELS_MAX 8
+#define EMULATOR_READDATA_MAX 65536
+#define EMULATOR_MEMORY_SIZE 134217728
+
+#define EMULATOR_TIMESTAMP_SIZE ((int32_t) sizeof(RBRInstrumentDateTime))
+#define EMULATOR_READING_SIZE ((int32_t) sizeof(float))
+
+typedef struct EmulatorChannel
+{
+    const char *type;
+    const char *label;
+    const char *equation;
+    const char *units;
+    double base;
+    double amplitude;
+    /* In seconds. */
+    double period;
+} EmulatorChannel;
+
+/* Plausible-looking channels, in the order in which they'll be enabled. */
+static const EmulatorChannel channelTemplates[EMULATOR_CHANNELS_MAX] = {
+    {"temp09", "temperature_00", "tmp", "C", 10.0, 2.0, 600.0},
+    {"pres24", "pressure_00", "corr_pres2", "dbar", 60.0, 40.0, 1200.0},
+    {"cond10", "conductivity_00", "cond", "mS/cm", 35.0, 5.0, 900.0},
+    {"turb00", "turbidity_00", "lin", "NTU", 2.0, 1.5, 300.0},
+    {"fluo00", "chlorophyll_00", "lin", "ug/L", 1.0, 0.5, 450.0},
+    {"par_00", "par_00", "lin", "umol/m2/s", 500.0, 400.0, 3600.0},
+    {"volt00", "voltage_00", "lin", "V", 3.3, 0.1, 7200.0},
+    {"temp14", "temperature_01", "tmp", "C", 10.5, 2.0, 650.0}
+};
+
+typedef struct EmulatorParameter
+{
+    const char *key;
+    char value[EMULATOR_VALUE_MAX];
+    bool readOnly;
+} EmulatorParameter;
+
+typedef struct EmulatorCommand
+{
+    const char *name;
+    EmulatorParameter parameters[EMULATOR_PARAMETERS_MAX];
+} EmulatorCommand;
+
+/* Commands whose parameters are simply stored and echoed back. The Logger2
+ * form of `link` is handled by renaming its parameter at startup. */
+static EmulatorCommand commands[] = {
+    {
+        "id",
+        {
+            {"model", "RBRconcerto3", true},
+            {"version", "1.092", true},
+            {"serial", "60000", true},
+            {"fwtype", "104", true}
+        }
+    },
+    {
+        "hwrev",
+        {
+            {"pcb", "J", true},
+            {"cpu", "5659A", true},
+            {"bsl", "A", true}
+        }
+    },
+    {"link", {{"type", "usb", true}}},
+    {
+        "serial",
+        {
+            {"baudrate", "115200", false},
+            {"mode", "rs232", false},
+            {"availablebaudrates", "115200|19200|9600|4800|2400|1200", true},
+            {"availablemodes", "rs232|rs485f|uart|uart_idlelow", true}
+        }
+    },
+    {
+        "sampling",
+        {
+            {"mode", "continuous", false},
+            {"period", "1000", false},
+            {"burstlength", "2", false},
+            {"burstinterval", "10000", false},
+            {"gate", "none", false},
+            {"userperiodlimit", "63", true},
+            {"availablefastperiods", "500|250|125|63", true}
+        }
+    },
+    {
+        "deployment",
+        {
+            {"starttime", "20000101000000", false},
+            {"endtime", "20991231235959", false},
+            {"status", "stopped", true}
+        }
+    },
+    {
+        "memformat",
+        {
+            {"type", "calbin00", true},
+            {"newtype", "calbin00", false},
+            {"availabletypes", "rawbin00|calbin00", true}
+        }
+    },
+    {
+        "outputformat",
+        {
+            {"type", "caltext01", false},
+            {
+                "availabletypes",
+                "caltext01|caltext02|caltext03|caltext04",
+                true
+            },
+            /* Populated at startup from the channel configuration. */
+            {"channelslist", "", true},
+            {"labelslist", "", true}
+        }
+    },
+    {"streamusb", {{"state", "off", false}}},
+    {"streamserial", {{"state", "off", false}, {"aux1", "off", false}}},
+    {
+        "thresholding",
+        {
+            {"enabled", "false", false},
+            {"state", "n/a", true},
+            {"channelindex", "1", false},
+            {"channellabel", "temperature_00", false},
+            {"condition", "above", false},
+            {"value", "0.0000", false},
+            {"interval", "60000", false}
+        }
+    },
+    {
+        "twistactivation",
+        {
+            {"enabled", "false", false},
+            {"state", "n/a", true}
+        }
+    },
+    {
+        "settings",
+        {
+            {"fetchpoweroffdelay", "8000", false},
+            {"sensorpoweralwayson", "off", false},
+            {"castdetection", "off", false},
+            {"inputtimeout", "10000", false},
+            {"atmosphere", "10.1325", false}
+        }
+    },
+    {
+        "simulation",
+        {
+            {"state", "off", false},
+            {"period", "3600000", false}
+        }
+    },
+    {"prompt", {{"state", "off", false}}},
+    {"confirmation", {{"state", "on", false}}}
+};
+
+#define COMMANDS_LENGTH ((int32_t) (sizeof(commands) / sizeof(commands[0])))
+
+typedef struct Emulator
+{
+    int fd;
+    bool logger2;
+    int32_t channels;
+    int32_t latency;
+
+    /* When the first sample in memory was taken. */
+    RBRInstrumentDateTime memoryStart;
+    /* The number of samples in memory as of the last enable or disable. */
+    int32_t memorySamples;
+    /* When logging began, or -1 if not logging. */
+    RBRInstrumentDateTime loggingStart;
+    /* The index of the last sample streamed. */
+    int64_t lastStreamed;
+
+    char response[EMULATOR_RESPONSE_MAX];
+    int32_t responseLength;
+} Emulator;
+
+static RBRInstrumentDateTime emulatorNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return ((RBRInstrumentDateTime) now.tv_sec * 1000)
+           + (now.tv_nsec / 1000000);
+}
+
+static void emulatorSleep(int32_t milliseconds)
+{
+    struct timespec sleep = {
+        .tv_sec  =  milliseconds / 1000,
+        .tv_nsec = (milliseconds % 1000) * 1000000
+    };
+    nanosleep(&sleep, NULL);
+}
+
+static EmulatorCommand *emulatorFindCommand(const char *name)
+{
+    for (int32_t i = 0; i < COMMANDS_LENGTH; i++)
+    {
+        if (strcmp(commands[i].name, name) == 0)
+        {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+static EmulatorParameter *emulatorFindParameter(EmulatorCommand *command,
+                                                const char *key)
+{
+    for (int32_t i = 0;
+         i < EMULATOR_PARAMETERS_MAX && command->parameters[i].key != NULL;
+         i++)
+    {
+        if (strcmp(command->parameters[i].key, key) == 0)
+        {
+            return &command->parameters[i];
+        }
+    }
+    return NULL;
+}
+
+static char *emulatorGet(const char *command, const char *key)
+{
+    return emulatorFindParameter(emulatorFindCommand(command), key)->value;
+}
+
+static void emulatorSet(const char *command,
+                        const char *key,
+                        const char *value)
+{
+    snprintf(emulatorGet(command, key), EMULATOR_VALUE_MAX, "%s", value);
+}
+
+static int32_t emulatorPeriod(void)
+{
+    int32_t period = strtol(emulatorGet("sampling", "period"), NULL, 10);
+    return (period > 0) ? period : 1000;
+}
+
+static bool emulatorLogging(const Emulator *emulator)
+{
+    return emulator->loggingStart >= 0;
+}
+
+static int32_t emulatorSampleSize(const Emulator *emulator)
+{
+    return EMULATOR_TIMESTAMP_SIZE
+           + EMULATOR_READING_SIZE * emulator->channels;
+}
+
+static int32_t emulatorSampleCount(const Emulator *emulator,
+                                   RBRInstrumentDateTime now)
+{
+    int64_t count = emulator->memorySamples;
+    if (emulatorLogging(emulator))
+    {
+        count += (now - emulator->loggingStart) / emulatorPeriod() + 1;
+    }
+
+    int64_t max = EMULATOR_MEMORY_SIZE / emulatorSampleSize(emulator);
+    return (int32_t) ((count > max) ? max : count);
+}
+
+static double emulatorReading(int32_t channel, RBRInstrumentDateTime time)
+{
+    const EmulatorChannel *template = &channelTemplates[channel];
+
+    /* A little deterministic noise so the data doesn't look too synthetic. */
+    uint32_t hash = (uint32_t) time * 2654435761u + channel * 40503u;
+    hash ^= hash >> 16;
+    double noise = ((hash & 0xFFFF) / 65535.0 - 0.5) * 0.02;
+
+    return template->base
+           + template->amplitude
+           * (sin(2.0 * M_PI * (time / 1000.0) / template->period) + noise);
+}
+
+static void emulatorAppend(Emulator *emulator, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int32_t remaining = EMULATOR_RESPONSE_MAX - emulator->responseLength;
+    int32_t written = vsnprintf(emulator->response + emulator->responseLength,
+                                remaining,
+                                format,
+                                args);
+    va_end(args);
+
+    if (written > 0)
+    {
+        emulator->responseLength += (written < remaining)
+                                    ? written
+                                    : remaining - 1;
+    }
+}
+
+static void emulatorWrite(Emulator *emulator, const void *data, int32_t size)
+{
+    const uint8_t *bytes = data;
+    while (size > 0)
+    {
+        ssize_t written = write(emulator->fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            return;
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+static void emulatorFlush(Emulator *emulator)
+{
+    if (emulator->responseLength > 0)
+    {
+        emulatorWrite(emulator, emulator->response, emulator->responseLength);
+        emulator->responseLength = 0;
+    }
+}
+
+static void emulatorError(Emulator *emulator,
+                          int32_t error,
+                          const char *message,
+                          const char *argument)
+{
+    emulatorAppend(emulator, "E%04d %s '%s'\r\n", error, message, argument);
+}
+
+static void emulatorAppendSample(Emulator *emulator,
+                                 RBRInstrumentDateTime time)
+{
+    char formatted[32];
+    time_t seconds = (time_t) (time / 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    strftime(formatted, sizeof(formatted), "%Y-%m-%d %H:%M:%S", &utc);
+
+    emulatorAppend(emulator, "%s.%03d", formatted, (int) (time % 1000));
+    for (int32_t channel = 0; channel < emulator->channels; channel++)
+    {
+        emulatorAppend(emulator, ", %.4f", emulatorReading(channel, time));
+    }
+    emulatorAppend(emulator, "\r\n");
+}
+
+/* Parse “key = value, key = value” into parallel arrays of pointers into the
+ * (modified) argument string. */
+static int32_t emulatorParseAssignments(char *arguments,
+                                        char **keys,
+                                        char **values,
+                                        int32_t max)
+{
+    int32_t count = 0;
+    char *assignment = arguments;
+    while (assignment != NULL && *assignment != '\0' && count < max)
+    {
+        char *next = strchr(assignment, ',');
+        if (next != NULL)
+        {
+            *next++ = '\0';
+        }
+
+        char *equals = strchr(assignment, '=');
+        if (equals == NULL)
+        {
+            return -1;
+        }
+        *equals = '\0';
+
+        char *key = assignment + strspn(assignment, " ");
+        char *keyEnd = equals;
+        while (keyEnd > key && keyEnd[-1] == ' ')
+        {
+            *--keyEnd = '\0';
+        }
+
+        char *value = equals + 1 + strspn(equals + 1, " ");
+        char *valueEnd = value + strlen(value);
+        while (valueEnd > value && valueEnd[-1] == ' ')
+        {
+            *--valueEnd = '\0';
+        }
+
+        keys[count] = key;
+        values[count] = value;
+        ++count;
+        assignment = next;
+    }
+    return count;
+}
+
+static void emulatorAppendParameter(Emulator *emulator,
+                                    const EmulatorCommand *command,
+                                    const EmulatorParameter *parameter,
+                                    bool first)
+{
+    /* A parameter named after its command is the Logger2 single-value form,
+     * e.g., “link = usb”. */
+    if (strcmp(parameter->key, command->name) == 0)
+    {
+        emulatorAppend(emulator, " = %s", parameter->value);
+    }
+    else
+    {
+        emulatorAppend(emulator,
+                       "%s%s = %s",
+                       first ? " " : ", ",
+                       parameter->key,
+                       parameter->value);
+    }
+}
+
+static void emulatorGeneric(Emulator *emulator,
+                            EmulatorCommand *command,
+                            char *arguments)
+{
+    char *keys[EMULATOR_PARAMETERS_MAX];
+    char *values[EMULATOR_PARAMETERS_MAX];
+
+    /* Report everything. */
+    if (*arguments == '\0' || strcmp(arguments, "all") == 0)
+    {
+        emulatorAppend(emulator, "%s", command->name);
+        for (int32_t i = 0;
+             i < EMULATOR_PARAMETERS_MAX && command->parameters[i].key != NULL;
+             i++)
+        {
+            emulatorAppendParameter(emulator,
+                                    command,
+                                    &command->parameters[i],
+                                    i == 0);
+        }
+        emulatorAppend(emulator, "\r\n");
+        return;
+    }
+
+    /* Report only the named parameters. */
+    if (strchr(arguments, '=') == NULL)
+    {
+        int32_t count = 0;
+        for (char *key = strtok(arguments, " ");
+             key != NULL && count < EMULATOR_PARAMETERS_MAX;
+             key = strtok(NULL, " "))
+        {
+            if (emulatorFindParameter(command, key) == NULL)
+            {
+                emulatorError(emulator,
+                              108,
+                              "invalid argument to command:",
+                              key);
+                return;
+            }
+            keys[count++] = key;
+        }
+
+        emulatorAppend(emulator, "%s", command->name);
+        for (int32_t i = 0; i < count; i++)
+        {
+            emulatorAppendParameter(emulator,
+                                    command,
+                                    emulatorFindParameter(command, keys[i]),
+                                    i == 0);
+        }
+        emulatorAppend(emulator, "\r\n");
+        return;
+    }
+
+    /* Change the named parameters. */
+    int32_t count = emulatorParseAssignments(arguments,
+                                             keys,
+                                             values,
+                                             EMULATOR_PARAMETERS_MAX);
+    if (count <= 0)
+    {
+        emulatorError(emulator,
+                      108,
+                      "invalid argument to command:",
+                      arguments);
+        return;
+    }
+
+    for (int32_t i = 0; i < count; i++)
+    {
+        EmulatorParameter *parameter = emulatorFindParameter(command, keys[i]);
+        if (parameter == NULL || parameter->readOnly)
+        {
+            emulatorError(emulator,
+                          108,
+                          "invalid argument to command:",
+                          keys[i]);
+            return;
+        }
+    }
+
+    /* Real instruments won't let the schedule change under them. */
+    if (emulatorLogging(emulator)
+        && (strcmp(command->name, "sampling") == 0
+            || strcmp(command->name, "deployment") == 0
+            || strcmp(command->name, "memformat") == 0))
+    {
+        emulatorAppend(emulator,
+                       "E0105 command prohibited while logging\r\n");
+        return;
+    }
+
+    emulatorAppend(emulator, "%s", command->name);
+    for (int32_t i = 0; i < count; i++)
+    {
+        EmulatorParameter *parameter = emulatorFindParameter(command, keys[i]);
+        snprintf(parameter->value, EMULATOR_VALUE_MAX, "%s", values[i]);
+        emulatorAppendParameter(emulator, command, parameter, i == 0);
+    }
+    emulatorAppend(emulator, "\r\n");
+}
+
+static void emulatorSetStatus(Emulator *emulator,
+                              RBRInstrumentDeploymentStatus status)
+{
+    RBRInstrumentDateTime now = emulatorNow();
+
+    if (status == RBRINSTRUMENT_STATUS_LOGGING && !emulatorLogging(emulator))
+    {
+        if (emulator->memorySamples == 0)
+        {
+            emulator->memoryStart = now;
+        }
+        emulator->loggingStart = now;
+        emulator->lastStreamed = -1;
+    }
+    else if (status != RBRINSTRUMENT_STATUS_LOGGING
+             && emulatorLogging(emulator))
+    {
+        emulator->memorySamples = emulatorSampleCount(emulator, now);
+        emulator->loggingStart = -1;
+    }
+
+    emulatorSet("deployment",
+                "status",
+                RBRInstrumentDeploymentStatus_name(status));
+}
+
+static void emulatorStatusResponse(Emulator *emulator, const char *command)
+{
+    const char *status = emulatorGet("deployment", "status");
+    if (emulator->logger2)
+    {
+        emulatorAppend(emulator, "%s = %s\r\n", command, status);
+    }
+    else if (strcmp(command, "disable") == 0)
+    {
+        emulatorAppend(emulator, "%s status = %s\r\n", command, status);
+    }
+    else
+    {
+        emulatorAppend(emulator,
+                       "%s status = %s, warning = none\r\n",
+                       command,
+                       status);
+    }
+}
+
+static void emulatorEnable(Emulator *emulator,
+                           const char *command,
+                           char *arguments)
+{
+    bool verify = strcmp(command, "verify") == 0;
+    bool erase = strstr(arguments, "erasememory = true") != NULL;
+
+    if (emulatorLogging(emulator))
+    {
+        emulatorStatusResponse(emulator, command);
+        return;
+    }
+
+    if (emulator->memorySamples > 0 && !erase)
+    {
+        emulatorAppend(emulator, "E0402 memory not empty, erase first\r\n");
+        return;
+    }
+
+    if (verify)
+    {
+        /* The deployment always starts immediately, so verifying it
+         * reports what enabling it would. */
+        emulatorAppend(emulator,
+                       emulator->logger2
+                       ? "%s = logging\r\n"
+                       : "%s status = logging, warning = none\r\n",
+                       command);
+        return;
+    }
+
+    emulator->memorySamples = 0;
+    emulatorSetStatus(emulator, RBRINSTRUMENT_STATUS_LOGGING);
+    emulatorStatusResponse(emulator, command);
+}
+
+static void emulatorDisable(Emulator *emulator, const char *command)
+{
+    if (emulatorLogging(emulator))
+    {
+        emulatorSetStatus(emulator, RBRINSTRUMENT_STATUS_STOPPED);
+    }
+    emulatorStatusResponse(emulator, command);
+}
+
+static void emulatorChannels(Emulator *emulator)
+{
+    emulatorAppend(emulator,
+                   "channels count = %d, on = %d, settlingtime = 50, "
+                   "readtime = %d, minperiod = %s\r\n",
+                   (int) emulator->channels,
+                   (int) emulator->channels,
+                   (int) (30 * emulator->channels),
+                   emulatorGet("sampling", "userperiodlimit"));
+}
+
+static void emulatorChannel(Emulator *emulator, char *arguments)
+{
+    int32_t first = 0;
+    int32_t last = emulator->channels - 1;
+
+    /* Anything other than a channel index is treated as all channels. */
+    char *end;
+    long index = strtol(arguments, &end, 10);
+    if (end != arguments)
+    {
+        if (index < 1 || index > emulator->channels)
+        {
+            emulatorError(emulator,
+                          108,
+                          "invalid argument to command:",
+                          arguments);
+            return;
+        }
+        first = last = (int32_t) index - 1;
+    }
+
+    for (int32_t i = first; i <= last; i++)
+    {
+        const EmulatorChannel *channel = &channelTemplates[i];
+        emulatorAppend(emulator,
+                       "%schannel %d type = %s, module = %d, status = on, "
+                       "settlingtime = 50, readtime = 30, equation = %s, "
+                       "userunits = %s, gain = none, "
+                       "availablegains = none, derived = off, label = %s",
+                       (i == first) ? "" : " || ",
+                       (int) (i + 1),
+                       channel->type,
+                       (int) (i + 1),
+                       channel->equation,
+                       channel->units,
+                       channel->label);
+    }
+    emulatorAppend(emulator, "\r\n");
+}
+
+static void emulatorMeminfo(Emulator *emulator, char *arguments)
+{
+    char *keys[EMULATOR_PARAMETERS_MAX];
+    char *values[EMULATOR_PARAMETERS_MAX];
+    int32_t count = emulatorParseAssignments(arguments,
+                                             keys,
+                                             values,
+                                             EMULATOR_PARAMETERS_MAX);
+    if (count != 1 || strcmp(keys[0], "dataset") != 0)
+    {
+        emulatorError(emulator,
+                      108,
+                      "invalid argument to command:",
+                      arguments);
+        return;
+    }
+
+    int32_t dataset = strtol(values[0], NULL, 10);
+    int32_t used = 0;
+    if (dataset == RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA)
+    {
+        used = emulatorSampleCount(emulator, emulatorNow())
+               * emulatorSampleSize(emulator);
+    }
+
+    emulatorAppend(emulator,
+                   "meminfo dataset = %d, used = %d, remaining = %d, "
+                   "size = %d\r\n",
+                   (int) dataset,
+                   (int) used,
+                   (int) (EMULATOR_MEMORY_SIZE - used),
+                   (int) EMULATOR_MEMORY_SIZE);
+}
+
+static uint16_t emulatorCrc(const uint8_t *data, int32_t size)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (int32_t i = 0; i < size; i++)
+    {
+        for (int j = 7; j >= 0; j--)
+        {
+            bool bit = (data[i] >> j) & 1;
+            bool c15 = (crc >> 15) & 1;
+            crc <<= 1;
+            if (c15 ^ bit)
+            {
+                crc ^= 0x1021;
+            }
+        }
+    }
+
+    return crc;
+}
+
+static void emulatorReadData(Emulator *emulator,
+                             int32_t dataset,
+                             int32_t size,
+                             int32_t offset)
+{
+    static uint8_t data[EMULATOR_READDATA_MAX];
+
+    int32_t sampleSize = emulatorSampleSize(emulator);
+    int32_t used = 0;
+    if (dataset == RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA)
+    {
+        used = emulatorSampleCount(emulator, emulatorNow()) * sampleSize;
+    }
+
+    if (size < 0 || offset < 0 || offset > used)
+    {
+        emulatorAppend(emulator,
+                       "E0108 invalid argument to command: 'readdata'\r\n");
+        return;
+    }
+    if (size > EMULATOR_READDATA_MAX)
+    {
+        size = EMULATOR_READDATA_MAX;
+    }
+    if (size > used - offset)
+    {
+        size = used - offset;
+    }
+
+    int32_t period = emulatorPeriod();
+    for (int32_t i = 0; i < size; i++)
+    {
+        int32_t sample = (offset + i) / sampleSize;
+        int32_t within = (offset + i) % sampleSize;
+
+        /* Regenerating the whole sample for every byte is wasteful, but keeps
+         * partial samples at either end of the read simple. */
+        uint8_t bytes[EMULATOR_TIMESTAMP_SIZE
+                      + EMULATOR_READING_SIZE * EMULATOR_CHANNELS_MAX];
+        RBRInstrumentDateTime time = emulator->memoryStart
+                                     + (RBRInstrumentDateTime) sample * period;
+        memcpy(bytes, &time, EMULATOR_TIMESTAMP_SIZE);
+        for (int32_t channel = 0; channel < emulator->channels; channel++)
+        {
+            float reading = (float) emulatorReading(channel, time);
+            memcpy(bytes
+                   + EMULATOR_TIMESTAMP_SIZE
+                   + channel * EMULATOR_READING_SIZE,
+                   &reading,
+                   EMULATOR_READING_SIZE);
+        }
+        data[i] = bytes[within];
+    }
+
+    if (emulator->logger2)
+    {
+        emulatorAppend(emulator,
+                       "data %d %d %d\r\n",
+                       (int) dataset,
+                       (int) size,
+                       (int) offset);
+    }
+    else
+    {
+        emulatorAppend(emulator,
+                       "readdata dataset = %d, size = %d, offset = %d\r\n",
+                       (int) dataset,
+                       (int) size,
+                       (int) offset);
+    }
+    emulatorFlush(emulator);
+
+    uint16_t crc = emulatorCrc(data, size);
+    uint8_t crcBytes[2] = {crc >> 8, crc & 0xFF};
+    emulatorWrite(emulator, data, size);
+    emulatorWrite(emulator, crcBytes, sizeof(crcBytes));
+}
+
+static void emulatorReadDataL3(Emulator *emulator, char *arguments)
+{
+    char *keys[EMULATOR_PARAMETERS_MAX];
+    char *values[EMULATOR_PARAMETERS_MAX];
+    int32_t count = emulatorParseAssignments(arguments,
+                                             keys,
+                                             values,
+                                             EMULATOR_PARAMETERS_MAX);
+    int32_t dataset = -1;
+    int32_t size = -1;
+    int32_t offset = -1;
+    for (int32_t i = 0; i < count; i++)
+    {
+        int32_t value = strtol(values[i], NULL, 10);
+        if (strcmp(keys[i], "dataset") == 0)
+        {
+            dataset = value;
+        }
+        else if (strcmp(keys[i], "size") == 0)
+        {
+            size = value;
+        }
+        else if (strcmp(keys[i], "offset") == 0)
+        {
+            offset = value;
+        }
+    }
+
+    emulatorReadData(emulator, dataset, size, offset);
+}
+
+static void emulatorReadDataL2(Emulator *emulator, char *arguments)
+{
+    int dataset;
+    int size;
+    int offset;
+    if (sscanf(arguments, "data %d %d %d", &dataset, &size, &offset) != 3)
+    {
+        emulatorError(emulator,
+                      108,
+                      "invalid argument to command:",
+                      arguments);
+        return;
+    }
+
+    emulatorReadData(emulator, dataset, size, offset);
+}
+
+static void emulatorFetch(Emulator *emulator, char *arguments)
+{
+    emulatorAppend(emulator, "fetch %s\r\n",
+                   (*arguments != '\0') ? arguments : "sleepafter = true");
+    emulatorAppendSample(emulator, emulatorNow());
+}
+
+static void emulatorClock(Emulator *emulator, char *arguments)
+{
+    /* The emulated clock always follows the host clock, so setting it is
+     * acknowledged but has no effect. */
+    if (strchr(arguments, '=') != NULL)
+    {
+        emulatorAppend(emulator, "clock %s\r\n", arguments);
+        return;
+    }
+
+    char formatted[16];
+    time_t seconds = (time_t) (emulatorNow() / 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    strftime(formatted, sizeof(formatted), "%Y%m%d%H%M%S", &utc);
+    emulatorAppend(emulator,
+                   "clock datetime = %s, offsetfromutc = unknown\r\n",
+                   formatted);
+}
+
+static void emulatorCommand(Emulator *emulator, char *line)
+{
+    char *arguments = line + strcspn(line, " ");
+    if (*arguments != '\0')
+    {
+        *arguments++ = '\0';
+        arguments += strspn(arguments, " ");
+    }
+    const char *name = line;
+
+    if (strcmp(name, "sleep") == 0)
+    {
+        /* No response; the instrument just goes to sleep. */
+        return;
+    }
+
+    if (emulator->latency > 0)
+    {
+        emulatorSleep(emulator->latency);
+    }
+
+    EmulatorCommand *command;
+    if (strcmp(name, "channels") == 0)
+    {
+        emulatorChannels(emulator);
+    }
+    else if (strcmp(name, "channel") == 0)
+    {
+        emulatorChannel(emulator, arguments);
+    }
+    else if (strcmp(name, "enable") == 0 || strcmp(name, "verify") == 0)
+    {
+        emulatorEnable(emulator, name, arguments);
+    }
+    else if ((strcmp(name, "disable") == 0 && !emulator->logger2)
+             || (strcmp(name, "stop") == 0 && emulator->logger2))
+    {
+        emulatorDisable(emulator, name);
+    }
+    else if (strcmp(name, "memclear") == 0)
+    {
+        if (emulatorLogging(emulator))
+        {
+            emulatorAppend(emulator,
+                           "E0105 command prohibited while logging\r\n");
+        }
+        else
+        {
+            emulator->memorySamples = 0;
+            emulatorAppend(emulator, "memclear\r\n");
+        }
+    }
+    else if (strcmp(name, "meminfo") == 0)
+    {
+        emulatorMeminfo(emulator, arguments);
+    }
+    else if (strcmp(name, "readdata") == 0 && !emulator->logger2)
+    {
+        emulatorReadDataL3(emulator, arguments);
+    }
+    else if (strcmp(name, "read") == 0 && emulator->logger2)
+    {
+        emulatorReadDataL2(emulator, arguments);
+    }
+    else if (strcmp(name, "fetch") == 0)
+    {
+        emulatorFetch(emulator, arguments);
+    }
+    else if (strcmp(name, "clock") == 0)
+    {
+        emulatorClock(emulator, arguments);
+    }
+    else if (strcmp(name, "permit") == 0)
+    {
+        emulatorAppend(emulator, "permit %s\r\n", arguments);
+    }
+    else if ((command = emulatorFindCommand(name)) != NULL)
+    {
+        emulatorGeneric(emulator, command, arguments);
+    }
+    else
+    {
+        emulatorError(emulator, 102, "invalid command", name);
+    }
+
+    emulatorFlush(emulator);
+}
+
+static void emulatorStream(Emulator *emulator)
+{
+    if (!emulatorLogging(emulator)
+        || (strcmp(emulatorGet("streamusb", "state"), "on") != 0
+            && strcmp(emulatorGet("streamserial", "state"), "on") != 0))
+    {
+        return;
+    }
+
+    RBRInstrumentDateTime now = emulatorNow();
+    int32_t period = emulatorPeriod();
+    int64_t sample = (now - emulator->loggingStart) / period;
+    if (sample <= emulator->lastStreamed)
+    {
+        return;
+    }
+
+    /* If we fell behind, skip ahead rather than flooding the port. */
+    emulator->lastStreamed = sample;
+    emulatorAppendSample(emulator,
+                         emulator->loggingStart
+                         + (RBRInstrumentDateTime) sample * period);
+    emulatorFlush(emulator);
+}
+
+static int32_t emulatorStreamWait(const Emulator *emulator)
+{
+    if (!emulatorLogging(emulator))
+    {
+        return 1000;
+    }
+
+    int32_t period = emulatorPeriod();
+    RBRInstrumentDateTime elapsed = emulatorNow() - emulator->loggingStart;
+    return period - (int32_t) (elapsed % period);
+}
+
+static int openPseudoTerminal(char **slavePath, int *slaveFd)
+{
+    int masterFd;
+    if ((masterFd = posix_openpt(O_RDWR | O_NOCTTY)) < 0)
+    {
+        return -1;
+    }
+
+    if (grantpt(masterFd) != 0
+        || unlockpt(masterFd) != 0
+        || (*slavePath = ptsname(masterFd)) == NULL)
+    {
+        close(masterFd);
+        return -1;
+    }
+
+    /* Holding the slave open keeps the master readable between clients, and
+     * lets us put the line into raw mode before anyone connects. */
+    if ((*slaveFd = open(*slavePath, O_RDWR | O_NOCTTY)) < 0)
+    {
+        close(masterFd);
+        return -1;
+    }
+
+    struct termios settings;
+    if (tcgetattr(*slaveFd, &settings) == 0)
+    {
+        settings.c_iflag = 0;
+        settings.c_oflag = 0;
+        settings.c_lflag = 0;
+        settings.c_cflag |= CS8 | CLOCAL | CREAD;
+        tcsetattr(*slaveFd, TCSANOW, &settings);
+    }
+
+    return masterFd;
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    int32_t period = 1000;
+    int32_t preloaded = 1000;
+    int option;
+
+    Emulator emulator = {
+        .fd = -1,
+        .logger2 = false,
+        .channels = 3,
+        .latency = 0,
+        .loggingStart = -1,
+        .lastStreamed = -1
+    };
+
+    while ((option = getopt(argc, argv, "2c:l:m:p:")) != -1)
+    {
+        switch (option)
+        {
+        case '2':
+            emulator.logger2 = true;
+            break;
+        case 'c':
+            emulator.channels = strtol(optarg, NULL, 10);
+            break;
+        case 'l':
+            emulator.latency = strtol(optarg, NULL, 10);
+            break;
+        case 'm':
+            preloaded = strtol(optarg, NULL, 10);
+            break;
+        case 'p':
+            period = strtol(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-2] [-c channels] [-l latency] [-m samples]"
+                    " [-p period]\n"
+                    "\n"
+                    "  -2  emulate a Logger2 instrument\n"
+                    "  -c  number of channels, 1-%d (default 3)\n"
+                    "  -l  response latency in milliseconds (default 0)\n"
+                    "  -m  samples already in memory (default 1000)\n"
+                    "  -p  sampling period in milliseconds (default 1000)\n",
+                    programName,
+                    EMULATOR_CHANNELS_MAX);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (emulator.channels < 1
+        || emulator.channels > EMULATOR_CHANNELS_MAX
+        || emulator.latency < 0
+        || preloaded < 0
+        || period <= 0)
+    {
+        fprintf(stderr, "%s: Invalid option value!\n", programName);
+        return EXIT_FAILURE;
+    }
+
+    char value[EMULATOR_VALUE_MAX];
+    snprintf(value, sizeof(value), "%d", (int) period);
+    emulatorSet("sampling", "period", value);
+
+    char *channelsList = emulatorGet("outputformat", "channelslist");
+    char *labelsList = emulatorGet("outputformat", "labelslist");
+    for (int32_t i = 0; i < emulator.channels; i++)
+    {
+        int32_t length = strlen(channelsList);
+        snprintf(channelsList + length,
+                 EMULATOR_VALUE_MAX - length,
+                 "%s%s(%s)",
+                 (i == 0) ? "" : "|",
+                 channelTemplates[i].label,
+                 channelTemplates[i].units);
+        length = strlen(labelsList);
+        snprintf(labelsList + length,
+                 EMULATOR_VALUE_MAX - length,
+                 "%s%s",
+                 (i == 0) ? "" : "|",
+                 channelTemplates[i].label);
+    }
+
+    if (emulator.logger2)
+    {
+        emulatorSet("id", "model", "RBRconcerto");
+        emulatorSet("id", "version", "1.440");
+        emulatorSet("id", "fwtype", "103");
+        emulatorFindCommand("link")->parameters[0].key = "link";
+    }
+
+    /* Pretend the instrument has already been logging for a while. */
+    emulator.memorySamples = preloaded;
+    emulator.memoryStart = emulatorNow() - (RBRInstrumentDateTime) preloaded
+                           * period;
+
+    char *slavePath;
+    int slaveFd;
+    if ((emulator.fd = openPseudoTerminal(&slavePath, &slaveFd)) < 0)
+    {
+        fprintf(stderr, "%s: Failed to open pseudo-terminal: %s!\n",
+                programName,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    printf("%s\n", slavePath);
+    fflush(stdout);
+
+    char line[EMULATOR_LINE_MAX];
+    int32_t lineLength = 0;
+    while (true)
+    {
+        int32_t wait = emulatorStreamWait(&emulator);
+        struct timeval timeout = {
+            .tv_sec  =  wait / 1000,
+            .tv_usec = (wait % 1000) * 1000
+        };
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(emulator.fd, &fds);
+        int ready = select(emulator.fd + 1, &fds, NULL, NULL, &timeout);
+        if (ready < 0 && errno != EINTR)
+        {
+            fprintf(stderr, "%s: select failed: %s!\n",
+                    programName,
+                    strerror(errno));
+            break;
+        }
+
+        if (ready > 0)
+        {
+            uint8_t buffer[256];
+            ssize_t length = read(emulator.fd, buffer, sizeof(buffer));
+            if (length < 0 && errno != EINTR && errno != EAGAIN)
+            {
+                fprintf(stderr, "%s: read failed: %s!\n",
+                        programName,
+                        strerror(errno));
+                break;
+            }
+
+            for (ssize_t i = 0; i < length; i++)
+            {
+                if (buffer[i] == '\r' || buffer[i] == '\n')
+                {
+                    line[lineLength] = '\0';
+                    /* Blank lines are just wake sequences. */
+                    if (lineLength > 0)
+                    {
+                        emulatorCommand(&emulator, line);
+                    }
+                    lineLength = 0;
+                }
+                else if (lineLength < EMULATOR_LINE_MAX - 1)
+                {
+                    line[lineLength++] = buffer[i];
+                }
+            }
+        }
+
+        emulatorStream(&emulator);
+    }
+
+    close(slaveFd);
+    close(emulator.fd);
+    return EXIT_FAILURE;
+}
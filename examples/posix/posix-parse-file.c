@@ -16,7 +16,9 @@
 #include <errno.h>
 /* Required for open. */
 #include <fcntl.h>
-/* Required for open. */
+/* Required for mmap, munmap, posix_madvise. */
+#include <sys/mman.h>
+/* Required for fstat, open, struct stat. */
 #include <sys/stat.h>
 /* Required for fprintf, printf. */
 #include <stdio.h>
@@ -53,32 +55,198 @@ RBRInstrumentError parserSample(
     return RBRINSTRUMENT_SUCCESS;
 }
 
+RBRInstrumentError parserEvent(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentEvent *const event)
+{
+    /* Unused. */
+    (void) parser;
+
+    char ftime[128];
+    time_t eventSeconds = (time_t) (event->timestamp / 1000);
+    struct tm eventTime;
+    gmtime_r(&eventSeconds, &eventTime);
+    strftime(ftime, sizeof(ftime), "%F %T", &eventTime);
+
+    printf("# %s.%03" PRIi64 ", %s\n",
+           ftime,
+           event->timestamp % 1000,
+           RBRInstrumentEventType_name(event->type));
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/**
+ * \brief Map a whole file into memory for reading.
+ *
+ * \return 0 on success, or -1 with an explanation printed on failure
+ */
+static int mapFile(const char *programName,
+                   const char *path,
+                   void **data,
+                   int64_t *size)
+{
+    int fd;
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        fprintf(stderr, "%s: Failed to open %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+        return -1;
+    }
+
+    int result = -1;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0)
+    {
+        fprintf(stderr, "%s: Failed to stat %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+    }
+    else if ((*size = fileStat.st_size) == 0)
+    {
+        /* Nothing to map, but nothing wrong, either. */
+        *data = NULL;
+        result = 0;
+    }
+    else if ((*data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0))
+             == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: Failed to map %s: %s!\n",
+                programName,
+                path,
+                strerror(errno));
+    }
+    else
+    {
+        /* Purely advisory: read ahead aggressively and drop pages behind
+         * us. */
+        posix_madvise(*data, *size, POSIX_MADV_SEQUENTIAL);
+        result = 0;
+    }
+
+    /* The mapping outlives the descriptor. */
+    close(fd);
+    return result;
+}
+
+static void unmapFile(void *data, int64_t size)
+{
+    if (size > 0)
+    {
+        munmap(data, size);
+    }
+}
+
+/**
+ * \brief Read parser configuration from a deployment header dataset file.
+ *
+ * \return 0 on success, or -1 with an explanation printed on failure
+ */
+static int readDeploymentHeader(const char *programName,
+                                const char *headerPath,
+                                RBRParserConfig *config)
+{
+    void *data;
+    int64_t headerSize;
+    if (mapFile(programName, headerPath, &data, &headerSize) < 0)
+    {
+        return -1;
+    }
+    else if (headerSize > INT32_MAX)
+    {
+        fprintf(stderr, "%s: Deployment header is too large!\n",
+                programName);
+        unmapFile(data, headerSize);
+        return -1;
+    }
+
+    RBRParserDeploymentHeader header;
+    memset(&header, 0, sizeof(header));
+    int32_t size = headerSize;
+    RBRInstrumentError err;
+    if ((err = RBRParser_parseDeploymentHeader(data, &size, &header))
+        != RBRINSTRUMENT_SUCCESS
+        || (err = RBRParserDeploymentHeader_getConfig(&header, config))
+        != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to parse deployment header: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        unmapFile(data, headerSize);
+        return -1;
+    }
+
+    fprintf(stderr,
+            "%s: %s %" PRIu32 ", %" PRIi32 " channels every %" PRIi32 "ms.\n",
+            programName,
+            header.id.model,
+            header.id.serial,
+            config->formatConfig.easyParse.channels,
+            header.period);
+    unmapFile(data, headerSize);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     char *programName = argv[0];
     char *filePath;
-    int32_t channels;
+    char *eventsPath = NULL;
 
     int status = EXIT_SUCCESS;
-    int datasetFd;
 
     if (argc < 3)
     {
-        fprintf(stderr, "Usage: %s file channels\n", argv[0]);
+        fprintf(stderr,
+                "Usage: %s file channels|header-file [events-file]\n"
+                "\n"
+                "Instead of a channel count, a deployment header (dataset 2)"
+                " may be given.\n"
+                "If an events file (dataset 0) is given, events are printed"
+                " among the samples.\n",
+                argv[0]);
         return EXIT_FAILURE;
     }
 
     filePath = argv[1];
-    channels = strtol(argv[2], NULL, 10);
+    if (argc > 3)
+    {
+        eventsPath = argv[3];
+    }
 
-    if ((datasetFd = open(filePath, O_RDONLY)) < 0)
+    RBRParserConfig parserConfig = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00
+    };
+    char *channelsEnd;
+    parserConfig.formatConfig.easyParse.channels = strtol(argv[2],
+                                                          &channelsEnd,
+                                                          10);
+    if (*channelsEnd != '\0'
+        && readDeploymentHeader(programName, argv[2], &parserConfig) < 0)
     {
-        fprintf(stderr, "%s: Failed to open file: %s!\n",
-                programName,
-                strerror(errno));
         return EXIT_FAILURE;
     }
 
+    /* Map the whole dataset and let the parser walk it in place. */
+    void *dataset;
+    int64_t datasetSize;
+    if (mapFile(programName, filePath, &dataset, &datasetSize) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    void *events = NULL;
+    int64_t eventsSize = 0;
+    if (eventsPath != NULL
+        && mapFile(programName, eventsPath, &events, &eventsSize) < 0)
+    {
+        status = EXIT_FAILURE;
+        goto datasetCleanup;
+    }
+
     fprintf(stderr,
             "%s: Using %s v%s (built %s).\n",
             programName,
@@ -89,18 +257,12 @@ int main(int argc, char *argv[])
     RBRParser *parser = NULL;
 
     RBRInstrumentSample sampleBuffer;
+    RBRInstrumentEvent eventBuffer;
     RBRParserCallbacks parserCallbacks = {
         .sample = parserSample,
-        .sampleBuffer = &sampleBuffer
-    };
-
-    RBRParserConfig parserConfig = {
-        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
-        .formatConfig = {
-            .easyParse = {
-                .channels = channels
-            }
-        }
+        .sampleBuffer = &sampleBuffer,
+        .event = parserEvent,
+        .eventBuffer = &eventBuffer
     };
 
     RBRInstrumentError err;
@@ -114,45 +276,50 @@ int main(int argc, char *argv[])
                 programName,
                 RBRInstrumentError_name(err));
         status = EXIT_FAILURE;
-        goto fileCleanup;
-    }
-
-    uint8_t buf[1024];
-    int32_t bufSize = 0;
-    int32_t readSize;
-    int32_t parsedSize;
-
-    while (true)
-    {
-        readSize = read(datasetFd, buf + bufSize, sizeof(buf) - bufSize);
-        if (readSize < 0 && errno == EAGAIN)
-        {
-            fprintf(stderr, "\nRetrying...\n");
-            continue;
-        }
-        else if (readSize < 0)
-        {
-            printf("\nError: %s", strerror(errno));
-            break;
-        }
-        else if (readSize == 0)
-        {
-            break;
-        }
-
-        bufSize += readSize;
-        parsedSize = bufSize;
-        RBRParser_parse(parser,
-                        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
-                        buf,
-                        &parsedSize);
-        bufSize -= parsedSize;
-        memmove(buf, buf + parsedSize, bufSize);
+        goto eventsCleanup;
+    }
+
+    int64_t parsedSize = datasetSize;
+    int64_t parsedEventsSize = eventsSize;
+    if (eventsPath != NULL)
+    {
+        /* Both datasets are here in their entirety, so they can be merged in
+         * one go. */
+        err = RBRParser_parseMerged(parser,
+                                    events,
+                                    &parsedEventsSize,
+                                    dataset,
+                                    &parsedSize,
+                                    true);
+    }
+    else
+    {
+        err = RBRParser_parseBuffer(
+            parser,
+            RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+            dataset,
+            &parsedSize);
+    }
+
+    if (err != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to parse file: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+    }
+    else if (parsedSize < datasetSize || parsedEventsSize < eventsSize)
+    {
+        fprintf(stderr, "%s: Ignored %" PRIi64 " trailing bytes.\n",
+                programName,
+                (datasetSize - parsedSize) + (eventsSize - parsedEventsSize));
     }
 
     RBRParser_destroy(parser);
-fileCleanup:
-    close(datasetFd);
+eventsCleanup:
+    unmapFile(events, eventsSize);
+datasetCleanup:
+    unmapFile(dataset, datasetSize);
 
     return status;
 }
@@ -0,0 +1,456 @@
+/**
+ * \file posix-parse-parallel.c
+ *
+ * \brief Example of using the library to parse a large EasyParse sample
+ * dataset on several threads at once in a POSIX environment.
+ *
+ * The file is memory-mapped and divided at record boundaries with
+ * RBRParser_splitBuffer(). Each worker thread has its own parser and decodes
+ * its chunk with RBRParser_parseColumns(). Once all workers have finished,
+ * samples are printed in the same format as posix-parse-file, in timestamp
+ * order.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for clock_gettime, gmtime_r in time.h. */
+#define _POSIX_C_SOURCE 200112L
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for open. */
+#include <fcntl.h>
+/* Required for pthread_create, pthread_join, pthread_t. */
+#include <pthread.h>
+/* Required for fprintf, printf. */
+#include <stdio.h>
+/* Required for EXIT_FAILURE, EXIT_SUCCESS, calloc, free, malloc, qsort,
+ * strtol. */
+#include <stdlib.h>
+/* Required for strerror. */
+#include <string.h>
+/* Required for mmap, munmap, posix_madvise. */
+#include <sys/mman.h>
+/* Required for fstat, open, struct stat. */
+#include <sys/stat.h>
+/* Required for clock_gettime, gmtime_r, strftime, time_t. */
+#include <time.h>
+/* Required for close, sysconf. */
+#include <unistd.h>
+
+#include "RBRParser.h"
+
+/** \brief The most worker threads to start. */
+#define THREADS_MAX 64
+
+typedef struct ParseChunk
+{
+    /** \brief This worker's parser; parsers can't be shared. */
+    RBRParser parser;
+    /** \brief The start of this chunk of the dataset. */
+    const uint8_t *data;
+    /** \brief The size of this chunk of the dataset. */
+    int64_t size;
+    /** \brief Where the chunk is decoded to. */
+    RBRParserColumns columns;
+    /** \brief The outcome of decoding. */
+    RBRInstrumentError err;
+} ParseChunk;
+
+/**
+ * \brief A sample's position in the decoded chunks, keyed by timestamp.
+ *
+ * Only used to reorder samples when the dataset wasn't already in timestamp
+ * order.
+ */
+typedef struct SampleOrder
+{
+    RBRInstrumentDateTime timestamp;
+    int32_t chunk;
+    int32_t sample;
+} SampleOrder;
+
+static int64_t now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+static void *parseChunk(void *arg)
+{
+    ParseChunk *chunk = arg;
+    int32_t recordSize;
+    RBRParser_getRecordSize(&chunk->parser,
+                            RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                            &recordSize);
+
+    /* Chunks can be larger than RBRParser_parseColumns() will take at once,
+     * so work through them in windows which end on record boundaries. */
+    int32_t windowMax = INT32_MAX - INT32_MAX % recordSize;
+    int64_t offset = 0;
+    chunk->err = RBRINSTRUMENT_SUCCESS;
+    while (offset < chunk->size)
+    {
+        int32_t size = windowMax;
+        if (chunk->size - offset < size)
+        {
+            size = (int32_t) (chunk->size - offset);
+        }
+
+        chunk->err = RBRParser_parseColumns(&chunk->parser,
+                                            chunk->data + offset,
+                                            &size,
+                                            &chunk->columns);
+        if (chunk->err != RBRINSTRUMENT_SUCCESS || size == 0)
+        {
+            break;
+        }
+        offset += size;
+    }
+
+    return NULL;
+}
+
+static int compareSampleOrder(const void *a, const void *b)
+{
+    const SampleOrder *x = a;
+    const SampleOrder *y = b;
+
+    /* Samples with the same timestamp keep their order in the dataset. */
+    if (x->timestamp != y->timestamp)
+    {
+        return (x->timestamp < y->timestamp) ? -1 : 1;
+    }
+    else if (x->chunk != y->chunk)
+    {
+        return (x->chunk < y->chunk) ? -1 : 1;
+    }
+    return (x->sample > y->sample) - (x->sample < y->sample);
+}
+
+static void printSample(const RBRParserColumns *columns,
+                        int32_t channels,
+                        int32_t sample)
+{
+    char ftime[128];
+    RBRInstrumentDateTime timestamp = columns->timestamps[sample];
+    time_t sampleSeconds = (time_t) (timestamp / 1000);
+    struct tm sampleTime;
+    gmtime_r(&sampleSeconds, &sampleTime);
+    strftime(ftime, sizeof(ftime), "%F %T", &sampleTime);
+
+    printf("%s.%03" PRIi64, ftime, timestamp % 1000);
+    for (int32_t channel = 0; channel < channels; channel++)
+    {
+        printf(", %lf", (double) columns->floatReadings[channel][sample]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    char *filePath;
+    int32_t channels;
+    int32_t threads;
+
+    int status = EXIT_SUCCESS;
+    int datasetFd;
+
+    if (argc < 3)
+    {
+        fprintf(stderr,
+                "Usage: %s file channels [threads]\n"
+                "\n"
+                "By default, one thread is started for each online CPU.\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    filePath = argv[1];
+    channels = strtol(argv[2], NULL, 10);
+    if (argc > 3)
+    {
+        threads = strtol(argv[3], NULL, 10);
+    }
+    else
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    else if (threads > THREADS_MAX)
+    {
+        threads = THREADS_MAX;
+    }
+
+    if ((datasetFd = open(filePath, O_RDONLY)) < 0)
+    {
+        fprintf(stderr, "%s: Failed to open file: %s!\n",
+                programName,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr,
+            "%s: Using %s v%s (built %s).\n",
+            programName,
+            RBRINSTRUMENT_LIB_NAME,
+            RBRINSTRUMENT_LIB_VERSION,
+            RBRINSTRUMENT_LIB_BUILD_DATE);
+
+    RBRParserCallbacks parserCallbacks = {0};
+    RBRParserConfig parserConfig = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+        .formatConfig = {
+            .easyParse = {
+                .channels = channels
+            }
+        }
+    };
+
+    ParseChunk *chunks;
+    if ((chunks = calloc(threads, sizeof(ParseChunk))) == NULL)
+    {
+        fprintf(stderr, "%s: Failed to allocate memory!\n", programName);
+        status = EXIT_FAILURE;
+        goto fileCleanup;
+    }
+
+    RBRInstrumentError err;
+    for (int32_t i = 0; i < threads; i++)
+    {
+        RBRParser *parser = &chunks[i].parser;
+        if ((err = RBRParser_init(
+                 &parser,
+                 &parserCallbacks,
+                 &parserConfig,
+                 NULL)) != RBRINSTRUMENT_SUCCESS)
+        {
+            fprintf(stderr, "%s: Failed to initialize parser: %s!\n",
+                    programName,
+                    RBRInstrumentError_name(err));
+            status = EXIT_FAILURE;
+            goto chunksCleanup;
+        }
+    }
+
+    struct stat datasetStat;
+    if (fstat(datasetFd, &datasetStat) < 0)
+    {
+        fprintf(stderr, "%s: Failed to stat file: %s!\n",
+                programName,
+                strerror(errno));
+        status = EXIT_FAILURE;
+        goto chunksCleanup;
+    }
+    else if (datasetStat.st_size == 0)
+    {
+        goto chunksCleanup;
+    }
+
+    uint8_t *dataset = mmap(NULL,
+                            datasetStat.st_size,
+                            PROT_READ,
+                            MAP_PRIVATE,
+                            datasetFd,
+                            0);
+    if (dataset == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: Failed to map file: %s!\n",
+                programName,
+                strerror(errno));
+        status = EXIT_FAILURE;
+        goto chunksCleanup;
+    }
+    /* Each worker reads its own chunk front to back. */
+    posix_madvise(dataset, datasetStat.st_size, POSIX_MADV_SEQUENTIAL);
+
+    int64_t boundaries[THREADS_MAX + 1];
+    RBRParser_splitBuffer(&chunks[0].parser,
+                          RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                          datasetStat.st_size,
+                          threads,
+                          boundaries);
+    if (boundaries[threads] < datasetStat.st_size)
+    {
+        fprintf(stderr, "%s: Ignoring %" PRIi64 " trailing bytes.\n",
+                programName,
+                (int64_t) datasetStat.st_size - boundaries[threads]);
+    }
+
+    int32_t recordSize;
+    RBRParser_getRecordSize(&chunks[0].parser,
+                            RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                            &recordSize);
+    for (int32_t i = 0; i < threads; i++)
+    {
+        ParseChunk *chunk = &chunks[i];
+        chunk->data = dataset + boundaries[i];
+        chunk->size = boundaries[i + 1] - boundaries[i];
+
+        int64_t samples = chunk->size / recordSize;
+        if (samples > INT32_MAX)
+        {
+            fprintf(stderr, "%s: File too large; try more threads.\n",
+                    programName);
+            status = EXIT_FAILURE;
+            goto columnsCleanup;
+        }
+
+        /* Readings are decoded as floats: that's how EasyParse stores
+         * them, and it halves the memory needed. */
+        chunk->columns.capacity = samples;
+        chunk->columns.timestamps = malloc(sizeof(RBRInstrumentDateTime)
+                                           * (samples + 1));
+        float *readings = malloc(sizeof(float) * channels * (samples + 1));
+        if (chunk->columns.timestamps == NULL || readings == NULL)
+        {
+            free(readings);
+            fprintf(stderr, "%s: Failed to allocate memory!\n", programName);
+            status = EXIT_FAILURE;
+            goto columnsCleanup;
+        }
+        for (int32_t channel = 0; channel < channels; channel++)
+        {
+            chunk->columns.floatReadings[channel] = readings
+                                                    + channel * samples;
+        }
+    }
+
+    int64_t start = now();
+
+    pthread_t workers[THREADS_MAX];
+    int32_t started;
+    for (started = 0; started < threads; started++)
+    {
+        if ((errno = pthread_create(&workers[started],
+                                    NULL,
+                                    parseChunk,
+                                    &chunks[started])) != 0)
+        {
+            fprintf(stderr, "%s: Failed to start thread: %s!\n",
+                    programName,
+                    strerror(errno));
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+    for (int32_t i = 0; i < started; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    if (status != EXIT_SUCCESS)
+    {
+        goto columnsCleanup;
+    }
+
+    /* Find out whether the dataset is already in timestamp order: within
+     * each chunk, the parser counted for us; between chunks, compare the
+     * last sample of each with the first sample of the next. */
+    int64_t samples = 0;
+    int64_t unordered = 0;
+    RBRInstrumentDateTime previous = INT64_MIN;
+    for (int32_t i = 0; i < threads; i++)
+    {
+        ParseChunk *chunk = &chunks[i];
+        if (chunk->err != RBRINSTRUMENT_SUCCESS)
+        {
+            fprintf(stderr, "%s: Failed to parse file: %s!\n",
+                    programName,
+                    RBRInstrumentError_name(chunk->err));
+            status = EXIT_FAILURE;
+            goto columnsCleanup;
+        }
+        else if (chunk->columns.length == 0)
+        {
+            continue;
+        }
+
+        samples += chunk->columns.length;
+        unordered += chunk->columns.unorderedTimestamps;
+        unordered += chunk->columns.timestamps[0] < previous;
+        previous = chunk->columns.timestamps[chunk->columns.length - 1];
+    }
+
+    fprintf(stderr,
+            "%s: Decoded %" PRIi64 " samples on %" PRIi32 " threads"
+            " in %.1f ms.\n",
+            programName,
+            samples,
+            threads,
+            (now() - start) / 1000000.0);
+
+    if (unordered == 0)
+    {
+        /* Already in order; the chunks can simply be printed in turn. */
+        for (int32_t i = 0; i < threads; i++)
+        {
+            for (int32_t sample = 0;
+                 sample < chunks[i].columns.length;
+                 sample++)
+            {
+                printSample(&chunks[i].columns, channels, sample);
+            }
+        }
+        goto columnsCleanup;
+    }
+
+    /* Probably an instrument clock change. Sort the samples, keeping any
+     * with the same timestamp in dataset order so the output doesn't depend
+     * on how many threads were used. */
+    fprintf(stderr, "%s: Sorting %" PRIi64 " out-of-order samples.\n",
+            programName,
+            unordered);
+
+    SampleOrder *order;
+    if ((order = malloc(sizeof(SampleOrder) * samples)) == NULL)
+    {
+        fprintf(stderr, "%s: Failed to allocate memory!\n", programName);
+        status = EXIT_FAILURE;
+        goto columnsCleanup;
+    }
+    int64_t position = 0;
+    for (int32_t i = 0; i < threads; i++)
+    {
+        for (int32_t sample = 0; sample < chunks[i].columns.length; sample++)
+        {
+            order[position++] = (SampleOrder) {
+                .timestamp = chunks[i].columns.timestamps[sample],
+                .chunk = i,
+                .sample = sample
+            };
+        }
+    }
+    qsort(order, samples, sizeof(SampleOrder), compareSampleOrder);
+    for (position = 0; position < samples; position++)
+    {
+        printSample(&chunks[order[position].chunk].columns,
+                    channels,
+                    order[position].sample);
+    }
+    free(order);
+
+columnsCleanup:
+    for (int32_t i = 0; i < threads; i++)
+    {
+        free(chunks[i].columns.timestamps);
+        free(chunks[i].columns.floatReadings[0]);
+    }
+    munmap(dataset, datasetStat.st_size);
+chunksCleanup:
+    for (int32_t i = 0; i < threads; i++)
+    {
+        RBRParser_destroy(&chunks[i].parser);
+    }
+    free(chunks);
+fileCleanup:
+    close(datasetFd);
+
+    return status;
+}
@@ -15,7 +15,7 @@
 #include <math.h>
 /* Required for fprintf, printf, snprintf. */
 #include <stdio.h>
-/* Required for strerror. */
+/* Required for memmove, strerror. */
 #include <string.h>
 /* Required for time. */
 #include <time.h>
@@ -23,6 +23,24 @@
 #include <unistd.h>
 
 #include "posix-shared.h"
+#include "RBRParser.h"
+
+RBRInstrumentError parserBin(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentSample *const bin)
+{
+    /* Unused. */
+    (void) parser;
+
+    printf("%" PRIi64, bin->timestamp);
+    for (int32_t i = 0; i < bin->channels; i++)
+    {
+        printf(", %lf", bin->readings[i]);
+    }
+    printf("\n");
+
+    return RBRINSTRUMENT_SUCCESS;
+}
 
 int main(int argc, char *argv[])
 {
@@ -228,13 +246,93 @@ int main(int argc, char *argv[])
         status = EXIT_FAILURE;
         goto instrumentCleanup;
     }
-    else
+
+    printf("Post-processing has concluded. Downloading bins...\n");
+
+    /* The bins are laid out like EasyParse samples, with one value for each
+     * post-processing channel. */
+    RBRParser *parser = NULL;
+    RBRInstrumentSample binBuffer;
+    RBRParserCallbacks parserCallbacks = {
+        .sample = parserBin,
+        .sampleBuffer = &binBuffer
+    };
+    RBRParserConfig parserConfig = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+        .formatConfig = {
+            .easyParse = {
+                .postprocessingChannels = postprocessing.channels.count
+            }
+        }
+    };
+    if ((err = RBRParser_init(
+             &parser,
+             &parserCallbacks,
+             &parserConfig,
+             NULL)) != RBRINSTRUMENT_SUCCESS)
     {
-        printf("%s: Post-processing has concluded. See `posix-download` for an "
-               "example of downloading data.\n",
-               programName);
+        fprintf(stderr, "%s: Failed to initialize parser: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+        goto instrumentCleanup;
+    }
+
+    meminfo.dataset = RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA;
+    RBRInstrument_getMemoryInfo(instrument, &meminfo);
+
+    printf("tstamp");
+    for (int32_t i = 0; i < postprocessing.channels.count; i++)
+    {
+        printf(", %s(%s)",
+               RBRInstrumentPostprocessingAggregate_name(
+                   postprocessing.channels.channels[i].function),
+               postprocessing.channels.channels[i].label);
+    }
+    printf("\n");
+
+    uint8_t buf[1024];
+    int32_t bufSize = 0;
+    RBRInstrumentData data = {
+        .dataset = RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA,
+        .offset  = 0
+    };
+    int32_t parsedSize;
+    while (data.offset < meminfo.used)
+    {
+        data.data = buf + bufSize;
+        data.size = sizeof(buf) - bufSize;
+        err = RBRInstrument_readData(instrument, &data);
+        if (err == RBRINSTRUMENT_TIMEOUT)
+        {
+            continue;
+        }
+        else if (err != RBRINSTRUMENT_SUCCESS)
+        {
+            fprintf(stderr, "%s: Failure downloading bins: %s!\n",
+                    programName,
+                    RBRInstrumentError_name(err));
+            status = EXIT_FAILURE;
+            break;
+        }
+        else if (data.size == 0)
+        {
+            break;
+        }
+
+        data.offset += data.size;
+
+        bufSize += data.size;
+        parsedSize = bufSize;
+        RBRParser_parse(parser,
+                        RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA,
+                        buf,
+                        &parsedSize);
+        bufSize -= parsedSize;
+        memmove(buf, buf + parsedSize, bufSize);
     }
 
+    RBRParser_destroy(parser);
 instrumentCleanup:
     RBRInstrument_close(instrument);
 serialCleanup:
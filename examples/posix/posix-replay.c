@@ -0,0 +1,178 @@
+/**
+ * \file posix-replay.c
+ *
+ * \brief Replay a streaming session recorded by posix-stream.
+ *
+ * Makes the same library calls as posix-stream, but against the instrument
+ * data captured in a trace file instead of a live instrument. Replayed as fast
+ * as possible, this makes a repeatable benchmark of the library's response
+ * and sample parsing; with fragmentation, it's a check that parsing doesn't
+ * depend on how reads happen to be split up.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for fprintf, printf. */
+#include <stdio.h>
+/* Required for EXIT_FAILURE, EXIT_SUCCESS, strtod, strtoul. */
+#include <stdlib.h>
+/* Required for strcmp, strerror. */
+#include <string.h>
+
+#include "posix-shared.h"
+#include "posix-trace.h"
+
+static int64_t samples = 0;
+
+RBRInstrumentError instrumentSample(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentSample *const sample)
+{
+    /* Unused. */
+    (void) instrument;
+    (void) sample;
+
+    ++samples;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    int status = EXIT_SUCCESS;
+
+    RBRInstrumentError err;
+    RBRInstrument *instrument = NULL;
+    TraceReplay replay;
+
+    if (argc < 2)
+    {
+        fprintf(stderr,
+                "Usage: %s trace-file"
+                " [speed [recorded|single|random [seed]]]\n"
+                "\n"
+                "A speed of 0 (the default) replays as fast as possible.\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    errno = 0;
+    if (traceReplayLoad(&replay, argv[1]) != 0)
+    {
+        fprintf(stderr, "%s: Failed to load trace file: %s!\n",
+                programName,
+                (errno != 0) ? strerror(errno) : "invalid trace");
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 2)
+    {
+        replay.speed = strtod(argv[2], NULL);
+    }
+    if (argc > 3)
+    {
+        if (strcmp(argv[3], "single") == 0)
+        {
+            replay.fragmentation = TRACE_REPLAY_SINGLE_BYTES;
+        }
+        else if (strcmp(argv[3], "random") == 0)
+        {
+            replay.fragmentation = TRACE_REPLAY_RANDOM;
+        }
+    }
+    if (argc > 4)
+    {
+        replay.seed = (uint32_t) strtoul(argv[4], NULL, 10);
+        if (replay.seed == 0)
+        {
+            replay.seed = 1;
+        }
+    }
+
+    RBRInstrumentSample sampleBuffer;
+    RBRInstrumentCallbacks callbacks = {
+        .time = instrumentTime,
+        .sleep = traceReplaySleep,
+        .read = traceReplayRead,
+        .write = traceReplayWrite,
+        .sample = instrumentSample,
+        .sampleBuffer = &sampleBuffer
+    };
+
+    int64_t startTime;
+    traceTime(NULL, &startTime);
+
+    if ((err = RBRInstrument_open(
+             &instrument,
+             &callbacks,
+             INSTRUMENT_COMMAND_TIMEOUT_MSEC,
+             (void *) &replay)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to establish instrument connection: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+        goto replayCleanup;
+    }
+
+    /* This must match posix-stream call for call. */
+    RBRInstrumentLink link;
+    RBRInstrument_getLink(instrument, &link);
+    switch (link)
+    {
+    case RBRINSTRUMENT_LINK_USB:
+        RBRInstrument_setUSBStreamingState(instrument, true);
+        break;
+    case RBRINSTRUMENT_LINK_SERIAL:
+    case RBRINSTRUMENT_LINK_WIFI:
+        {
+            RBRInstrumentSerial serial;
+            RBRInstrument_getSerial(instrument, &serial);
+            RBRInstrument_setSerialStreamingState(instrument, true);
+            break;
+        }
+    default:
+        goto instrumentCleanup;
+    }
+
+    RBRInstrumentDeployment deployment;
+    RBRInstrument_getDeployment(instrument, &deployment);
+    if (deployment.status != RBRINSTRUMENT_STATUS_LOGGING)
+    {
+        instrumentStart(instrument);
+    }
+
+    while (!traceReplayFinished(&replay))
+    {
+        if ((err = RBRInstrument_readSample(instrument))
+            != RBRINSTRUMENT_SUCCESS
+            && !traceReplayFinished(&replay))
+        {
+            fprintf(stderr, "Error: %s\n", RBRInstrumentError_name(err));
+        }
+    }
+
+    int64_t endTime;
+    traceTime(NULL, &endTime);
+    double elapsed = (endTime - startTime) / 1000000.0;
+
+    printf("Replayed %" PRIi32 " reads (%" PRIi32 " bytes) in %.3lf s.\n",
+           replay.chunksLength,
+           replay.dataLength,
+           elapsed);
+    printf("Parsed %" PRIi64 " samples: %.0lf samples/s, %.3lf MB/s.\n",
+           samples,
+           samples / elapsed,
+           replay.dataLength / elapsed / 1000000.0);
+
+instrumentCleanup:
+    RBRInstrument_close(instrument);
+replayCleanup:
+    traceReplayFree(&replay);
+
+    return status;
+}
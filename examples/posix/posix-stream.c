@@ -24,6 +24,7 @@
 #include <unistd.h>
 
 #include "posix-shared.h"
+#include "posix-trace.h"
 
 RBRInstrumentError instrumentSample(
     const struct RBRInstrument *instrument,
@@ -61,12 +62,20 @@ int main(int argc, char *argv[])
 
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s device\n", argv[0]);
+        fprintf(stderr, "Usage: %s device [trace-file]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     devicePath = argv[1];
 
+    if (argc > 2 && traceOpen(argv[2]) != 0)
+    {
+        fprintf(stderr, "%s: Failed to open trace file: %s!\n",
+                programName,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
     if ((instrumentFd = openSerialFd(devicePath)) < 0)
     {
         fprintf(stderr, "%s: Failed to open serial device: %s!\n",
@@ -89,7 +98,9 @@ int main(int argc, char *argv[])
         .read = instrumentRead,
         .write = instrumentWrite,
         .sample = instrumentSample,
-        .sampleBuffer = &sampleBuffer
+        .sampleBuffer = &sampleBuffer,
+        .trace = (argc > 2) ? traceRecord : NULL,
+        .traceTime = traceTime
     };
 
     if ((err = RBRInstrument_open(
@@ -165,6 +176,7 @@ instrumentCleanup:
     RBRInstrument_close(instrument);
 fileCleanup:
     close(instrumentFd);
+    traceClose();
 
     return status;
 }
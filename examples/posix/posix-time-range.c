@@ -0,0 +1,393 @@
+/**
+ * \file posix-time-range.c
+ *
+ * \brief Example of using the library to extract a range of time from a large
+ * EasyParse sample dataset in a POSIX environment.
+ *
+ * The file is memory-mapped, and the records in the range are found by binary
+ * search with RBRParser_parseTimeRange(), so only the pages holding them (and
+ * a handful visited by the search) are ever read.
+ *
+ * If an index file is named, it's used to search around any discontinuities
+ * in the dataset's timestamps. If it doesn't exist yet, it's built with
+ * RBRParser_buildIndex() and saved for next time. The index file is a plain
+ * array of RBRParserIndexEntry structures, so it's only portable between
+ * machines with the same byte order and structure layout.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for clock_gettime, gmtime_r in time.h. */
+#define _POSIX_C_SOURCE 200112L
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for open. */
+#include <fcntl.h>
+/* Required for fclose, fopen, fprintf, fread, fwrite, printf, sscanf. */
+#include <stdio.h>
+/* Required for EXIT_FAILURE, EXIT_SUCCESS, free, malloc, strtol. */
+#include <stdlib.h>
+/* Required for strerror. */
+#include <string.h>
+/* Required for mmap, munmap, posix_madvise. */
+#include <sys/mman.h>
+/* Required for fstat, open, struct stat. */
+#include <sys/stat.h>
+/* Required for clock_gettime, gmtime_r, strftime, time_t. */
+#include <time.h>
+/* Required for close. */
+#include <unistd.h>
+
+#include "RBRParser.h"
+
+/** \brief The number of records between periodic index entries. */
+#define INDEX_INTERVAL 4096
+
+static int64_t now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+/**
+ * \brief Parse a “YYYYmmddHHMMSS” time, as used by instrument schedule
+ * settings.
+ *
+ * \return 0 on success, or -1 if the time couldn't be parsed
+ */
+static int parseTime(const char *s, RBRInstrumentDateTime *timestamp)
+{
+    int year, month, day, hour, minute, second;
+    if (strlen(s) != 14
+        || sscanf(s,
+                  "%4d%2d%2d%2d%2d%2d",
+                  &year,
+                  &month,
+                  &day,
+                  &hour,
+                  &minute,
+                  &second) != 6
+        || month < 1 || month > 12)
+    {
+        return -1;
+    }
+
+    /* Days since the epoch of a proleptic Gregorian date, counting years from
+     * March so that the leap day falls at the end. */
+    int64_t y = year - (month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yearOfEra = y - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+                        + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100
+                       + dayOfYear;
+    int64_t days = era * 146097 + dayOfEra - 719468;
+
+    *timestamp = (((days * 24 + hour) * 60 + minute) * 60 + second) * 1000;
+    return 0;
+}
+
+RBRInstrumentError parserSample(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentSample *const sample)
+{
+    int64_t *samples = RBRParser_getUserData(parser);
+    ++*samples;
+
+    char ftime[128];
+    time_t sampleSeconds = (time_t) (sample->timestamp / 1000);
+    struct tm sampleTime;
+    gmtime_r(&sampleSeconds, &sampleTime);
+    strftime(ftime, sizeof(ftime), "%F %T", &sampleTime);
+
+    printf("%s.%03" PRIi64, ftime, sample->timestamp % 1000);
+    for (int32_t i = 0; i < sample->channels; i++)
+    {
+        printf(", %lf", sample->readings[i]);
+    }
+    printf("\n");
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/**
+ * \brief Load an index file, or build one and save it if there isn't one.
+ *
+ * \return 0 on success, or -1 with an explanation printed on failure
+ */
+static int loadIndex(const char *programName,
+                     const char *indexPath,
+                     const RBRParser *parser,
+                     const void *dataset,
+                     int64_t datasetSize,
+                     RBRParserIndexEntry **index,
+                     int32_t *indexLength)
+{
+    FILE *indexFile;
+    if ((indexFile = fopen(indexPath, "rb")) != NULL)
+    {
+        struct stat indexStat;
+        if (fstat(fileno(indexFile), &indexStat) < 0)
+        {
+            fprintf(stderr, "%s: Failed to stat index: %s!\n",
+                    programName,
+                    strerror(errno));
+            fclose(indexFile);
+            return -1;
+        }
+
+        *indexLength = indexStat.st_size / sizeof(RBRParserIndexEntry);
+        if ((*index = malloc(sizeof(RBRParserIndexEntry)
+                             * (*indexLength + 1))) == NULL)
+        {
+            fprintf(stderr, "%s: Failed to allocate memory!\n", programName);
+            fclose(indexFile);
+            return -1;
+        }
+        else if (fread(*index,
+                       sizeof(RBRParserIndexEntry),
+                       *indexLength,
+                       indexFile) != (size_t) *indexLength)
+        {
+            fprintf(stderr, "%s: Failed to read index!\n", programName);
+            free(*index);
+            fclose(indexFile);
+            return -1;
+        }
+
+        fclose(indexFile);
+        return 0;
+    }
+    else if (errno != ENOENT)
+    {
+        fprintf(stderr, "%s: Failed to open index: %s!\n",
+                programName,
+                strerror(errno));
+        return -1;
+    }
+
+    /* Count the entries first so that the index can be allocated exactly. */
+    RBRInstrumentError err;
+    RBRParser_buildIndex(parser,
+                         RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                         dataset,
+                         datasetSize,
+                         INDEX_INTERVAL,
+                         NULL,
+                         0,
+                         indexLength);
+    if ((*index = malloc(sizeof(RBRParserIndexEntry)
+                         * (*indexLength + 1))) == NULL)
+    {
+        fprintf(stderr, "%s: Failed to allocate memory!\n", programName);
+        return -1;
+    }
+    else if ((err = RBRParser_buildIndex(
+                  parser,
+                  RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                  dataset,
+                  datasetSize,
+                  INDEX_INTERVAL,
+                  *index,
+                  *indexLength,
+                  indexLength)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to build index: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        free(*index);
+        return -1;
+    }
+
+    if ((indexFile = fopen(indexPath, "wb")) == NULL
+        || fwrite(*index,
+                  sizeof(RBRParserIndexEntry),
+                  *indexLength,
+                  indexFile) != (size_t) *indexLength)
+    {
+        /* The index is still good for this run. */
+        fprintf(stderr, "%s: Failed to save index: %s!\n",
+                programName,
+                strerror(errno));
+    }
+    if (indexFile != NULL)
+    {
+        fclose(indexFile);
+    }
+
+    fprintf(stderr, "%s: Built index of %" PRIi32 " entries.\n",
+            programName,
+            *indexLength);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    char *filePath;
+    char *indexPath = NULL;
+    int32_t channels;
+    RBRInstrumentDateTime begin;
+    RBRInstrumentDateTime end;
+
+    int status = EXIT_SUCCESS;
+    int datasetFd;
+
+    if (argc < 5)
+    {
+        fprintf(stderr,
+                "Usage: %s file channels begin end [index-file]\n"
+                "\n"
+                "Times are given as YYYYmmddHHMMSS, in UTC. The range includes"
+                " samples at\n"
+                "the beginning time, but not the end time.\n"
+                "\n"
+                "If an index file is given, it's used to search datasets"
+                " whose timestamps\n"
+                "jump backwards. It's created if it doesn't already exist.\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    filePath = argv[1];
+    channels = strtol(argv[2], NULL, 10);
+    if (parseTime(argv[3], &begin) < 0 || parseTime(argv[4], &end) < 0)
+    {
+        fprintf(stderr, "%s: Times must be given as YYYYmmddHHMMSS!\n",
+                programName);
+        return EXIT_FAILURE;
+    }
+    if (argc > 5)
+    {
+        indexPath = argv[5];
+    }
+
+    if ((datasetFd = open(filePath, O_RDONLY)) < 0)
+    {
+        fprintf(stderr, "%s: Failed to open file: %s!\n",
+                programName,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr,
+            "%s: Using %s v%s (built %s).\n",
+            programName,
+            RBRINSTRUMENT_LIB_NAME,
+            RBRINSTRUMENT_LIB_VERSION,
+            RBRINSTRUMENT_LIB_BUILD_DATE);
+
+    int64_t samples = 0;
+    RBRParser *parser = NULL;
+    RBRInstrumentSample sampleBuffer;
+    RBRParserCallbacks parserCallbacks = {
+        .sample = parserSample,
+        .sampleBuffer = &sampleBuffer
+    };
+    RBRParserConfig parserConfig = {
+        .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+        .formatConfig = {
+            .easyParse = {
+                .channels = channels
+            }
+        }
+    };
+
+    RBRInstrumentError err;
+    if ((err = RBRParser_init(
+             &parser,
+             &parserCallbacks,
+             &parserConfig,
+             &samples)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to initialize parser: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+        goto fileCleanup;
+    }
+
+    struct stat datasetStat;
+    if (fstat(datasetFd, &datasetStat) < 0)
+    {
+        fprintf(stderr, "%s: Failed to stat file: %s!\n",
+                programName,
+                strerror(errno));
+        status = EXIT_FAILURE;
+        goto parserCleanup;
+    }
+    else if (datasetStat.st_size == 0)
+    {
+        goto parserCleanup;
+    }
+
+    void *dataset = mmap(NULL,
+                         datasetStat.st_size,
+                         PROT_READ,
+                         MAP_PRIVATE,
+                         datasetFd,
+                         0);
+    if (dataset == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: Failed to map file: %s!\n",
+                programName,
+                strerror(errno));
+        status = EXIT_FAILURE;
+        goto parserCleanup;
+    }
+    /* A binary search jumps around; reading ahead would only waste I/O. */
+    posix_madvise(dataset, datasetStat.st_size, POSIX_MADV_RANDOM);
+
+    RBRParserIndexEntry *index = NULL;
+    int32_t indexLength = 0;
+    if (indexPath != NULL
+        && loadIndex(programName,
+                     indexPath,
+                     parser,
+                     dataset,
+                     datasetStat.st_size,
+                     &index,
+                     &indexLength) < 0)
+    {
+        status = EXIT_FAILURE;
+        goto mapCleanup;
+    }
+
+    int64_t start = now();
+    if ((err = RBRParser_parseTimeRange(
+             parser,
+             RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+             dataset,
+             datasetStat.st_size,
+             begin,
+             end,
+             index,
+             indexLength)) != RBRINSTRUMENT_SUCCESS)
+    {
+        fprintf(stderr, "%s: Failed to parse file: %s!\n",
+                programName,
+                RBRInstrumentError_name(err));
+        status = EXIT_FAILURE;
+    }
+    else
+    {
+        fprintf(stderr, "%s: Found %" PRIi64 " samples in %.3fms.\n",
+                programName,
+                samples,
+                (now() - start) / 1000000.0);
+    }
+
+    free(index);
+mapCleanup:
+    munmap(dataset, datasetStat.st_size);
+parserCleanup:
+    RBRParser_destroy(parser);
+fileCleanup:
+    close(datasetFd);
+
+    return status;
+}
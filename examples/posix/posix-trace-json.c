@@ -0,0 +1,117 @@
+/**
+ * \file posix-trace-json.c
+ *
+ * \brief Convert a binary wire-level trace into Chrome trace JSON.
+ *
+ * The output can be loaded into chrome://tracing or Perfetto to see where time
+ * is spent talking to an instrument. Traces can be recorded by giving a trace
+ * file path to posix-stream.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for errno. */
+#include <errno.h>
+/* Required for fclose, fopen, fprintf, printf. */
+#include <stdio.h>
+/* Required for EXIT_FAILURE, EXIT_SUCCESS. */
+#include <stdlib.h>
+/* Required for strerror. */
+#include <string.h>
+
+#include "posix-trace.h"
+
+/* The most data to include for any one read or write. */
+#define TRACE_DATA_MAX 1024
+
+static void printJsonString(const uint8_t *data, int32_t length)
+{
+    putchar('"');
+    for (int32_t i = 0; i < length; i++)
+    {
+        if (data[i] == '"' || data[i] == '\\')
+        {
+            printf("\\%c", data[i]);
+        }
+        else if (data[i] < 0x20 || data[i] >= 0x7F)
+        {
+            printf("\\u%04x", data[i]);
+        }
+        else
+        {
+            putchar(data[i]);
+        }
+    }
+    putchar('"');
+}
+
+int main(int argc, char *argv[])
+{
+    char *programName = argv[0];
+    int status = EXIT_SUCCESS;
+    FILE *file;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s trace-file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((file = fopen(argv[1], "rb")) == NULL)
+    {
+        fprintf(stderr, "%s: Failed to open trace file: %s!\n",
+                programName,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (traceReadHeader(file) != 0)
+    {
+        fprintf(stderr, "%s: Not a trace file!\n", programName);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    TraceFileRecord record;
+    uint8_t data[TRACE_DATA_MAX];
+    int result;
+    bool first = true;
+
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    while ((result = traceReadRecord(file,
+                                     &record,
+                                     data,
+                                     sizeof(data))) > 0)
+    {
+        printf("%s\n{\"name\":\"%s\",\"cat\":\"instrument\",\"ph\":\"X\","
+               "\"pid\":1,\"tid\":1,"
+               "\"ts\":%" PRIi64 ",\"dur\":%" PRIi64 ","
+               "\"args\":{\"result\":\"%s\",\"size\":%" PRIi32,
+               first ? "" : ",",
+               RBRInstrumentTraceType_name(record.type),
+               record.begin,
+               record.end - record.begin,
+               RBRInstrumentError_name(record.result),
+               record.size);
+        if (record.dataLength > 0)
+        {
+            printf(",\"data\":");
+            printJsonString(data, record.dataLength);
+        }
+        printf("}}");
+        first = false;
+    }
+    printf("\n]}\n");
+
+    if (result < 0)
+    {
+        fprintf(stderr, "%s: Trace file is truncated or corrupt!\n",
+                programName);
+        status = EXIT_FAILURE;
+    }
+
+    fclose(file);
+    return status;
+}
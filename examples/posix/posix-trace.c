@@ -0,0 +1,387 @@
+/**
+ * \file posix-trace.c
+ *
+ * \brief Binary wire-level trace recording and replay used by the libRBR
+ * POSIX examples.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Prerequisite for clock_gettime, struct timespec in time.h. */
+#define _POSIX_C_SOURCE 200112L
+
+/* Required for fclose, fopen, fread, fseek, fwrite. */
+#include <stdio.h>
+/* Required for free, realloc. */
+#include <stdlib.h>
+/* Required for memcmp, memcpy, memset. */
+#include <string.h>
+/* Required for clock_gettime, nanosleep, struct timespec. */
+#include <time.h>
+
+#include "posix-trace.h"
+
+/* The trace callback has no convenient place to keep per-instrument state:
+ * the instrument user data belongs to the I/O callbacks. The examples only
+ * ever talk to one instrument at a time, so a single open file will do. */
+static FILE *traceFile = NULL;
+
+int traceOpen(const char *path)
+{
+    if ((traceFile = fopen(path, "wb")) == NULL)
+    {
+        return -1;
+    }
+
+    TraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LEN);
+    header.version = TRACE_FILE_VERSION;
+
+    if (fwrite(&header, sizeof(header), 1, traceFile) != 1)
+    {
+        fclose(traceFile);
+        traceFile = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void traceClose(void)
+{
+    if (traceFile != NULL)
+    {
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+}
+
+int traceReadHeader(FILE *file)
+{
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LEN) != 0
+        || header.version != TRACE_FILE_VERSION)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int traceReadRecord(FILE *file,
+                    TraceFileRecord *record,
+                    void *data,
+                    int32_t dataSize)
+{
+    if (fread(record, sizeof(TraceFileRecord), 1, file) != 1)
+    {
+        return feof(file) ? 0 : -1;
+    }
+
+    if (record->dataLength < 0)
+    {
+        return -1;
+    }
+
+    int32_t skip = 0;
+    if (record->dataLength > dataSize)
+    {
+        skip = record->dataLength - dataSize;
+        record->dataLength = dataSize;
+    }
+
+    /* Recording stops whenever the recording program is interrupted, so a
+     * partial final record is expected: treat it as the end of the trace. */
+    if (record->dataLength > 0
+        && fread(data, record->dataLength, 1, file) != 1)
+    {
+        return feof(file) ? 0 : -1;
+    }
+
+    if (skip > 0 && fseek(file, skip, SEEK_CUR) != 0)
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+RBRInstrumentError traceTime(const struct RBRInstrument *instrument,
+                             int64_t *time)
+{
+    /* Unused. */
+    (void) instrument;
+
+    struct timespec result;
+    clock_gettime(CLOCK_MONOTONIC, &result);
+    *time = ((int64_t) result.tv_sec * 1000000) + (result.tv_nsec / 1000);
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError traceRecord(const struct RBRInstrument *instrument,
+                               const struct RBRInstrumentTraceRecord *record)
+{
+    /* Unused. */
+    (void) instrument;
+
+    if (traceFile == NULL)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    TraceFileRecord fileRecord;
+    memset(&fileRecord, 0, sizeof(fileRecord));
+    fileRecord.type = (uint8_t) record->type;
+    fileRecord.result = (uint8_t) record->result;
+    fileRecord.size = record->size;
+    fileRecord.dataLength = (record->data != NULL) ? record->size : 0;
+    fileRecord.begin = record->begin;
+    fileRecord.end = record->end;
+
+    if (fwrite(&fileRecord, sizeof(fileRecord), 1, traceFile) != 1
+        || (fileRecord.dataLength > 0
+            && fwrite(record->data,
+                      fileRecord.dataLength,
+                      1,
+                      traceFile) != 1))
+    {
+        return RBRINSTRUMENT_CALLBACK_ERROR;
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+int traceReplayLoad(TraceReplay *replay, const char *path)
+{
+    FILE *file;
+    TraceFileRecord record;
+    int32_t dataCapacity = 0;
+    int32_t chunksCapacity = 0;
+    int result;
+
+    memset(replay, 0, sizeof(TraceReplay));
+    replay->startTime = -1;
+    replay->seed = 1;
+
+    if ((file = fopen(path, "rb")) == NULL)
+    {
+        return -1;
+    }
+
+    if (traceReadHeader(file) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    while (true)
+    {
+        /* Peek at the record header to find out how much room we need. */
+        if (fread(&record, sizeof(record), 1, file) != 1)
+        {
+            result = feof(file) ? 0 : -1;
+            break;
+        }
+        if (record.dataLength < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        if (record.type != RBRINSTRUMENT_TRACE_READ
+            || record.result != RBRINSTRUMENT_SUCCESS
+            || record.dataLength == 0)
+        {
+            if (record.dataLength > 0
+                && fseek(file, record.dataLength, SEEK_CUR) != 0)
+            {
+                result = -1;
+                break;
+            }
+            continue;
+        }
+
+        while (replay->dataLength + record.dataLength > dataCapacity)
+        {
+            dataCapacity = (dataCapacity == 0) ? 4096 : dataCapacity * 2;
+            uint8_t *data = realloc(replay->data, dataCapacity);
+            if (data == NULL)
+            {
+                fclose(file);
+                traceReplayFree(replay);
+                return -1;
+            }
+            replay->data = data;
+        }
+
+        if (replay->chunksLength == chunksCapacity)
+        {
+            chunksCapacity = (chunksCapacity == 0) ? 256 : chunksCapacity * 2;
+            TraceReplayChunk *chunks
+                = realloc(replay->chunks,
+                          chunksCapacity * sizeof(TraceReplayChunk));
+            if (chunks == NULL)
+            {
+                fclose(file);
+                traceReplayFree(replay);
+                return -1;
+            }
+            replay->chunks = chunks;
+        }
+
+        /* As in traceReadRecord(), a partial final record is just dropped. */
+        if (fread(replay->data + replay->dataLength,
+                  record.dataLength,
+                  1,
+                  file) != 1)
+        {
+            result = feof(file) ? 0 : -1;
+            break;
+        }
+
+        replay->chunks[replay->chunksLength++] = (TraceReplayChunk) {
+            .time = record.begin,
+            .offset = replay->dataLength,
+            .length = record.dataLength
+        };
+        replay->dataLength += record.dataLength;
+    }
+
+    fclose(file);
+    if (result < 0)
+    {
+        traceReplayFree(replay);
+    }
+    return result;
+}
+
+void traceReplayFree(TraceReplay *replay)
+{
+    free(replay->data);
+    free(replay->chunks);
+    replay->data = NULL;
+    replay->chunks = NULL;
+    replay->dataLength = 0;
+    replay->chunksLength = 0;
+}
+
+bool traceReplayFinished(const TraceReplay *replay)
+{
+    return replay->chunk >= replay->chunksLength;
+}
+
+static void traceReplaySleepMicroseconds(int64_t time)
+{
+    if (time <= 0)
+    {
+        return;
+    }
+
+    struct timespec sleep = {
+        .tv_sec  =  time / 1000000,
+        .tv_nsec = (time % 1000000) * 1000
+    };
+    nanosleep(&sleep, NULL);
+}
+
+RBRInstrumentError traceReplaySleep(const struct RBRInstrument *instrument,
+                                    RBRInstrumentDateTime time)
+{
+    TraceReplay *replay;
+    replay = (TraceReplay *) RBRInstrument_getUserData(instrument);
+
+    if (replay->speed > 0)
+    {
+        traceReplaySleepMicroseconds((int64_t) (time * 1000 / replay->speed));
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError traceReplayRead(const struct RBRInstrument *instrument,
+                                   void *data,
+                                   int32_t *size)
+{
+    TraceReplay *replay;
+    replay = (TraceReplay *) RBRInstrument_getUserData(instrument);
+
+    /* Nothing was asked for, and no fragment length can be drawn from 0. */
+    if (*size <= 0)
+    {
+        *size = 0;
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    /* There's no more data to give, and waiting won't produce any. */
+    if (traceReplayFinished(replay))
+    {
+        *size = 0;
+        return RBRINSTRUMENT_CALLBACK_ERROR;
+    }
+
+    const TraceReplayChunk *chunk = &replay->chunks[replay->chunk];
+
+    /* Hold each read back until the time it was originally received. */
+    if (replay->speed > 0)
+    {
+        int64_t now;
+        traceTime(instrument, &now);
+        if (replay->startTime < 0)
+        {
+            replay->startTime = now;
+        }
+        int64_t due = replay->startTime
+                      + (int64_t) ((chunk->time - replay->chunks[0].time)
+                                   / replay->speed);
+        traceReplaySleepMicroseconds(due - now);
+    }
+
+    int32_t length = chunk->length - replay->chunkPosition;
+    if (length > *size)
+    {
+        length = *size;
+    }
+
+    switch (replay->fragmentation)
+    {
+    case TRACE_REPLAY_SINGLE_BYTES:
+        length = 1;
+        break;
+    case TRACE_REPLAY_RANDOM:
+        /* xorshift32: cheap, and deterministic for a given seed. */
+        replay->seed ^= replay->seed << 13;
+        replay->seed ^= replay->seed >> 17;
+        replay->seed ^= replay->seed << 5;
+        length = 1 + (int32_t) (replay->seed % (uint32_t) length);
+        break;
+    case TRACE_REPLAY_AS_RECORDED:
+    default:
+        break;
+    }
+
+    memcpy(data, replay->data + chunk->offset + replay->chunkPosition, length);
+    *size = length;
+
+    replay->chunkPosition += length;
+    if (replay->chunkPosition >= chunk->length)
+    {
+        ++replay->chunk;
+        replay->chunkPosition = 0;
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError traceReplayWrite(const struct RBRInstrument *instrument,
+                                    const void *const data,
+                                    int32_t size)
+{
+    TraceReplay *replay;
+    replay = (TraceReplay *) RBRInstrument_getUserData(instrument);
+
+    /* Unused. */
+    (void) data;
+
+    replay->bytesWritten += size;
+    return RBRINSTRUMENT_SUCCESS;
+}
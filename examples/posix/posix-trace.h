@@ -0,0 +1,134 @@
+/**
+ * \file posix-trace.h
+ *
+ * \brief Binary wire-level trace recording and replay used by the libRBR
+ * POSIX examples.
+ *
+ * Recording is done by the trace callbacks, and so works with any set of
+ * instrument I/O callbacks. Replay substitutes for the I/O callbacks, feeding
+ * the instrument bytes read during a recorded session back to the library.
+ * As long as the library issues the same commands as it did when the trace
+ * was recorded, it will see the same responses.
+ *
+ * A trace file begins with a TraceFileHeader. Each trace record follows as a
+ * TraceFileRecord, immediately followed by TraceFileRecord.dataLength bytes of
+ * data. All fields are in host byte order.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_POSIX_TRACE_H
+#define LIBRBR_POSIX_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Required for FILE. */
+#include <stdio.h>
+
+#include "RBRInstrument.h"
+
+#define TRACE_FILE_MAGIC "RBRTRACE"
+#define TRACE_FILE_MAGIC_LEN 8
+#define TRACE_FILE_VERSION 1
+
+typedef struct TraceFileHeader
+{
+    char magic[TRACE_FILE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t reserved;
+} TraceFileHeader;
+
+typedef struct TraceFileRecord
+{
+    /* An RBRInstrumentTraceType. */
+    uint8_t type;
+    /* An RBRInstrumentError. */
+    uint8_t result;
+    uint16_t reserved;
+    int32_t size;
+    int32_t dataLength;
+    uint32_t reserved2;
+    int64_t begin;
+    int64_t end;
+} TraceFileRecord;
+
+typedef enum TraceReplayFragmentation
+{
+    /* Deliver each read as it was originally received. */
+    TRACE_REPLAY_AS_RECORDED,
+    /* Deliver one byte per read. */
+    TRACE_REPLAY_SINGLE_BYTES,
+    /* Split the original reads at pseudorandom points. */
+    TRACE_REPLAY_RANDOM
+} TraceReplayFragmentation;
+
+typedef struct TraceReplayChunk
+{
+    int64_t time;
+    int32_t offset;
+    int32_t length;
+} TraceReplayChunk;
+
+typedef struct TraceReplay
+{
+    /* The bytes of all recorded reads, concatenated. */
+    uint8_t *data;
+    int32_t dataLength;
+    /* The boundaries and timing of the recorded reads. */
+    TraceReplayChunk *chunks;
+    int32_t chunksLength;
+
+    /* How much faster than recorded to replay. 0 means as fast as possible. */
+    double speed;
+    TraceReplayFragmentation fragmentation;
+    uint32_t seed;
+
+    int32_t chunk;
+    int32_t chunkPosition;
+    int64_t startTime;
+    int64_t bytesWritten;
+} TraceReplay;
+
+int traceOpen(const char *path);
+
+void traceClose(void);
+
+int traceReadHeader(FILE *file);
+
+int traceReadRecord(FILE *file,
+                    TraceFileRecord *record,
+                    void *data,
+                    int32_t dataSize);
+
+RBRInstrumentError traceTime(const struct RBRInstrument *instrument,
+                             int64_t *time);
+
+RBRInstrumentError traceRecord(const struct RBRInstrument *instrument,
+                               const struct RBRInstrumentTraceRecord *record);
+
+int traceReplayLoad(TraceReplay *replay, const char *path);
+
+void traceReplayFree(TraceReplay *replay);
+
+bool traceReplayFinished(const TraceReplay *replay);
+
+RBRInstrumentError traceReplaySleep(const struct RBRInstrument *instrument,
+                                    RBRInstrumentDateTime time);
+
+RBRInstrumentError traceReplayRead(const struct RBRInstrument *instrument,
+                                   void *data,
+                                   int32_t *size);
+
+RBRInstrumentError traceReplayWrite(const struct RBRInstrument *instrument,
+                                    const void *const data,
+                                    int32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_POSIX_TRACE_H */
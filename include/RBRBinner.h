@@ -0,0 +1,277 @@
+/**
+ * \file RBRBinner.h
+ *
+ * \brief Host-side post-processing: binning of samples by time or depth.
+ *
+ * 3rd-generation instruments can bin their own data (see
+ * RBRInstrumentPostprocessing), but only on the instrument, only one job at a
+ * time, and only with recent enough firmware. A binner does the same job on
+ * the host, for samples from any source: push parsed or streamed samples into
+ * it, and it delivers bins to a callback in the same form as the parser
+ * delivers #RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA bins, so the same
+ * code can consume either.
+ *
+ * When binning by time, samples are expected in timestamp order, and each bin
+ * is delivered as soon as a sample for a later bin arrives; only one bin is
+ * kept in memory. When binning by depth, a bin is kept for each bin size step
+ * between the minimum and maximum depths, and bins are delivered in order of
+ * distance from the binning origin once all samples have been pushed.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_RBRBINNER_H
+#define LIBRBR_RBRBINNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "RBRInstrument.h"
+
+struct RBRBinner;
+
+/**
+ * \brief Called by the binner for each bin.
+ *
+ * The bin's readings are the values of the post-processing channels, in the
+ * order given by RBRInstrumentPostprocessingChannelsList. The readings of a
+ * channel with no valid values in the bin are NaN (or 0, for
+ * #RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_SAMPLE_COUNT).
+ *
+ * When binning by time, the bin timestamp is the start of the bin. When
+ * binning by depth, it's the timestamp of the first sample in the bin.
+ *
+ * The bin is only valid for the duration of the callback.
+ *
+ * \param [in] binner the binner
+ * \param [in] bin the bin
+ * \return #RBRINSTRUMENT_SUCCESS to continue binning
+ * \return any other value to stop, returned from the function which called
+ *         the callback
+ */
+typedef RBRInstrumentError (*RBRBinnerBinCallback)(
+    const struct RBRBinner *binner,
+    const struct RBRInstrumentSample *const bin);
+
+/**
+ * \brief Configuration for a RBRBinner.
+ */
+typedef struct RBRBinnerConfig
+{
+    /**
+     * \brief The post-processing to perform.
+     *
+     * Interpreted as it would be by the instrument; see
+     * RBRInstrumentPostprocessing for the meaning of each field.
+     * RBRInstrumentPostprocessing.status is ignored. As on the instrument,
+     * samples with timestamps outside of RBRInstrumentPostprocessing.tstampMin
+     * and RBRInstrumentPostprocessing.tstampMax are excluded, so those must be
+     * set even when binning by depth.
+     */
+    RBRInstrumentPostprocessing postprocessing;
+
+    /** \brief The number of channels in each sample. */
+    int32_t channels;
+
+    /**
+     * \brief The labels of the channels in each sample, in order.
+     *
+     * Used to find the channels named by
+     * RBRInstrumentPostprocessing.binReference and
+     * RBRInstrumentPostprocessingChannelsList. For data parsed from an
+     * instrument dataset, these are the labels of the enabled channels of the
+     * RBRParserDeploymentHeader.
+     */
+    char labels[RBRINSTRUMENT_CHANNEL_MAX][RBRINSTRUMENT_CHANNEL_LABEL_MAX + 1];
+
+    /** \brief Called for each bin. */
+    RBRBinnerBinCallback bin;
+} RBRBinnerConfig;
+
+/**
+ * \brief Binner context object.
+ *
+ * Users are strongly discouraged from accessing the fields of this structure
+ * directly as layout and field availability maybe unstable from version to
+ * version.
+ *
+ * \see RBRBinner_init() to initialize a binner
+ * \see RBRBinner_destroy() to release a binner
+ */
+typedef struct RBRBinner
+{
+    /** \brief The binner configuration. */
+    RBRBinnerConfig config;
+
+    /** \brief Whether bins are by time, rather than by depth. */
+    bool timeBinning;
+
+    /**
+     * \brief The index of the reference channel in each sample, when binning
+     * by depth.
+     */
+    int32_t reference;
+
+    /**
+     * \brief The number of distinct sample channels aggregated by
+     * post-processing channels.
+     */
+    int32_t sourceCount;
+
+    /** \brief The sample channel index of each aggregated channel. */
+    int32_t sources[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+
+    /**
+     * \brief The index into RBRBinner.sources of the channel aggregated by
+     * each post-processing channel.
+     */
+    int32_t channelSources[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+
+    /**
+     * \brief A value near the readings of each aggregated channel, subtracted
+     * before accumulation to keep sums of squares precise.
+     */
+    double shift[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+
+    /** \brief Whether RBRBinner.shift has been set for each channel. */
+    bool shifted[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+
+    /** \brief The number of bins kept. */
+    int32_t binCount;
+
+    /** \brief The size of each bin's accumulators, in bytes. */
+    int32_t binStride;
+
+    /** \brief Bin accumulator storage. */
+    void *bins;
+
+    /** \brief The end of the current bin, when binning by time. */
+    RBRInstrumentDateTime binEnd;
+
+    /** \brief Whether any sample has gone into the current bin. */
+    bool binning;
+
+    /** \brief The last valid reference reading, when binning by depth. */
+    double lastReference;
+
+    /** \brief Storage for the bin delivered to the callback. */
+    RBRInstrumentSample binBuffer;
+
+    /** \brief Arbitrary user data; useful in callbacks. */
+    void *userData;
+
+    /**
+     * \brief Whether the instance memory was dynamically allocated by the
+     * constructor.
+     */
+    bool managedAllocation;
+
+    /**
+     * \brief Whether the bin storage was dynamically allocated by the
+     * constructor.
+     */
+    bool managedBuffer;
+} RBRBinner;
+
+/**
+ * \brief Get the number of bytes of bin storage needed by a binner.
+ *
+ * \param [in] config the binner configuration
+ * \return the size of the storage buffer, in bytes, or 0 if the configuration
+ *         is invalid
+ * \see RBRBinner_init()
+ */
+int32_t RBRBinner_bufferSize(const RBRBinnerConfig *config);
+
+/**
+ * \brief Initialize a binner.
+ *
+ * The use of the \a binner argument is the same as that of the \a instrument
+ * argument to RBRInstrument_open(): when given as `NULL`, instance memory will
+ * be allocated for you; otherwise, the pointer target will be used as
+ * instance storage. Likewise, when \a buffer is given as `NULL`, bin storage
+ * will be allocated for you; otherwise, it must be at least
+ * RBRBinner_bufferSize() bytes long and suitably aligned for a `double`.
+ *
+ * The \a config structure is copied into the binner and no reference to it is
+ * retained.
+ *
+ * In the event of any return value other than #RBRINSTRUMENT_SUCCESS, any
+ * memory allocated by this constructor is freed.
+ *
+ * \param [in,out] binner the context object to populate
+ * \param [in] config the binner configuration
+ * \param [in] buffer bin storage, or `NULL` to allocate it
+ * \param [in] userData arbitrary user data; useful in callbacks
+ * \return #RBRINSTRUMENT_SUCCESS if the binner was initialized
+ * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the config is invalid or
+ *                                                names a channel which isn't
+ *                                                among the sample channels
+ * \see RBRBinner_destroy()
+ */
+RBRInstrumentError RBRBinner_init(RBRBinner **binner,
+                                  const RBRBinnerConfig *config,
+                                  void *buffer,
+                                  void *userData);
+
+/**
+ * \brief Release any resources held by the binner.
+ *
+ * \param [in,out] binner the binner
+ * \return #RBRINSTRUMENT_SUCCESS if the binner was released successfully
+ * \see RBRBinner_init()
+ */
+RBRInstrumentError RBRBinner_destroy(RBRBinner *binner);
+
+/**
+ * \brief Get the pointer to arbitrary user data.
+ *
+ * \param [in] binner the binner
+ * \return the arbitrary user data pointer
+ */
+void *RBRBinner_getUserData(const RBRBinner *binner);
+
+/**
+ * \brief Add a sample to the bins.
+ *
+ * NaN readings are left out of their channel's aggregates. When binning by
+ * depth, samples whose reference reading is NaN are excluded, and with an
+ * ascent- or descent-only filter, so are samples whose reference reading
+ * doesn't continue in that direction from the last one.
+ *
+ * The result of this function can be returned directly from a parser or
+ * instrument sample callback.
+ *
+ * \param [in,out] binner the binner
+ * \param [in] sample the sample to add
+ * \return #RBRINSTRUMENT_SUCCESS if the sample was added or excluded
+ * \return any other value returned by the bin callback
+ * \see RBRBinner_flush()
+ */
+RBRInstrumentError RBRBinner_push(RBRBinner *binner,
+                                  const RBRInstrumentSample *sample);
+
+/**
+ * \brief Deliver any bins still being accumulated, and start over.
+ *
+ * Call this once all samples have been pushed. Afterwards, the binner is
+ * ready for another set of samples; e.g., the next profile.
+ *
+ * \param [in,out] binner the binner
+ * \return #RBRINSTRUMENT_SUCCESS if all bins were delivered
+ * \return any other value returned by the bin callback
+ */
+RBRInstrumentError RBRBinner_flush(RBRBinner *binner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_RBRBINNER_H */
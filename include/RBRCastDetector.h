@@ -0,0 +1,268 @@
+/**
+ * \file RBRCastDetector.h
+ *
+ * \brief Host-side detection of profiling casts from pressure data.
+ *
+ * Instruments only record #RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST,
+ * #RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST, and
+ * #RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST events when regimes or cast
+ * detection were enabled during the deployment (see
+ * RBRInstrument_setCastDetection()). A cast detector produces the same events
+ * on the host from the readings of a pressure or sea pressure channel, for
+ * samples from any source: push parsed or streamed samples into it, and it
+ * delivers events to a callback in the same form as the parser delivers
+ * #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS, so the same code can consume
+ * either.
+ *
+ * Detection is done in a single pass with a fixed amount of state, so there's
+ * no limit on the number of samples. Because a cast can only be recognized
+ * once the pressure has moved far enough, each event is delivered some time
+ * after the sample at which the cast began or ended, and carries the
+ * timestamp of that earlier sample.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_RBRCASTDETECTOR_H
+#define LIBRBR_RBRCASTDETECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "RBRInstrument.h"
+#include "RBRParser.h"
+
+struct RBRCastDetector;
+
+/**
+ * \brief What the instrument was doing, as judged by a cast detector.
+ */
+typedef enum RBRCastDetectorState
+{
+    /** Not enough samples have been seen yet to tell. */
+    RBRCASTDETECTOR_UNKNOWN,
+    /** Holding at a steady pressure; e.g., soaking at the surface. */
+    RBRCASTDETECTOR_SOAK,
+    /** Pressure is increasing. */
+    RBRCASTDETECTOR_DOWN_CAST,
+    /** Pressure is decreasing. */
+    RBRCASTDETECTOR_UP_CAST,
+    /** The number of cast detector states. */
+    RBRCASTDETECTOR_STATE_COUNT,
+    /** An unknown or unrecognized cast detector state. */
+    RBRCASTDETECTOR_UNKNOWN_STATE
+} RBRCastDetectorState;
+
+/**
+ * \brief Get a human-readable string name for a cast detector state.
+ *
+ * \param [in] state the cast detector state
+ * \return a string name for the state
+ * \see RBRInstrumentError_name() for a description of the format of names
+ */
+const char *RBRCastDetectorState_name(RBRCastDetectorState state);
+
+/**
+ * \brief Called by the cast detector for each event.
+ *
+ * The event is one of #RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST,
+ * #RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST, or
+ * #RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST, with no auxiliary data. Every
+ * cast which begins is ended, including when the instrument turns straight
+ * from one cast to the next without holding.
+ *
+ * The event is only valid for the duration of the callback.
+ *
+ * \param [in] detector the cast detector
+ * \param [in] event the event
+ * \return #RBRINSTRUMENT_SUCCESS to continue detection
+ * \return any other value to stop, returned from the function which called
+ *         the callback
+ */
+typedef RBRInstrumentError (*RBRCastDetectorEventCallback)(
+    const struct RBRCastDetector *detector,
+    const struct RBRInstrumentEvent *const event);
+
+/**
+ * \brief Configuration for a RBRCastDetector.
+ */
+typedef struct RBRCastDetectorConfig
+{
+    /**
+     * \brief The index of the pressure or sea pressure channel in each
+     * sample.
+     *
+     * Samples which don't have this channel, or for which its reading is NaN,
+     * are ignored.
+     */
+    int32_t channel;
+
+    /**
+     * \brief How far the pressure must move, in dbar, from its most recent
+     * extreme before a cast is recognized.
+     *
+     * Larger values are less prone to mistaking waves and swell for casts.
+     */
+    double castThreshold;
+
+    /**
+     * \brief How far the pressure may wander, in dbar, while still being
+     * considered steady.
+     */
+    double soakThreshold;
+
+    /**
+     * \brief How long the pressure must be steady, in milliseconds, for a
+     * soak to be recognized.
+     */
+    RBRInstrumentPeriod soakDuration;
+
+    /** \brief Called for each event. */
+    RBRCastDetectorEventCallback event;
+} RBRCastDetectorConfig;
+
+/**
+ * \brief Cast detector context object.
+ *
+ * Users are strongly discouraged from accessing the fields of this structure
+ * directly as layout and field availability maybe unstable from version to
+ * version.
+ *
+ * \see RBRCastDetector_init() to initialize a cast detector
+ * \see RBRCastDetector_destroy() to release a cast detector
+ */
+typedef struct RBRCastDetector
+{
+    /** \brief The cast detector configuration. */
+    RBRCastDetectorConfig config;
+
+    /** \brief The current state. */
+    RBRCastDetectorState state;
+
+    /** \brief The lowest pressure since the last change of state. */
+    double minPressure;
+
+    /** \brief The timestamp of RBRCastDetector.minPressure. */
+    RBRInstrumentDateTime minTimestamp;
+
+    /** \brief The highest pressure since the last change of state. */
+    double maxPressure;
+
+    /** \brief The timestamp of RBRCastDetector.maxPressure. */
+    RBRInstrumentDateTime maxTimestamp;
+
+    /**
+     * \brief The pressure around which readings have been steady, if they
+     * have been.
+     */
+    double steadyPressure;
+
+    /** \brief When the readings became steady. */
+    RBRInstrumentDateTime steadyTimestamp;
+
+    /** \brief The timestamp of the last sample used. */
+    RBRInstrumentDateTime lastTimestamp;
+
+    /** \brief Storage for the event delivered to the callback. */
+    RBRInstrumentEvent eventBuffer;
+
+    /** \brief Arbitrary user data; useful in callbacks. */
+    void *userData;
+
+    /**
+     * \brief Whether the instance memory was dynamically allocated by the
+     * constructor.
+     */
+    bool managedAllocation;
+} RBRCastDetector;
+
+/**
+ * \brief Initialize a cast detector.
+ *
+ * The use of the \a detector argument is the same as that of the
+ * \a instrument argument to RBRInstrument_open(): when given as `NULL`,
+ * instance memory will be allocated for you; otherwise, the pointer target
+ * will be used as instance storage.
+ *
+ * The \a config structure is copied into the detector and no reference to it
+ * is retained.
+ *
+ * \param [in,out] detector the context object to populate
+ * \param [in] config the cast detector configuration
+ * \param [in] userData arbitrary user data; useful in callbacks
+ * \return #RBRINSTRUMENT_SUCCESS if the detector was initialized
+ * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the config is invalid
+ * \see RBRCastDetector_destroy()
+ */
+RBRInstrumentError RBRCastDetector_init(RBRCastDetector **detector,
+                                        const RBRCastDetectorConfig *config,
+                                        void *userData);
+
+/**
+ * \brief Release any resources held by the cast detector.
+ *
+ * \param [in,out] detector the cast detector
+ * \return #RBRINSTRUMENT_SUCCESS if the detector was released successfully
+ * \see RBRCastDetector_init()
+ */
+RBRInstrumentError RBRCastDetector_destroy(RBRCastDetector *detector);
+
+/**
+ * \brief Get the pointer to arbitrary user data.
+ *
+ * \param [in] detector the cast detector
+ * \return the arbitrary user data pointer
+ */
+void *RBRCastDetector_getUserData(const RBRCastDetector *detector);
+
+/**
+ * \brief Get what the instrument is currently judged to be doing.
+ *
+ * \param [in] detector the cast detector
+ * \return the current state
+ */
+RBRCastDetectorState RBRCastDetector_getState(
+    const RBRCastDetector *detector);
+
+/**
+ * \brief Feed a sample to the cast detector.
+ *
+ * Samples are expected in timestamp order.
+ *
+ * The result of this function can be returned directly from a parser or
+ * instrument sample callback.
+ *
+ * \param [in,out] detector the cast detector
+ * \param [in] sample the sample
+ * \return #RBRINSTRUMENT_SUCCESS if the sample was used or ignored
+ * \return any other value returned by the event callback
+ * \see RBRCastDetector_flush()
+ */
+RBRInstrumentError RBRCastDetector_push(RBRCastDetector *detector,
+                                        const RBRInstrumentSample *sample);
+
+/**
+ * \brief End any cast in progress, and start over.
+ *
+ * Call this once all samples have been pushed. A cast in progress is ended at
+ * the timestamp of the last sample. Afterwards, the detector is ready for
+ * another set of samples.
+ *
+ * \param [in,out] detector the cast detector
+ * \return #RBRINSTRUMENT_SUCCESS if detection was finished
+ * \return any other value returned by the event callback
+ */
+RBRInstrumentError RBRCastDetector_flush(RBRCastDetector *detector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_RBRCASTDETECTOR_H */
@@ -0,0 +1,347 @@
+/**
+ * \file RBRDownsampler.h
+ *
+ * \brief Streaming reduction of samples to a bounded number of points for
+ * plotting.
+ *
+ * A month of 8Hz data is over twenty million samples: far more than there are
+ * pixels to draw them on. A downsampler consumes samples one at a time (e.g.,
+ * from RBRParserCallbacks.sample or RBRInstrumentCallbacks.sample) and keeps
+ * no more than a fixed number of representative points for each channel,
+ * however many samples it's given.
+ *
+ * Samples are grouped into buckets of consecutive samples, and each bucket is
+ * reduced to one or two points per channel by the configured method. When the
+ * points fill the space available for them, adjacent buckets are merged in
+ * pairs, halving the number of points, and subsequent buckets are twice as
+ * large. So the memory used is fixed up front, and the points always cover
+ * everything pushed so far at a roughly even density.
+ *
+ * To downsample a dataset as it's parsed, or samples as they're streamed,
+ * pass the downsampler as the parser or instrument user data and push each
+ * sample from the sample callback. Call RBRDownsampler_flush() once the last
+ * sample has been pushed, then plot the points from
+ * RBRDownsampler_getPoints().
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_RBRDOWNSAMPLER_H
+#define LIBRBR_RBRDOWNSAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "RBRInstrument.h"
+
+struct RBRDownsampler;
+
+/**
+ * \brief How each bucket of samples is reduced.
+ */
+typedef enum RBRDownsamplerMethod
+{
+    /**
+     * Keep the first sample of each bucket.
+     *
+     * The cheapest method, but it can miss short-lived features entirely.
+     */
+    RBRDOWNSAMPLER_DECIMATE,
+    /**
+     * Keep the smallest and largest reading of each bucket, in time order.
+     *
+     * Every extreme survives, so spikes are never lost; two points are kept
+     * per bucket.
+     */
+    RBRDOWNSAMPLER_MIN_MAX,
+    /**
+     * Largest-triangle-three-buckets: keep whichever reading of the bucket
+     * forms the largest triangle with the point kept for the previous bucket
+     * and the average of the next bucket.
+     *
+     * Preserves the visual shape of the series with one point per bucket. To
+     * stay streaming, only each bucket's smallest and largest readings are
+     * considered, as in the MinMaxLTTB variant. As in the original algorithm,
+     * the first and last samples are kept as the first and last points, so
+     * two of the points are spent on them.
+     */
+    RBRDOWNSAMPLER_LTTB,
+    /** The number of downsampling methods. */
+    RBRDOWNSAMPLER_METHOD_COUNT,
+    /** An unknown or unrecognized downsampling method. */
+    RBRDOWNSAMPLER_UNKNOWN_METHOD
+} RBRDownsamplerMethod;
+
+/**
+ * \brief Get a human-readable string name for a downsampling method.
+ *
+ * \param [in] method the downsampling method
+ * \return a string name for the downsampling method
+ * \see RBRInstrumentError_name() for a description of the format of names
+ */
+const char *RBRDownsamplerMethod_name(RBRDownsamplerMethod method);
+
+/**
+ * \brief Configuration for a RBRDownsampler.
+ */
+typedef struct RBRDownsamplerConfig
+{
+    /** \brief How each bucket of samples is reduced. */
+    RBRDownsamplerMethod method;
+
+    /**
+     * \brief The number of channels to keep points for.
+     *
+     * Readings beyond this count are ignored. Must be between 1 and
+     * #RBRINSTRUMENT_CHANNEL_MAX.
+     */
+    int32_t channels;
+
+    /**
+     * \brief The most points to keep for each channel.
+     *
+     * Must be a positive multiple of 4, so that buckets can always be merged
+     * in pairs.
+     */
+    int32_t capacity;
+
+    /**
+     * \brief The number of samples in each bucket to begin with.
+     *
+     * Must be at least 1. When the number of samples is known in advance
+     * (e.g., the size of a dataset divided by its record size), choosing a
+     * bucket size which fills about half of the capacity means buckets never
+     * need to be merged. Otherwise, 1 is a fine choice: buckets grow as
+     * needed.
+     */
+    int32_t bucketSize;
+} RBRDownsamplerConfig;
+
+/**
+ * \brief A point kept by a downsampler.
+ */
+typedef struct RBRDownsamplerPoint
+{
+    /** \brief The timestamp of the sample the point came from. */
+    RBRInstrumentDateTime timestamp;
+    /** \brief The reading. */
+    double value;
+} RBRDownsamplerPoint;
+
+/**
+ * \brief The running summary of one channel of a bucket.
+ *
+ * Users should not need to use this structure directly.
+ */
+typedef struct RBRDownsamplerBucket
+{
+    /** \brief The smallest reading in the bucket. */
+    RBRDownsamplerPoint minimum;
+    /** \brief The largest reading in the bucket. */
+    RBRDownsamplerPoint maximum;
+    /**
+     * \brief The sum of timestamps, relative to the first sample (LTTB
+     * only).
+     */
+    double timeSum;
+    /** \brief The sum of readings (LTTB only). */
+    double valueSum;
+    /** \brief The number of readings which weren't NaN. */
+    int32_t count;
+} RBRDownsamplerBucket;
+
+/**
+ * \brief Downsampler context object.
+ *
+ * Users are strongly discouraged from accessing the fields of this structure
+ * directly as layout and field availability maybe unstable from version to
+ * version.
+ *
+ * \see RBRDownsampler_init() to initialize a downsampler
+ * \see RBRDownsampler_destroy() to release a downsampler
+ */
+typedef struct RBRDownsampler
+{
+    /** \brief The downsampler configuration. */
+    RBRDownsamplerConfig config;
+
+    /**
+     * \brief Point storage: RBRDownsamplerConfig.capacity points for each
+     * channel in turn.
+     */
+    RBRDownsamplerPoint *points;
+
+    /** \brief The number of points kept for each channel. */
+    int32_t length;
+
+    /** \brief The number of samples in each bucket. */
+    int64_t bucketSize;
+
+    /** \brief The number of samples in the current bucket. */
+    int64_t count;
+
+    /** \brief The number of samples pushed. */
+    int64_t samples;
+
+    /** \brief The timestamp of the first sample pushed. */
+    RBRInstrumentDateTime origin;
+
+    /** \brief The timestamp of the first sample of the current bucket. */
+    RBRInstrumentDateTime bucketStart;
+
+    /** \brief The current bucket. */
+    RBRDownsamplerBucket current[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief Whether there's a bucket awaiting selection (LTTB only). */
+    bool hasPending;
+
+    /** \brief The timestamp of the first sample of the pending bucket. */
+    RBRInstrumentDateTime pendingStart;
+
+    /**
+     * \brief The last bucket to be completed, awaiting selection of its
+     * point once the average of the next bucket is known (LTTB only).
+     */
+    RBRDownsamplerBucket pending[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief The most recent sample pushed: the reference point for the last
+     * bucket, and the last point once flushed (LTTB only).
+     */
+    RBRDownsamplerPoint last[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief Arbitrary user data; useful in callbacks. */
+    void *userData;
+
+    /**
+     * \brief Whether the instance memory was dynamically allocated by the
+     * constructor.
+     */
+    bool managedAllocation;
+
+    /**
+     * \brief Whether the point storage was dynamically allocated by the
+     * constructor.
+     */
+    bool managedBuffer;
+} RBRDownsampler;
+
+/**
+ * \brief Get the number of bytes of point storage needed by a downsampler.
+ *
+ * \param [in] config the downsampler configuration
+ * \return the size of the storage buffer, in bytes
+ * \see RBRDownsampler_init()
+ */
+int32_t RBRDownsampler_bufferSize(const RBRDownsamplerConfig *config);
+
+/**
+ * \brief Initialize a downsampler.
+ *
+ * The use of the \a downsampler argument is the same as that of the
+ * \a instrument argument to RBRInstrument_open(): when given as `NULL`,
+ * instance memory will be allocated for you; otherwise, the pointer target
+ * will be used as instance storage. Likewise, when \a buffer is given as
+ * `NULL`, point storage will be allocated for you; otherwise, it must be at
+ * least RBRDownsampler_bufferSize() bytes long and suitably aligned for an
+ * RBRDownsamplerPoint.
+ *
+ * The \a config structure is copied into the downsampler and no reference to
+ * it is retained.
+ *
+ * In the event of any return value other than #RBRINSTRUMENT_SUCCESS, any
+ * memory allocated by this constructor is freed.
+ *
+ * \param [in,out] downsampler the context object to populate
+ * \param [in] config the downsampler configuration
+ * \param [in] buffer point storage, or `NULL` to allocate it
+ * \param [in] userData arbitrary user data; useful in callbacks
+ * \return #RBRINSTRUMENT_SUCCESS if the downsampler was initialized
+ * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the config is invalid
+ * \see RBRDownsampler_destroy()
+ */
+RBRInstrumentError RBRDownsampler_init(RBRDownsampler **downsampler,
+                                       const RBRDownsamplerConfig *config,
+                                       void *buffer,
+                                       void *userData);
+
+/**
+ * \brief Release any resources held by the downsampler.
+ *
+ * \param [in,out] downsampler the downsampler
+ * \return #RBRINSTRUMENT_SUCCESS if the downsampler was released successfully
+ * \see RBRDownsampler_init()
+ */
+RBRInstrumentError RBRDownsampler_destroy(RBRDownsampler *downsampler);
+
+/**
+ * \brief Get the pointer to arbitrary user data.
+ *
+ * \param [in] downsampler the downsampler
+ * \return the arbitrary user data pointer
+ */
+void *RBRDownsampler_getUserData(const RBRDownsampler *downsampler);
+
+/**
+ * \brief Add a sample to the downsampler.
+ *
+ * Samples must be pushed in timestamp order. NaN readings are ignored, except
+ * that a bucket with no other readings for a channel yields NaN points.
+ *
+ * Costs a constant amount of work per sample, plus an occasional merge of
+ * all points kept so far when space runs out. Since the merge halves the
+ * number of points, and doubles the number of samples needed to fill that
+ * space again, it adds only a constant amount of work per sample overall.
+ *
+ * The result of this function can be returned directly from a parser or
+ * instrument sample callback.
+ *
+ * \param [in,out] downsampler the downsampler
+ * \param [in] sample the sample to add
+ * \return #RBRINSTRUMENT_SUCCESS
+ * \see RBRDownsampler_flush()
+ */
+RBRInstrumentError RBRDownsampler_push(RBRDownsampler *downsampler,
+                                       const RBRInstrumentSample *sample);
+
+/**
+ * \brief Emit points for any samples which are still in incomplete buckets.
+ *
+ * Until a bucket is complete (and, for #RBRDOWNSAMPLER_LTTB, until the bucket
+ * after it is complete), its samples aren't represented by any point. Call
+ * this once all samples have been pushed. For #RBRDOWNSAMPLER_LTTB, this also
+ * adds the last sample as the last point.
+ *
+ * \param [in,out] downsampler the downsampler
+ * \return #RBRINSTRUMENT_SUCCESS
+ */
+RBRInstrumentError RBRDownsampler_flush(RBRDownsampler *downsampler);
+
+/**
+ * \brief Get the points kept for a channel.
+ *
+ * The points are in timestamp order. The same number is kept for every
+ * channel. The pointer remains valid until the next push or flush.
+ *
+ * \param [in] downsampler the downsampler
+ * \param [in] channel the zero-based channel index
+ * \param [out] length the number of points
+ * \return the points, or `NULL` if \a channel is out of range
+ */
+const RBRDownsamplerPoint *RBRDownsampler_getPoints(
+    const RBRDownsampler *downsampler,
+    int32_t channel,
+    int32_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_RBRDOWNSAMPLER_H */
@@ -22,6 +22,7 @@ extern "C" {
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "RBRInstrumentHardwareErrors.h"
@@ -93,6 +94,59 @@ extern const char *RBRINSTRUMENT_LIB_BUILD_DATE;
 #define RBRINSTRUMENT_CHANNEL_MAX 32
 #endif
 
+/**
+ * \brief Whether to keep per-connection I/O and command statistics.
+ *
+ * When defined as 0, the counters are compiled out of the library entirely:
+ * RBRInstrument gets smaller, no bookkeeping is done during instrument
+ * communication, and RBRInstrument_getStatistics() returns
+ * #RBRINSTRUMENT_UNSUPPORTED. Because the layout of RBRInstrument depends on
+ * this setting, the library and your code must be built with the same value.
+ */
+#ifndef RBRINSTRUMENT_STATISTICS
+#define RBRINSTRUMENT_STATISTICS 1
+#endif
+
+/**
+ * \brief The number of distinct commands for which statistics are kept.
+ *
+ * Commands are tracked by their first word. Once this many different commands
+ * have been seen, latency is not recorded for any new ones.
+ */
+#ifndef RBRINSTRUMENT_STATISTICS_COMMAND_MAX
+#define RBRINSTRUMENT_STATISTICS_COMMAND_MAX 16
+#endif
+
+/**
+ * \brief The number of buckets in each command latency histogram.
+ *
+ * Bucket 0 counts latencies of 0ms; bucket _n_ counts latencies of at least
+ * 2^(_n_-1)ms but less than 2^_n_ms. The last bucket also counts everything
+ * longer. The default of 16 buckets resolves latencies up to about 16 seconds.
+ *
+ * \see RBRInstrumentCommandStatistics.histogram
+ */
+#ifndef RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS
+#define RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS 16
+#endif
+
+/**
+ * \brief The number of per-command timeout overrides which can be set.
+ *
+ * \see RBRInstrument_setCommandTimeoutOverride()
+ */
+#ifndef RBRINSTRUMENT_COMMAND_TIMEOUT_OVERRIDE_MAX
+#define RBRINSTRUMENT_COMMAND_TIMEOUT_OVERRIDE_MAX 8
+#endif
+
+/**
+ * \brief The maximum length of a command word tracked by statistics and
+ * timeout overrides, excluding the null terminator.
+ *
+ * Longer command words are truncated.
+ */
+#define RBRINSTRUMENT_COMMAND_NAME_MAX 15
+
 /** \brief Stringize the result of macro expansion. */
 #define xstr(s) str(s)
 /** \brief Stringize the macro argument. */
@@ -477,11 +531,144 @@ typedef RBRInstrumentError (*RBRInstrumentSampleCallback)(
     const struct RBRInstrument *instrument,
     const struct RBRInstrumentSample *const sample);
 
+/**
+ * \brief Callback to feed a batch of streaming sample data into user code.
+ *
+ * Library functions will call this user code when
+ * RBRInstrumentCallbacks.sampleBatchBuffer has been filled with
+ * RBRInstrumentCallbacks.sampleBatchSize samples, when the first sample in the
+ * batch is older than RBRInstrumentCallbacks.sampleBatchTimeout, or when
+ * RBRInstrument_flushSamples() is called.
+ *
+ * The \a samples pointer will be the same as given via
+ * RBRInstrumentCallbacks.sampleBatchBuffer. Samples are parsed directly into
+ * that buffer, and it will begin to be overwritten as soon as the callback
+ * returns. If you want to use the samples after your callback has returned,
+ * make a copy of them.
+ *
+ * \param [in] instrument the instrument from which the samples were received
+ * \param [in] samples the samples received from the instrument
+ * \param [in] count the number of samples in \a samples
+ * \return #RBRINSTRUMENT_SUCCESS when the sample data is successfully consumed
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR when an unrecoverable error occurs
+ * \see RBRInstrumentSampleCallback() for the non-batched equivalent
+ */
+typedef RBRInstrumentError (*RBRInstrumentSampleBatchCallback)(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentSample *const samples,
+    int32_t count);
+
+/** \brief Kinds of low-level instrument activity reported to trace hooks. */
+typedef enum RBRInstrumentTraceType
+{
+    /** Data was read from the instrument. */
+    RBRINSTRUMENT_TRACE_READ,
+    /** Data was written to the instrument. */
+    RBRINSTRUMENT_TRACE_WRITE,
+    /** The library waited for the instrument. */
+    RBRINSTRUMENT_TRACE_SLEEP,
+    /** The instrument was woken; spans the writes and sleeps involved. */
+    RBRINSTRUMENT_TRACE_WAKE,
+    /** The number of trace types. */
+    RBRINSTRUMENT_TRACE_TYPE_COUNT,
+    /** An unknown or unrecognized trace type. */
+    RBRINSTRUMENT_UNKNOWN_TRACE_TYPE
+} RBRInstrumentTraceType;
+
+/**
+ * \brief Get a human-readable string name for a trace type.
+ *
+ * \param [in] type the trace type
+ * \return a string name for the trace type
+ * \see RBRInstrumentError_name() for a description of the format of names
+ */
+const char *RBRInstrumentTraceType_name(RBRInstrumentTraceType type);
+
+/**
+ * \brief A single low-level instrument activity reported to a trace hook.
+ *
+ * \see RBRInstrumentTraceCallback()
+ */
+typedef struct RBRInstrumentTraceRecord
+{
+    /** \brief The kind of activity. */
+    RBRInstrumentTraceType type;
+
+    /**
+     * \brief When the activity began, in microseconds.
+     *
+     * \see RBRInstrumentTraceTimeCallback()
+     */
+    int64_t begin;
+
+    /** \brief When the activity ended, in microseconds. */
+    int64_t end;
+
+    /**
+     * \brief The bytes read or written.
+     *
+     * Valid only for the duration of the trace callback. `NULL` for sleeps
+     * and wakes.
+     */
+    const void *data;
+
+    /**
+     * \brief The number of bytes in RBRInstrumentTraceRecord.data.
+     *
+     * For sleeps, the requested sleep duration in milliseconds instead.
+     */
+    int32_t size;
+
+    /** \brief The result returned by the underlying callback. */
+    RBRInstrumentError result;
+} RBRInstrumentTraceRecord;
+
+/**
+ * \brief Callback to get a monotonic timestamp for trace records.
+ *
+ * Like RBRInstrumentTimeCallback(), but in microseconds so that individual
+ * reads and writes can be told apart. On POSIX systems, the value can easily
+ * be based on CLOCK_MONOTONIC.
+ *
+ * \param [in] instrument the instrument being traced
+ * \param [out] time the current platform time in microseconds
+ * \return #RBRINSTRUMENT_SUCCESS when the time is successfully retrieved
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR when an unrecoverable error occurs
+ */
+typedef RBRInstrumentError (*RBRInstrumentTraceTimeCallback)(
+    const struct RBRInstrument *instrument,
+    int64_t *time);
+
+/**
+ * \brief Callback to observe low-level instrument activity.
+ *
+ * Library functions will call this user code after every call they make to
+ * the read, write, and sleep callbacks, and after each instrument wake
+ * sequence. Records are delivered in the order in which the activity
+ * finished, so a wake record follows the write and sleep records it spans.
+ *
+ * Reads and writes are reported whether or not they succeeded; check
+ * RBRInstrumentTraceRecord.result. As with the sample callback, any data
+ * referenced by the record must be copied if it is to be used after the
+ * callback returns, and the callback should execute quickly to avoid skewing
+ * the timing being measured.
+ *
+ * \param [in] instrument the instrument being traced
+ * \param [in] record the activity
+ * \return #RBRINSTRUMENT_SUCCESS when the record is successfully consumed
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR when an unrecoverable error occurs
+ */
+typedef RBRInstrumentError (*RBRInstrumentTraceCallback)(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentTraceRecord *record);
+
 /**
  * \brief A set of callbacks from library to user code.
  *
  * RBRInstrument_open() requires all callbacks to be populated except for
- * RBRInstrumentCallbacks.sample, which may be `NULL` when undesired.
+ * RBRInstrumentCallbacks.sample, RBRInstrumentCallbacks.sampleBatch,
+ * RBRInstrumentCallbacks.trace, and RBRInstrumentCallbacks.traceTime, which
+ * may be `NULL` when undesired.
  */
 typedef struct RBRInstrumentCallbacks
 {
@@ -511,6 +698,61 @@ typedef struct RBRInstrumentCallbacks
      * Required only when RBRInstrumentCallbacks.sample is populated.
      */
     struct RBRInstrumentSample *sampleBuffer;
+
+    /**
+     * \brief Called when a batch of streaming sample data has been received.
+     *
+     * Optional, but requires that RBRInstrumentCallbacks.sampleBatchBuffer
+     * and RBRInstrumentCallbacks.sampleBatchSize also be populated. When
+     * given, streaming samples are delivered only via this callback;
+     * RBRInstrumentCallbacks.sample will not be called.
+     */
+    RBRInstrumentSampleBatchCallback sampleBatch;
+
+    /**
+     * \brief Where to accumulate sample data for consumption by the batch
+     * callback.
+     *
+     * Must have room for at least RBRInstrumentCallbacks.sampleBatchSize
+     * samples. Required only when RBRInstrumentCallbacks.sampleBatch is
+     * populated.
+     */
+    struct RBRInstrumentSample *sampleBatchBuffer;
+
+    /**
+     * \brief The number of samples in RBRInstrumentCallbacks.sampleBatchBuffer.
+     *
+     * Must be greater than 0 when RBRInstrumentCallbacks.sampleBatch is
+     * populated.
+     */
+    int32_t sampleBatchSize;
+
+    /**
+     * \brief How long to hold a partial batch before delivering it.
+     *
+     * Specified in milliseconds, as measured by RBRInstrumentCallbacks.time,
+     * from the time the first sample in the batch was parsed. The deadline is
+     * checked whenever a sample is parsed and whenever a response read
+     * begins, so a batch can be delivered late if the instrument goes quiet.
+     * When 0, batches are delivered only when full or when
+     * RBRInstrument_flushSamples() is called.
+     */
+    RBRInstrumentDateTime sampleBatchTimeout;
+
+    /**
+     * \brief Called after each low-level read, write, sleep, and wake.
+     *
+     * Optional.
+     */
+    RBRInstrumentTraceCallback trace;
+
+    /**
+     * \brief Callback to timestamp trace records in microseconds.
+     *
+     * Optional. When not given, RBRInstrumentCallbacks.time is used instead
+     * and its result multiplied by 1,000.
+     */
+    RBRInstrumentTraceTimeCallback traceTime;
 } RBRInstrumentCallbacks;
 
 /**
@@ -581,6 +823,146 @@ typedef struct RBRInstrumentResponse
     char *response;
 } RBRInstrumentResponse;
 
+/**
+ * \brief Latency statistics for a single command.
+ *
+ * Latency is measured from immediately before the command is sent until its
+ * response has been received, using RBRInstrumentCallbacks.time. Commands
+ * which time out or fail in the callbacks are not included.
+ *
+ * \see RBRInstrumentStatistics
+ */
+typedef struct RBRInstrumentCommandStatistics
+{
+    /** \brief The first word of the command. */
+    char command[RBRINSTRUMENT_COMMAND_NAME_MAX + 1];
+    /** \brief The number of responses received to the command. */
+    int32_t count;
+    /** \brief The shortest latency, in milliseconds. */
+    RBRInstrumentDateTime minLatency;
+    /** \brief The longest latency, in milliseconds. */
+    RBRInstrumentDateTime maxLatency;
+    /**
+     * \brief The sum of all latencies, in milliseconds.
+     *
+     * Divide by RBRInstrumentCommandStatistics.count for the mean.
+     */
+    RBRInstrumentDateTime totalLatency;
+    /**
+     * \brief The distribution of latencies.
+     *
+     * \see RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS for the bucket bounds
+     */
+    int32_t histogram[RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS];
+} RBRInstrumentCommandStatistics;
+
+/**
+ * \brief Counters describing the activity of an instrument connection.
+ *
+ * \see RBRInstrument_getStatistics()
+ * \see RBRINSTRUMENT_STATISTICS
+ */
+typedef struct RBRInstrumentStatistics
+{
+    /** \brief The number of bytes received via the read callback. */
+    int64_t bytesRead;
+    /** \brief The number of bytes sent via the write callback. */
+    int64_t bytesWritten;
+    /** \brief The number of times the read callback has been invoked. */
+    int32_t reads;
+    /** \brief The number of complete lines received and parsed. */
+    int32_t responses;
+    /** \brief The number of streaming samples parsed. */
+    int32_t samples;
+    /**
+     * \brief The number of responses passed over while waiting for a command
+     * response.
+     *
+     * Typically, these are streaming samples which arrived before the response
+     * to a command.
+     */
+    int32_t skippedResponses;
+    /**
+     * \brief The number of times the response buffer filled without a line
+     * terminator and was discarded.
+     *
+     * \see RBRINSTRUMENT_RESPONSE_BUFFER_MAX
+     */
+    int32_t responseBufferOverflows;
+    /**
+     * \brief The number of times a command was resent due to an “E0102
+     * invalid command” error caused by garbage preceding the command, or
+     * because a timeout derived from observed latency expired.
+     *
+     * \see RBRInstrumentAdaptiveTimeout
+     */
+    int32_t commandRetries;
+    /** \brief The number of wake sequences sent to the instrument. */
+    int32_t wakes;
+    /** \brief The number of data reads which failed their checksum. */
+    int32_t checksumErrors;
+    /**
+     * \brief The number of populated entries in
+     * RBRInstrumentStatistics.commands.
+     */
+    int32_t commandsLength;
+    /** \brief Per-command latency, in order of first use. */
+    RBRInstrumentCommandStatistics
+        commands[RBRINSTRUMENT_STATISTICS_COMMAND_MAX];
+} RBRInstrumentStatistics;
+
+/**
+ * \brief A command timeout which takes precedence over all others.
+ *
+ * \see RBRInstrument_setCommandTimeoutOverride()
+ */
+typedef struct RBRInstrumentCommandTimeout
+{
+    /** \brief The first word of the command. */
+    char command[RBRINSTRUMENT_COMMAND_NAME_MAX + 1];
+    /** \brief The timeout, in milliseconds. */
+    RBRInstrumentDateTime timeout;
+} RBRInstrumentCommandTimeout;
+
+/**
+ * \brief Configuration for deriving command timeouts from observed latency.
+ *
+ * Once a command has received at least
+ * RBRInstrumentAdaptiveTimeout.minObservations responses, its timeout is
+ * derived from its latency histogram: the upper bound of the bucket containing
+ * the requested percentile (or the longest latency seen, if that's shorter) is
+ * multiplied by RBRInstrumentAdaptiveTimeout.multiplier. The result is never
+ * less than RBRInstrumentAdaptiveTimeout.minimum or more than the general
+ * command timeout. Commands without enough observations use the general
+ * command timeout.
+ *
+ * A command can become slower than its derived timeout allows. When a derived
+ * timeout expires, the command is sent once more with the general command
+ * timeout, and the latency of that attempt is observed so that the derived
+ * timeout can grow. Such retries are counted in
+ * RBRInstrumentStatistics.commandRetries.
+ *
+ * \see RBRInstrument_setAdaptiveTimeout()
+ */
+typedef struct RBRInstrumentAdaptiveTimeout
+{
+    /** \brief Whether to derive timeouts from observed latency. */
+    bool enabled;
+    /** \brief The percentile of latency to use, from 1 to 100. */
+    int32_t percentile;
+    /** \brief The factor by which to scale the percentile latency. */
+    int32_t multiplier;
+    /** \brief How many responses to see before adapting the timeout. */
+    int32_t minObservations;
+    /**
+     * \brief The shortest timeout to use, in milliseconds.
+     *
+     * Must be at least 1: a command whose responses always arrive within a
+     * millisecond would otherwise be given no time at all.
+     */
+    RBRInstrumentDateTime minimum;
+} RBRInstrumentAdaptiveTimeout;
+
 /**
  * \brief Core library context object.
  *
@@ -619,6 +1001,27 @@ typedef struct RBRInstrument
      */
     RBRInstrumentDateTime commandTimeout;
 
+    /**
+     * \brief The timeout for the response currently being awaited.
+     *
+     * Set by RBRInstrument_converse() for the duration of a command. When
+     * negative, RBRInstrument.commandTimeout applies.
+     */
+    RBRInstrumentDateTime responseTimeout;
+
+    /** \brief How to derive command timeouts from observed latency. */
+    RBRInstrumentAdaptiveTimeout adaptiveTimeout;
+
+    /**
+     * \brief The number of populated entries in
+     * RBRInstrument.timeoutOverrides.
+     */
+    int32_t timeoutOverridesLength;
+
+    /** \brief Per-command timeouts set by the user. */
+    RBRInstrumentCommandTimeout
+        timeoutOverrides[RBRINSTRUMENT_COMMAND_TIMEOUT_OVERRIDE_MAX];
+
     /** \brief Arbitrary user data; useful in callbacks. */
     void *userData;
 
@@ -672,6 +1075,29 @@ typedef struct RBRInstrument
      */
     RBRInstrumentResponse response;
 
+    /**
+     * \brief The number of samples waiting in
+     * RBRInstrumentCallbacks.sampleBatchBuffer.
+     */
+    int32_t sampleBatchLength;
+
+    /**
+     * \brief The time at which the first sample in the current batch was
+     * parsed.
+     *
+     * Used to determine when a partial batch is due for delivery.
+     */
+    RBRInstrumentDateTime sampleBatchStartTime;
+
+#if RBRINSTRUMENT_STATISTICS
+    /**
+     * \brief I/O and command statistics.
+     *
+     * \see RBRInstrument_getStatistics()
+     */
+    RBRInstrumentStatistics statistics;
+#endif
+
     /**
      * \brief Whether the instance memory was dynamically allocated by the
      * constructor.
@@ -725,11 +1151,17 @@ typedef struct RBRInstrument
  * The \a callbacks structure will be copied into the RBRInstrument structure;
  * no reference to it is retained, so any subsequent modifications will not
  * affect the connection. All callbacks must be given except for
- * RBRInstrumentCallbacks.sample. If any others are given as null pointers,
- * #RBRINSTRUMENT_MISSING_CALLBACK is returned and the instrument connection
- * will not be opened. RBRInstrumentCallbacks.sample is given, then
+ * RBRInstrumentCallbacks.sample and RBRInstrumentCallbacks.sampleBatch. If any
+ * others are given as null pointers, #RBRINSTRUMENT_MISSING_CALLBACK is
+ * returned and the instrument connection will not be opened.
+ * RBRInstrumentCallbacks.sample is given, then
  * RBRInstrumentCallbacks.sampleBuffer must also be given; if it is not,
- * #RBRINSTRUMENT_MISSING_CALLBACK is returned.
+ * #RBRINSTRUMENT_MISSING_CALLBACK is returned. Likewise,
+ * RBRInstrumentCallbacks.sampleBatch requires
+ * RBRInstrumentCallbacks.sampleBatchBuffer; and if
+ * RBRInstrumentCallbacks.sampleBatchSize is not positive or
+ * RBRInstrumentCallbacks.sampleBatchTimeout is negative,
+ * #RBRINSTRUMENT_INVALID_PARAMETER_VALUE is returned.
  *
  * Whenever callbacks are called, the data passed to them should be handled
  * immediately. The pointers passed will coincide with buffers within the
@@ -754,6 +1186,8 @@ typedef struct RBRInstrument
  * \return #RBRINSTRUMENT_SUCCESS if the instrument was opened successfully
  * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
  * \return #RBRINSTRUMENT_MISSING_CALLBACK if a callback was not provided
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the sample batch
+ *                                                configuration is invalid
  * \return #RBRINSTRUMENT_TIMEOUT if an instrument communication timeout occurs
  * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
  * \return #RBRINSTRUMENT_UNSUPPORTED if the instrument is unsupported
@@ -805,6 +1239,78 @@ RBRInstrumentDateTime RBRInstrument_getCommandTimeout(
 void RBRInstrument_setCommandTimeout(RBRInstrument *instrument,
                                      RBRInstrumentDateTime commandTimeout);
 
+/**
+ * \brief Set the timeout for a specific command.
+ *
+ * Whenever a command whose first word matches \a command is sent, \a timeout
+ * is used in place of both the adaptive and the general command timeout. It
+ * may be longer than the general command timeout; this is useful for commands
+ * known to be slow, like `memclear`.
+ *
+ * \param [in,out] instrument the instrument connection
+ * \param [in] command the command word
+ * \param [in] timeout the timeout in milliseconds, or a negative value to
+ *                     remove any existing override
+ * \return #RBRINSTRUMENT_SUCCESS when the override has been set or removed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when the command word is
+ *                                                empty or too long
+ * \return #RBRINSTRUMENT_BUFFER_TOO_SMALL when the maximum number of
+ *                                        overrides are already set
+ * \see RBRINSTRUMENT_COMMAND_NAME_MAX
+ * \see RBRINSTRUMENT_COMMAND_TIMEOUT_OVERRIDE_MAX
+ * \see RBRInstrument_getEffectiveCommandTimeout()
+ */
+RBRInstrumentError RBRInstrument_setCommandTimeoutOverride(
+    RBRInstrument *instrument,
+    const char *command,
+    RBRInstrumentDateTime timeout);
+
+/**
+ * \brief Get the adaptive timeout configuration.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [out] adaptiveTimeout the adaptive timeout configuration
+ * \see RBRInstrument_setAdaptiveTimeout()
+ */
+void RBRInstrument_getAdaptiveTimeout(
+    const RBRInstrument *instrument,
+    RBRInstrumentAdaptiveTimeout *adaptiveTimeout);
+
+/**
+ * \brief Configure command timeouts derived from observed latency.
+ *
+ * Adaptive timeouts are disabled by default. Because they're based on the
+ * latency histograms in RBRInstrumentStatistics, they are unavailable when
+ * #RBRINSTRUMENT_STATISTICS is 0, and they restart from scratch when
+ * RBRInstrument_resetStatistics() is called.
+ *
+ * \param [in,out] instrument the instrument connection
+ * \param [in] adaptiveTimeout the adaptive timeout configuration
+ * \return #RBRINSTRUMENT_SUCCESS when the configuration has been applied
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when the configuration is
+ *                                                out of range
+ * \return #RBRINSTRUMENT_UNSUPPORTED when statistics are disabled
+ * \see RBRInstrumentAdaptiveTimeout for how timeouts are derived
+ */
+RBRInstrumentError RBRInstrument_setAdaptiveTimeout(
+    RBRInstrument *instrument,
+    const RBRInstrumentAdaptiveTimeout *adaptiveTimeout);
+
+/**
+ * \brief Get the timeout which would apply to a command.
+ *
+ * Takes into account, in order of precedence, any override set with
+ * RBRInstrument_setCommandTimeoutOverride(), any timeout derived from
+ * observed latency, and the general command timeout.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] command the command word
+ * \return the timeout in milliseconds
+ */
+RBRInstrumentDateTime RBRInstrument_getEffectiveCommandTimeout(
+    const RBRInstrument *instrument,
+    const char *command);
+
 /**
  * \brief Get the pointer to arbitrary user data.
  *
@@ -887,6 +1393,35 @@ RBRInstrumentHardwareError RBRInstrument_getLastHardwareError(
 const char *RBRInstrument_getLastHardwareErrorMessage(
     const RBRInstrument *instrument);
 
+/**
+ * \brief Get the I/O and command statistics for the connection.
+ *
+ * Counters accumulate from the time the connection is opened (including the
+ * commands issued by RBRInstrument_open() itself) until they are cleared with
+ * RBRInstrument_resetStatistics().
+ *
+ * \param [in] instrument the instrument connection
+ * \param [out] statistics the connection statistics
+ * \return #RBRINSTRUMENT_SUCCESS when the statistics have been retrieved
+ * \return #RBRINSTRUMENT_UNSUPPORTED when the library was built with
+ *                                    #RBRINSTRUMENT_STATISTICS set to 0
+ * \see RBRInstrument_resetStatistics()
+ */
+RBRInstrumentError RBRInstrument_getStatistics(
+    const RBRInstrument *instrument,
+    RBRInstrumentStatistics *statistics);
+
+/**
+ * \brief Clear the I/O and command statistics for the connection.
+ *
+ * \param [in,out] instrument the instrument connection
+ * \return #RBRINSTRUMENT_SUCCESS when the statistics have been cleared
+ * \return #RBRINSTRUMENT_UNSUPPORTED when the library was built with
+ *                                    #RBRINSTRUMENT_STATISTICS set to 0
+ * \see RBRInstrument_getStatistics()
+ */
+RBRInstrumentError RBRInstrument_resetStatistics(RBRInstrument *instrument);
+
 /* To help keep declarations and documentation organized and discoverable,
  * instrument commands and structures are broken out into individual
  * categorical headers. */
@@ -508,21 +508,123 @@ typedef struct RBRInstrumentSample
     double readings[RBRINSTRUMENT_CHANNEL_MAX];
 } RBRInstrumentSample;
 
+/**
+ * \brief A compact instrument sample.
+ *
+ * RBRInstrumentSample has room for #RBRINSTRUMENT_CHANNEL_MAX double-precision
+ * readings regardless of how many channels the instrument actually has. When
+ * samples need to be held in bulk (queues, ring buffers, archives), this
+ * representation takes only as much space as the channel count requires, and
+ * stores readings in single precision, which is all that EasyParse data
+ * carries anyway.
+ *
+ * Because RBRInstrumentCompactSample.readings is a flexible array member,
+ * instances can't be declared directly: allocate
+ * RBRINSTRUMENT_COMPACT_SAMPLE_SIZE() bytes for each sample instead. Arrays of
+ * compact samples must likewise be addressed with that stride rather than with
+ * subscripts.
+ *
+ * \see RBRInstrumentCompactSample_fromSample() to compact a sample
+ * \see RBRInstrumentCompactSample_toSample() to expand a compact sample
+ */
+typedef struct RBRInstrumentCompactSample
+{
+    /** \brief The timestamp of the sample. */
+    RBRInstrumentDateTime timestamp;
+    /** \brief The number of sample readings. */
+    int32_t channels;
+    /**
+     * \brief The sample readings.
+     *
+     * As for RBRInstrumentSample.readings, but in single precision. Errors
+     * encoded in NaN readings are preserved by the conversion functions.
+     */
+    float readings[];
+} RBRInstrumentCompactSample;
+
+/**
+ * \brief The number of bytes occupied by a compact sample.
+ *
+ * The result is rounded up to the alignment of the timestamp so that compact
+ * samples of the same channel count can be packed back-to-back.
+ *
+ * \param [in] channels the number of channels in the sample
+ */
+#define RBRINSTRUMENT_COMPACT_SAMPLE_SIZE(channels) \
+    (((int32_t) offsetof(RBRInstrumentCompactSample, readings) \
+      + (int32_t) sizeof(float) * (channels) \
+      + (int32_t) sizeof(RBRInstrumentDateTime) - 1) \
+     / (int32_t) sizeof(RBRInstrumentDateTime) \
+     * (int32_t) sizeof(RBRInstrumentDateTime))
+
+/**
+ * \brief Convert a sample into its compact representation.
+ *
+ * The destination must have room for at least
+ * RBRINSTRUMENT_COMPACT_SAMPLE_SIZE(sample->channels) bytes. Readings are
+ * narrowed to single precision; error flags and values encoded in NaN
+ * readings are carried over.
+ *
+ * \param [out] compact the compact sample
+ * \param [in] sample the sample to convert
+ * \see RBRInstrumentCompactSample_toSample() for the inverse operation
+ */
+void RBRInstrumentCompactSample_fromSample(
+    RBRInstrumentCompactSample *compact,
+    const RBRInstrumentSample *sample);
+
+/**
+ * \brief Convert a compact sample into a full sample.
+ *
+ * Readings beyond RBRInstrumentCompactSample.channels are set to 0, as they
+ * would be for a sample received from the instrument.
+ *
+ * \param [out] sample the sample
+ * \param [in] compact the compact sample to convert
+ * \see RBRInstrumentCompactSample_fromSample() for the inverse operation
+ */
+void RBRInstrumentCompactSample_toSample(
+    RBRInstrumentSample *sample,
+    const RBRInstrumentCompactSample *compact);
+
 /**
  * \brief Retrieve and parse data streamed from the instrument.
  *
  * This function waits for a streamed sample to arrive, parses it, then calls
  * the RBRInstrumentSampleCallback provided to the instrument via
- * RBRInstrumentCallbacks.sample.
+ * RBRInstrumentCallbacks.sample. If RBRInstrumentCallbacks.sampleBatch was
+ * provided instead, the sample is added to the current batch, and the batch
+ * callback is called only once the batch is full or overdue.
  *
  * \param [in] instrument the instrument connection
  * \return #RBRINSTRUMENT_SUCCESS when a streaming sample has been read
  * \return #RBRINSTRUMENT_TIMEOUT when a timeout occurs
  * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
  * \see RBRInstrument_fetchSample() for on-demand sample fetching
+ * \see RBRInstrument_flushSamples() to deliver a partial batch
  */
 RBRInstrumentError RBRInstrument_readSample(RBRInstrument *instrument);
 
+/**
+ * \brief Deliver any batched streaming samples immediately.
+ *
+ * If RBRInstrumentCallbacks.sampleBatch was given and any samples are waiting
+ * in RBRInstrumentCallbacks.sampleBatchBuffer, they are passed to the batch
+ * callback regardless of whether the batch is full or its deadline has
+ * passed. Otherwise, this function does nothing. No instrument communication
+ * is performed.
+ *
+ * Call this before RBRInstrument_close() if you don't want to lose the tail
+ * end of a stream.
+ *
+ * \param [in] instrument the instrument connection
+ * \return #RBRINSTRUMENT_SUCCESS when any waiting samples have been delivered
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
+ * \see RBRInstrumentCallbacks.sampleBatchTimeout for automatic delivery of
+ *      partial batches
+ */
+RBRInstrumentError RBRInstrument_flushSamples(RBRInstrument *instrument);
+
 #ifdef __cplusplus
 }
 #endif
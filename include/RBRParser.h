@@ -20,6 +20,20 @@ extern "C" {
 
 #include "RBRInstrument.h"
 
+/**
+ * \brief Whether to use SIMD instructions to decode EasyParse columns.
+ *
+ * When the compiler targets SSE2 (as it always does for x86-64) or NEON (as
+ * it always does for AArch64), RBRParser_parseColumns() transposes blocks of
+ * four samples by four channels at a time with vector instructions. Defining
+ * this as 0 forces the portable scalar implementation everywhere. Results are
+ * identical either way, and only the library build is affected: your code
+ * doesn't need the same value.
+ */
+#ifndef RBRPARSER_SIMD
+#define RBRPARSER_SIMD 1
+#endif
+
 /** \brief The maximum number of pieces of auxiliary data in an event. */
 #define RBRINSTRUMENT_EVENT_AUXILIARY_DATA_MAX 4
 
@@ -143,6 +157,29 @@ typedef RBRInstrumentError (*RBRParserEventCallback)(
     const struct RBRParser *parser,
     const struct RBRInstrumentEvent *const event);
 
+/**
+ * \brief Callback to report a corrupt event record to user code.
+ *
+ * Only called when RBRParserEasyParseConfig.validateEvents is set. A corrupt
+ * record is reported here instead of being decoded and passed to
+ * RBRParserCallbacks.event; parsing then carries on with the next record.
+ *
+ * \param [in] parser the dataset parser which found the record
+ * \param [in] data the raw event record
+ * \param [in] size the size of the record, in bytes
+ * \param [in] reason #RBRINSTRUMENT_CHECKSUM_ERROR when the record CRC doesn't
+ *                    match its contents, or
+ *                    #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when the event
+ *                    marker or type is invalid
+ * \return #RBRINSTRUMENT_SUCCESS to carry on parsing
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR when an unrecoverable error occurs
+ */
+typedef RBRInstrumentError (*RBRParserCorruptEventCallback)(
+    const struct RBRParser *parser,
+    const void *const data,
+    int32_t size,
+    RBRInstrumentError reason);
+
 /**
  * \brief A set of callbacks from parser to user code.
  *
@@ -179,6 +216,16 @@ typedef struct RBRParserCallbacks
      * Required only when RBRParserCallbacks.event is populated.
      */
     RBRInstrumentEvent *eventBuffer;
+
+    /**
+     * \brief Called when an event record fails validation.
+     *
+     * Optional; if not given, corrupt events are silently dropped. Requires
+     * no buffer: the raw record is given instead.
+     *
+     * \see RBRParserEasyParseConfig.validateEvents
+     */
+    RBRParserCorruptEventCallback corruptEvent;
 } RBRParserCallbacks;
 
 /**
@@ -191,11 +238,112 @@ typedef struct RBRParserEasyParseConfig
     /**
      * \brief The number of instrument channels in each sample.
      *
-     * If the value is less than or equal to 0 or exceeds
-     * #RBRINSTRUMENT_CHANNEL_MAX, then RBRParser_init() will return
-     * #RBRINSTRUMENT_INVALID_PARAMETER_VALUE.
+     * If the value is less than 0 or exceeds #RBRINSTRUMENT_CHANNEL_MAX, then
+     * RBRParser_init() will return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE. It
+     * may only be 0 if RBRParserEasyParseConfig.postprocessingChannels is
+     * given, in which case the parser can't parse
+     * #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA.
      */
     int32_t channels;
+
+    /**
+     * \brief The number of channels generated by post-processing.
+     *
+     * Required to parse #RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA;
+     * otherwise, may be left as 0. This should be the
+     * RBRInstrumentPostprocessingChannelsList.count of the
+     * RBRInstrumentPostprocessing configuration which generated the data. If
+     * the value is less than 0 or exceeds
+     * #RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX, then RBRParser_init() will
+     * return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE.
+     */
+    int32_t postprocessingChannels;
+
+    /**
+     * \brief Whether to check event records before decoding them.
+     *
+     * When set, each #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS record has its
+     * event marker, event type, and CRC checked. Records which fail are
+     * given to RBRParserCallbacks.corruptEvent instead of
+     * RBRParserCallbacks.event. The CRC is checked last, and only when the
+     * cheaper checks pass.
+     *
+     * The CRC is assumed to be the first two bytes of the record, stored
+     * little-endian, and to cover the remaining 14 bytes. That layout hasn't
+     * yet been verified against records downloaded from an instrument, so
+     * treat checksum failures with some suspicion. Records with a zero CRC,
+     * as written by some test fixtures and tools, will always be reported as
+     * corrupt.
+     */
+    bool validateEvents;
+
+    /**
+     * \brief The number of entries in
+     * RBRParserEasyParseConfig.selectedChannels, or 0 to decode every channel.
+     *
+     * Along with the rest of the sample selection (RBRParserEasyParseConfig
+     * .startTime, RBRParserEasyParseConfig.endTime, and
+     * RBRParserEasyParseConfig.filterReadings), this applies to
+     * #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA as parsed by
+     * RBRParser_parse() and the functions built on it, by
+     * RBRParser_parseMerged(), and by RBRParser_next(). Column parsing
+     * (RBRParser_parseColumns()) selects channels by its choice of columns
+     * instead, and isn't affected.
+     */
+    int32_t selectedChannelCount;
+
+    /**
+     * \brief Zero-based indices of the channels to decode, in the order in
+     * which they should appear in RBRInstrumentSample.readings.
+     *
+     * The readings of any other channels are never read. Decoded samples have
+     * RBRInstrumentSample.channels set to
+     * RBRParserEasyParseConfig.selectedChannelCount. If any index is outside
+     * the range of RBRParserEasyParseConfig.channels, then RBRParser_init()
+     * will return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE.
+     */
+    int32_t selectedChannels[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief The earliest timestamp of samples to decode, or 0 for no limit.
+     *
+     * Samples outside the time window are skipped without decoding their
+     * readings.
+     */
+    RBRInstrumentDateTime startTime;
+
+    /**
+     * \brief The timestamp before which decoded samples must fall, or 0 for
+     * no limit.
+     */
+    RBRInstrumentDateTime endTime;
+
+    /**
+     * \brief Whether to decode only samples whose reading of
+     * RBRParserEasyParseConfig.filterChannel is between
+     * RBRParserEasyParseConfig.filterMinimum and
+     * RBRParserEasyParseConfig.filterMaximum, inclusive.
+     *
+     * Only that one reading is examined before a sample is rejected. NaN
+     * readings never match.
+     */
+    bool filterReadings;
+
+    /**
+     * \brief The zero-based index of the channel whose readings are filtered.
+     *
+     * Need not be a selected channel. If outside the range of
+     * RBRParserEasyParseConfig.channels while
+     * RBRParserEasyParseConfig.filterReadings is set, then RBRParser_init()
+     * will return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE.
+     */
+    int32_t filterChannel;
+
+    /** \brief The smallest reading which passes the filter. */
+    float filterMinimum;
+
+    /** \brief The largest reading which passes the filter. */
+    float filterMaximum;
 } RBRParserEasyParseConfig;
 
 /**
@@ -214,6 +362,32 @@ typedef struct RBRParserConfig
     } formatConfig;
 } RBRParserConfig;
 
+/**
+ * \brief A single record returned by RBRParser_next().
+ *
+ * \see RBRParser_next()
+ */
+typedef struct RBRParserRecord
+{
+    /**
+     * \brief The dataset the record came from.
+     *
+     * #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS records populate
+     * RBRParserRecord.value.event; sample data and post-processed bins
+     * populate RBRParserRecord.value.sample.
+     */
+    RBRInstrumentDataset dataset;
+
+    /** \brief The decoded record. */
+    union
+    {
+        /** \brief A decoded sample or post-processed bin. */
+        RBRInstrumentSample sample;
+        /** \brief A decoded event. */
+        RBRInstrumentEvent event;
+    } value;
+} RBRParserRecord;
+
 /**
  * \brief Parser context object.
  *
@@ -241,6 +415,35 @@ typedef struct RBRParser
      * constructor.
      */
     bool managedAllocation;
+
+    /**
+     * \brief Whether RBRParserEasyParseConfig selects channels or samples,
+     * so that sample data has to be decoded selectively.
+     */
+    bool selecting;
+
+    /** \brief The buffer walked by RBRParser_next(). */
+    struct
+    {
+        /** \brief The dataset in the buffer. */
+        RBRInstrumentDataset dataset;
+        /** \brief The buffer. */
+        const uint8_t *data;
+        /** \brief The size of the buffer. */
+        int64_t size;
+        /** \brief The offset of the next record in the buffer. */
+        int64_t offset;
+        /** \brief The size of each record in the buffer. */
+        int32_t recordSize;
+        /** \brief The number of values in each sample in the buffer. */
+        int32_t channels;
+        /**
+         * \brief Decodes the next record from the buffer; chosen by
+         * RBRParser_setBuffer() according to whether records may be skipped.
+         */
+        RBRInstrumentError (*next)(struct RBRParser *parser,
+                                   struct RBRParserRecord *record);
+    } cursor;
 } RBRParser;
 
 /**
@@ -259,6 +462,10 @@ typedef struct RBRParser
  * Currently, the only supported memory format is
  * #RBRINSTRUMENT_MEMFORMAT_CALBIN00 (“EasyParse”). Requesting any other format
  * via RBRParserConfig will cause #RBRINSTRUMENT_UNSUPPORTED to be returned.
+ * In particular, #RBRINSTRUMENT_MEMFORMAT_RAWBIN00 (“standard”) data holds
+ * raw, uncalibrated readings in a layout which isn't publicly documented in
+ * enough detail to decode. Instruments which support EasyParse can be
+ * switched to it before deployment with RBRInstrument_setNewMemoryFormat().
  *
  * Both callback functions are optional, but that probably isn't very useful:
  * after all, you won't receive any data that way. Still, the library won't
@@ -340,11 +547,17 @@ void RBRParser_setUserData(RBRParser *parser, void *userData);
  * \brief Parse a chunk of data.
  *
  * For a parser configured to parse #RBRINSTRUMENT_MEMFORMAT_CALBIN00-format
- * data, \a dataset may be given as #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS or
- * #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA. Any other value (including
- * #RBRINSTRUMENT_DATASET_EASYPARSE_DEPLOYMENT_HEADER, which is currently
- * unsupported) will cause the function to return
- * #RBRINSTRUMENT_INVALID_PARAMETER_VALUE and no data will be parsed.
+ * data, \a dataset may be given as #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS,
+ * #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA, or
+ * #RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA. Any other value will
+ * cause the function to return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE and no
+ * data will be parsed. #RBRINSTRUMENT_DATASET_EASYPARSE_DEPLOYMENT_HEADER is
+ * parsed by RBRParser_parseDeploymentHeader() instead, because the parser
+ * configuration usually comes from it.
+ *
+ * Post-processed bins are delivered to RBRParserCallbacks.sample like any
+ * other sample: each bin's readings are the values of the post-processing
+ * channels, in the order given by RBRInstrumentPostprocessingChannelsList.
  *
  * Parsed values will be returned via the RBRParserCallbacks provided to
  * RBRParser_init(). The value at \a size after completion of parsing indicates
@@ -367,6 +580,550 @@ RBRInstrumentError RBRParser_parse(RBRParser *parser,
                                    const void *const data,
                                    int32_t *size);
 
+/**
+ * \brief Get the size of each record in a dataset.
+ *
+ * For #RBRINSTRUMENT_MEMFORMAT_CALBIN00 (“EasyParse”) data, events, samples,
+ * and post-processed bins are all fixed-size records, so a dataset can be
+ * divided at any multiple of this size without examining its contents.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset
+ * \param [out] size the size of each record, in bytes
+ * \return #RBRINSTRUMENT_SUCCESS if the record size is known
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when the parser
+ *                                                isn't configured for it
+ * \see RBRParser_splitBuffer()
+ */
+RBRInstrumentError RBRParser_getRecordSize(const RBRParser *parser,
+                                           RBRInstrumentDataset dataset,
+                                           int32_t *size);
+
+/**
+ * \brief Parse a whole in-memory dataset; e.g., a memory-mapped file.
+ *
+ * Behaves as RBRParser_parse(), but accepts a buffer of any size, parsing it
+ * in place without copying. The data is passed to RBRParser_parse() in
+ * windows which end on record boundaries, so it needn't fit in an `int32_t`.
+ *
+ * Only whole records are parsed. On return, \a size indicates how much of
+ * \a data was parsed; anything after that is a partial record, which the
+ * caller can keep and prepend to the next chunk of the dataset, if there is
+ * one. If a callback returns an error, parsing stops, and \a size covers
+ * only the records delivered before the one which failed.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset from which the data originated
+ * \param [in] data the data to be parsed
+ * \param [in,out] size initially, the size of the data given by \a data; set
+ *                      to the number of bytes actually parsed
+ * \return #RBRINSTRUMENT_SUCCESS when no parsing errors occur
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when the parser
+ *                                                configuration is incomplete
+ *                                                or invalid
+ * \see RBRParser_parse()
+ */
+RBRInstrumentError RBRParser_parseBuffer(RBRParser *parser,
+                                         RBRInstrumentDataset dataset,
+                                         const void *const data,
+                                         int64_t *size);
+
+/**
+ * \brief Divide a dataset into chunks for parsing in parallel.
+ *
+ * Populates \a boundaries with `chunks + 1` byte offsets into a dataset of
+ * \a size bytes: chunk `n` runs from `boundaries[n]` up to (but not
+ * including) `boundaries[n + 1]`. Every offset falls on a record boundary, and
+ * the whole records in the dataset are shared among the chunks as evenly as
+ * possible; some chunks will be empty if there are fewer records than chunks.
+ * `boundaries[chunks]` is the end of the last whole record, so any partial
+ * record at the end of the dataset belongs to no chunk.
+ *
+ * Parsers keep no global state, so chunks can be parsed concurrently so long
+ * as each thread has its own parser, configured identically; e.g., with
+ * RBRParser_parseColumns() into per-chunk columns. Concatenating per-chunk
+ * results in chunk order reproduces the order of the dataset.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset to be divided
+ * \param [in] size the size of the dataset, in bytes
+ * \param [in] chunks the number of chunks into which to divide the dataset
+ * \param [out] boundaries the chunk boundaries; must have room for
+ *                         `chunks + 1` values
+ * \return #RBRINSTRUMENT_SUCCESS if the dataset was divided
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when \a chunks is
+ *                                                not positive or \a size is
+ *                                                negative
+ * \see RBRParser_getRecordSize()
+ */
+RBRInstrumentError RBRParser_splitBuffer(const RBRParser *parser,
+                                         RBRInstrumentDataset dataset,
+                                         int64_t size,
+                                         int32_t chunks,
+                                         int64_t *boundaries);
+
+/**
+ * \brief Parse events and samples together, in timestamp order.
+ *
+ * Events and samples are stored in separate datasets, but they're most useful
+ * interleaved: an event marking the start of a cast or regime belongs just
+ * before the samples it applies to. This function walks a chunk of each
+ * dataset at once, always delivering whichever record comes next in time to
+ * RBRParserCallbacks.event or RBRParserCallbacks.sample. An event and a
+ * sample with the same timestamp are delivered event first. Nothing is
+ * copied or buffered, so any amount of data (e.g., both datasets
+ * memory-mapped whole) can be merged in constant memory.
+ *
+ * Each dataset is assumed to be in timestamp order on its own. Records out of
+ * order within one dataset are delivered in dataset order.
+ *
+ * Which record comes next can only be known once a whole record of each
+ * dataset is available. So unless \a finished is given as `true`, parsing
+ * stops as soon as either chunk is used up; call again with more of that
+ * dataset, preceded by whatever part of each chunk wasn't parsed. Once the
+ * chunks hold the rest of both datasets, give \a finished as `true` to drain
+ * both completely.
+ *
+ * Both RBRParserCallbacks.eventBuffer and RBRParserCallbacks.sampleBuffer are
+ * required, although either callback function may be omitted to discard
+ * records of that type.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] events a chunk of #RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS data
+ * \param [in,out] eventsSize initially, the size of \a events; set to the
+ *                            number of bytes of it actually parsed
+ * \param [in] samples a chunk of #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA
+ *                    data
+ * \param [in,out] samplesSize initially, the size of \a samples; set to the
+ *                             number of bytes of it actually parsed
+ * \param [in] finished whether the chunks reach the end of both datasets
+ * \return #RBRINSTRUMENT_SUCCESS when no parsing errors occur
+ * \return #RBRINSTRUMENT_MISSING_CALLBACK when either record buffer is missing
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when the parser configuration
+ *                                                is incomplete or invalid
+ * \see RBRParser_parse()
+ */
+RBRInstrumentError RBRParser_parseMerged(RBRParser *parser,
+                                         const void *const events,
+                                         int64_t *eventsSize,
+                                         const void *const samples,
+                                         int64_t *samplesSize,
+                                         bool finished);
+
+/**
+ * \brief Find the first record at or after a given time.
+ *
+ * EasyParse records are a fixed size, and within a deployment their
+ * timestamps only ever increase, so the record for any time can be found by
+ * binary search rather than by parsing everything before it. Only
+ * `log2(records)` timestamps are examined, so finding a time in a
+ * memory-mapped dataset of any size touches only a handful of pages.
+ *
+ * The search assumes the records are in timestamp order. If the instrument
+ * clock was set backwards during the deployment, the result is unreliable;
+ * use an index built by RBRParser_buildIndex() to search around the
+ * discontinuity instead.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset to be searched
+ * \param [in] data the dataset contents
+ * \param [in] size the size of the data given by \a data; any trailing partial
+ *                  record is ignored
+ * \param [in] time the time to find
+ * \param [out] offset the byte offset of the first record whose timestamp is
+ *                     not earlier than \a time, or the end of the last whole
+ *                     record if there is no such record
+ * \return #RBRINSTRUMENT_SUCCESS if the search completed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when the parser
+ *                                                configuration is incomplete
+ *                                                or invalid
+ * \see RBRParser_parseTimeRange()
+ */
+RBRInstrumentError RBRParser_findTime(const RBRParser *parser,
+                                      RBRInstrumentDataset dataset,
+                                      const void *const data,
+                                      int64_t size,
+                                      RBRInstrumentDateTime time,
+                                      int64_t *offset);
+
+/**
+ * \brief An entry in a sparse index of a dataset.
+ *
+ * \see RBRParser_buildIndex()
+ */
+typedef struct RBRParserIndexEntry
+{
+    /** \brief The byte offset of the record in the dataset. */
+    int64_t offset;
+
+    /** \brief The timestamp of the record. */
+    RBRInstrumentDateTime timestamp;
+
+    /**
+     * \brief Whether the record begins a new run of ordered timestamps.
+     *
+     * True for the first record of the dataset, and for any record timestamped
+     * earlier than the record before it; e.g., after the instrument clock was
+     * set backwards.
+     */
+    bool discontinuity;
+} RBRParserIndexEntry;
+
+/**
+ * \brief Build a sparse timestamp index of a dataset.
+ *
+ * The index divides the dataset into runs within which timestamps are
+ * ordered, so that RBRParser_parseTimeRange() can search each run
+ * separately. Discontinuities are found by examining every timestamp, so
+ * building the index costs about as much as a linear pass over the
+ * timestamps; it's meant to be built once and kept alongside the dataset.
+ *
+ * An entry is recorded for the first record of the dataset, for every record
+ * which begins a new run, and for every \a interval'th record in between.
+ * The periodic entries narrow the search within long runs.
+ *
+ * If \a capacity is too small, \a entries is filled as far as it goes and
+ * \a length is still set to the number of entries needed, so the caller can
+ * retry with a larger array.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset to be indexed
+ * \param [in] data the dataset contents
+ * \param [in] size the size of the data given by \a data; any trailing partial
+ *                  record is ignored
+ * \param [in] interval the number of records between periodic entries, or 0
+ *                      to record only discontinuities
+ * \param [out] entries the index
+ * \param [in] capacity the number of entries \a entries has room for
+ * \param [out] length the number of entries in the index
+ * \return #RBRINSTRUMENT_SUCCESS if the index was built
+ * \return #RBRINSTRUMENT_BUFFER_TOO_SMALL when the index didn't fit
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, when the parser
+ *                                                configuration is incomplete
+ *                                                or invalid, or when
+ *                                                \a interval is negative
+ * \see RBRParser_parseTimeRange()
+ */
+RBRInstrumentError RBRParser_buildIndex(const RBRParser *parser,
+                                        RBRInstrumentDataset dataset,
+                                        const void *const data,
+                                        int64_t size,
+                                        int32_t interval,
+                                        RBRParserIndexEntry *entries,
+                                        int32_t capacity,
+                                        int32_t *length);
+
+/**
+ * \brief Parse only the records within a range of time.
+ *
+ * Delivers every record timestamped at or after \a begin and before \a end to
+ * the parser callbacks, as RBRParser_parseBuffer() would. The start and end
+ * of the range are found with RBRParser_findTime(), so records outside the
+ * range are never decoded: pulling a day out of a multi-year dataset costs
+ * little more than parsing the day alone.
+ *
+ * Without an index, the dataset is taken to be in timestamp order. With an
+ * index from RBRParser_buildIndex(), each ordered run of the dataset is
+ * searched separately, and matching records are delivered in dataset order.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] dataset the dataset to be parsed
+ * \param [in] data the dataset contents
+ * \param [in] size the size of the data given by \a data; any trailing partial
+ *                  record is ignored
+ * \param [in] begin the start of the range, inclusive
+ * \param [in] end the end of the range, exclusive
+ * \param [in] index an index of the dataset, or `NULL`
+ * \param [in] indexLength the number of entries in \a index
+ * \return #RBRINSTRUMENT_SUCCESS when no parsing errors occur
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when the parser
+ *                                                configuration is incomplete
+ *                                                or invalid
+ * \see RBRParser_findTime()
+ * \see RBRParser_buildIndex()
+ */
+RBRInstrumentError RBRParser_parseTimeRange(
+    RBRParser *parser,
+    RBRInstrumentDataset dataset,
+    const void *const data,
+    int64_t size,
+    RBRInstrumentDateTime begin,
+    RBRInstrumentDateTime end,
+    const RBRParserIndexEntry *index,
+    int32_t indexLength);
+
+/**
+ * \brief Give the parser a buffer from which to pull records.
+ *
+ * Subsequent calls to RBRParser_next() will return the records in \a data one
+ * at a time, starting from the beginning. The buffer isn't copied; it must
+ * remain valid for as long as records are being pulled from it. Any buffer
+ * previously given is forgotten.
+ *
+ * \param [in,out] parser the dataset parser
+ * \param [in] dataset the dataset from which the data originated
+ * \param [in] data the data to be parsed
+ * \param [in] size the size of the data given by \a data
+ * \return #RBRINSTRUMENT_SUCCESS if the buffer was accepted
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when an invalid dataset is
+ *                                                given, or when the parser
+ *                                                configuration is incomplete
+ *                                                or invalid
+ * \see RBRParser_next()
+ */
+RBRInstrumentError RBRParser_setBuffer(RBRParser *parser,
+                                       RBRInstrumentDataset dataset,
+                                       const void *const data,
+                                       int64_t size);
+
+/**
+ * \brief Pull the next record from the buffer given to RBRParser_setBuffer().
+ *
+ * This is an alternative to the callbacks of RBRParser_parse() for callers
+ * which would rather ask for records than be handed them: e.g., iterators,
+ * generators, and language bindings. The record is decoded straight into
+ * \a record; no callback is called, and RBRParserCallbacks.sampleBuffer and
+ * RBRParserCallbacks.eventBuffer aren't needed. The exception is
+ * RBRParserCallbacks.corruptEvent, which is still given any events which fail
+ * validation; they're skipped rather than returned.
+ *
+ * Once the rest of the buffer doesn't hold a whole record,
+ * #RBRINSTRUMENT_BUFFER_TOO_SMALL is returned. RBRParser_getBufferOffset()
+ * then gives the size of the part of the buffer which was consumed; the rest
+ * can be kept and prepended to the next chunk of the dataset.
+ *
+ * \param [in,out] parser the dataset parser
+ * \param [out] record the next record
+ * \return #RBRINSTRUMENT_SUCCESS when a record was returned
+ * \return #RBRINSTRUMENT_BUFFER_TOO_SMALL when there are no more records
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR when returned by
+ *                                       RBRParserCallbacks.corruptEvent
+ * \see RBRParser_setBuffer()
+ */
+RBRInstrumentError RBRParser_next(RBRParser *parser, RBRParserRecord *record);
+
+/**
+ * \brief Get how far RBRParser_next() has got through its buffer.
+ *
+ * \param [in] parser the dataset parser
+ * \return the offset of the next record in the buffer
+ * \see RBRParser_next()
+ */
+int64_t RBRParser_getBufferOffset(const RBRParser *parser);
+
+/**
+ * \brief A channel described by an EasyParse deployment header.
+ *
+ * \see RBRParserDeploymentHeader
+ */
+typedef struct RBRParserDeploymentHeaderChannel
+{
+    /** \brief Whether the channel was enabled for the deployment. */
+    bool status;
+
+    /** \brief The channel label; e.g., “temperature_00”. */
+    char label[RBRINSTRUMENT_CHANNEL_LABEL_MAX + 1];
+
+    /** \brief The units of the channel readings; e.g., “C”. */
+    char userUnits[RBRINSTRUMENT_CHANNEL_UNIT_MAX + 1];
+} RBRParserDeploymentHeaderChannel;
+
+/**
+ * \brief The deployment details recorded with an EasyParse dataset.
+ *
+ * The EasyParse deployment header is a series of command responses, one per
+ * line, recorded by the instrument at the start of the deployment. Only the
+ * details needed to make sense of the sample data are kept.
+ *
+ * \see RBRParser_parseDeploymentHeader()
+ * \see RBRParserDeploymentHeader_getConfig()
+ */
+typedef struct RBRParserDeploymentHeader
+{
+    /** \brief The instrument which recorded the dataset. */
+    RBRInstrumentId id;
+
+    /**
+     * \brief Whether the instrument's `id` response has been parsed.
+     *
+     * Until it has, RBRParserDeploymentHeader.id is empty.
+     */
+    bool hasId;
+
+    /**
+     * \brief The number of entries in RBRParserDeploymentHeader.channels.
+     *
+     * This counts every channel described, whether or not it was enabled.
+     */
+    int32_t channelCount;
+
+    /**
+     * \brief The instrument channels, in instrument channel order.
+     *
+     * Each sample holds a reading from each enabled channel, in this order.
+     */
+    RBRParserDeploymentHeaderChannel channels[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief The sampling period, in milliseconds. */
+    RBRInstrumentPeriod period;
+
+    /** \brief The deployment start time. */
+    RBRInstrumentDateTime startTime;
+
+    /** \brief The deployment end time. */
+    RBRInstrumentDateTime endTime;
+} RBRParserDeploymentHeader;
+
+/**
+ * \brief Parse a chunk of an EasyParse deployment header.
+ *
+ * The header doesn't depend on any parser configuration, so no parser is
+ * needed. Details are accumulated into \a header, which should be zeroed
+ * before the first chunk, so the header can be parsed in as many chunks as
+ * convenient. Responses to commands which don't contribute to
+ * RBRParserDeploymentHeader are skipped.
+ *
+ * Only whole lines are parsed. On return, \a size indicates how much of
+ * \a data was parsed; anything after that is a partial line, which should be
+ * given again at the start of the next chunk. A null byte ends a line just as
+ * a line terminator does, so padding after the last line is consumed.
+ *
+ * \param [in] data the header data to be parsed
+ * \param [in,out] size initially, the size of the data given by \a data; set
+ *                      to the number of bytes actually parsed
+ * \param [in,out] header the deployment details
+ * \return #RBRINSTRUMENT_SUCCESS when no parsing errors occur
+ * \return #RBRINSTRUMENT_BUFFER_TOO_SMALL when a line is longer than
+ *                                         #RBRINSTRUMENT_RESPONSE_BUFFER_MAX
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when a deployment time can't
+ *                                                be parsed
+ * \see RBRParserDeploymentHeader_getConfig()
+ */
+RBRInstrumentError RBRParser_parseDeploymentHeader(
+    const void *const data,
+    int32_t *size,
+    RBRParserDeploymentHeader *header);
+
+/**
+ * \brief Get the parser configuration for the sample data described by a
+ * deployment header.
+ *
+ * The result can be given straight to RBRParser_init().
+ *
+ * \param [in] header the deployment details
+ * \param [out] config the parser configuration
+ * \return #RBRINSTRUMENT_SUCCESS if the header describes any enabled channels
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if it doesn't
+ * \see RBRParser_parseDeploymentHeader()
+ */
+RBRInstrumentError RBRParserDeploymentHeader_getConfig(
+    const RBRParserDeploymentHeader *header,
+    RBRParserConfig *config);
+
+/**
+ * \brief Column arrays into which RBRParser_parseColumns() decodes samples.
+ *
+ * Each array must have room for at least RBRParserColumns.capacity values.
+ * Any array may be `NULL`, in which case the corresponding values are not
+ * decoded: a channel for which neither RBRParserColumns.readings nor
+ * RBRParserColumns.floatReadings is given is skipped entirely. If both are
+ * given for a channel, both are populated.
+ *
+ * Decoded samples are appended starting at index RBRParserColumns.length, so
+ * consecutive chunks of a dataset can be decoded into the same columns.
+ *
+ * \see RBRParser_parseColumns()
+ */
+typedef struct RBRParserColumns
+{
+    /** \brief The number of values each column has room for. */
+    int32_t capacity;
+
+    /**
+     * \brief The number of values already in each column.
+     *
+     * Updated by RBRParser_parseColumns() to include the newly-decoded
+     * samples.
+     */
+    int32_t length;
+
+    /** \brief Sample timestamps. */
+    RBRInstrumentDateTime *timestamps;
+
+    /** \brief Double-precision readings, indexed by channel. */
+    double *readings[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief Single-precision readings, indexed by channel.
+     *
+     * EasyParse readings are stored as single-precision values, so these are
+     * copied without conversion.
+     */
+    float *floatReadings[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief The number of decoded timestamps outside the range the
+     * instrument can represent.
+     *
+     * That is, before #RBRINSTRUMENT_DATETIME_MIN or after
+     * #RBRINSTRUMENT_DATETIME_MAX. Incremented by RBRParser_parseColumns();
+     * never reset by the library. Usually a sign that the data isn't sample
+     * data, or that the channel count is wrong.
+     */
+    int32_t invalidTimestamps;
+
+    /**
+     * \brief The number of decoded timestamps earlier than the timestamp of
+     * the sample before them.
+     *
+     * The first sample of a chunk is compared against the last value in
+     * RBRParserColumns.timestamps, if there is one. Incremented by
+     * RBRParser_parseColumns(); never reset by the library. Instrument clock
+     * changes can legitimately cause this.
+     */
+    int32_t unorderedTimestamps;
+} RBRParserColumns;
+
+/**
+ * \brief Parse a chunk of sample data directly into column arrays.
+ *
+ * This is an alternative to RBRParser_parse() for
+ * #RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA when many samples are to be
+ * processed in bulk. Rather than populating an RBRInstrumentSample and
+ * calling RBRParserCallbacks.sample once for each sample, it writes each
+ * sample timestamp and reading straight into the corresponding element of
+ * the caller's arrays. The parser callbacks are not used.
+ *
+ * As many whole samples as fit in both \a data and the remaining column
+ * capacity are decoded. On return, \a size indicates how much of \a data was
+ * parsed, and RBRParserColumns.length has grown by the number of samples
+ * decoded. Every decoded timestamp is checked, and problems are counted in
+ * RBRParserColumns.invalidTimestamps and
+ * RBRParserColumns.unorderedTimestamps; they don't stop decoding.
+ *
+ * \param [in] parser the dataset parser
+ * \param [in] data the sample data to be parsed
+ * \param [in,out] size initially, the size of the data given by \a data; set
+ *                      to the number of bytes actually parsed
+ * \param [in,out] columns the arrays into which to decode samples
+ * \return #RBRINSTRUMENT_SUCCESS when no parsing errors occur
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE when the parser configuration
+ *                                                is incomplete or invalid, or
+ *                                                when the column length or
+ *                                                capacity is invalid
+ * \see RBRParser_parse()
+ */
+RBRInstrumentError RBRParser_parseColumns(RBRParser *parser,
+                                          const void *const data,
+                                          int32_t *size,
+                                          RBRParserColumns *columns);
+
 #ifdef __cplusplus
 }
 #endif
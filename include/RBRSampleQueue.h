@@ -0,0 +1,319 @@
+/**
+ * \file RBRSampleQueue.h
+ *
+ * \brief Single-producer/single-consumer queue of instrument samples.
+ *
+ * Streaming applications often call RBRInstrument_readSample() from a
+ * dedicated I/O thread and process samples elsewhere. This queue lets the
+ * sample callback hand each sample off to another thread without locking, so
+ * that a slow consumer never holds up reads from the instrument.
+ *
+ * Exactly one thread may push samples and exactly one thread may pop samples.
+ * The queue relies on the atomic operations described in `porting.md`.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_RBRSAMPLEQUEUE_H
+#define LIBRBR_RBRSAMPLEQUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "RBRInstrument.h"
+
+#ifndef RBRSAMPLEQUEUE_CACHE_LINE_SIZE
+/**
+ * \brief The size of a cache line on the host.
+ *
+ * The producer and consumer positions within RBRSampleQueue are separated by
+ * at least this many bytes so that the two threads don't contend for the same
+ * cache line. Override as appropriate for the target platform.
+ */
+#define RBRSAMPLEQUEUE_CACHE_LINE_SIZE 64
+#endif
+
+struct RBRSampleQueue;
+
+/**
+ * \brief What to do with a sample pushed into a full queue.
+ */
+typedef enum RBRSampleQueueOverflowPolicy
+{
+    /** Discard the sample being pushed. */
+    RBRSAMPLEQUEUE_DROP_NEWEST,
+    /** Discard the oldest sample in the queue to make room. */
+    RBRSAMPLEQUEUE_DROP_OLDEST,
+    /** Wait for the consumer to make room. */
+    RBRSAMPLEQUEUE_BLOCK,
+    /** The number of overflow policies. */
+    RBRSAMPLEQUEUE_OVERFLOW_POLICY_COUNT,
+    /** An unknown or unrecognized overflow policy. */
+    RBRSAMPLEQUEUE_UNKNOWN_OVERFLOW_POLICY
+} RBRSampleQueueOverflowPolicy;
+
+/**
+ * \brief Get a human-readable string name for an overflow policy.
+ *
+ * \param [in] policy the overflow policy
+ * \return a string name for the overflow policy
+ * \see RBRInstrumentError_name() for a description of the format of names
+ */
+const char *RBRSampleQueueOverflowPolicy_name(
+    RBRSampleQueueOverflowPolicy policy);
+
+/**
+ * \brief Callback to wait for room in a full queue.
+ *
+ * Used only with #RBRSAMPLEQUEUE_BLOCK. Called repeatedly by the producer
+ * until the consumer has popped a sample. A typical implementation will yield
+ * or sleep briefly.
+ *
+ * \param [in] queue the full queue
+ * \return #RBRINSTRUMENT_SUCCESS to keep waiting
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR to abandon the push
+ */
+typedef RBRInstrumentError (*RBRSampleQueueWaitCallback)(
+    const struct RBRSampleQueue *queue);
+
+/**
+ * \brief Configuration for a RBRSampleQueue.
+ */
+typedef struct RBRSampleQueueConfig
+{
+    /**
+     * \brief The number of samples the queue can hold.
+     *
+     * Must be a power of two greater than 0, or else RBRSampleQueue_init()
+     * will return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE.
+     */
+    int32_t capacity;
+
+    /**
+     * \brief The number of channels to store for each sample.
+     *
+     * When 0, samples are stored as complete RBRInstrumentSample structures.
+     * Otherwise, samples are stored as RBRInstrumentCompactSample structures
+     * with room for this many readings, and readings beyond this count are
+     * discarded on push. Must not exceed #RBRINSTRUMENT_CHANNEL_MAX.
+     */
+    int32_t channels;
+
+    /** \brief What to do when pushing into a full queue. */
+    RBRSampleQueueOverflowPolicy overflowPolicy;
+
+    /**
+     * \brief Called while waiting for room under #RBRSAMPLEQUEUE_BLOCK.
+     *
+     * Optional. When not given, the producer spins.
+     */
+    RBRSampleQueueWaitCallback wait;
+} RBRSampleQueueConfig;
+
+/**
+ * \brief Queue activity counters.
+ *
+ * \see RBRSampleQueue_getStatistics()
+ */
+typedef struct RBRSampleQueueStatistics
+{
+    /** \brief The number of samples pushed, including any later dropped. */
+    uint32_t pushed;
+    /** \brief The number of samples popped. */
+    uint32_t popped;
+    /** \brief The number of samples discarded due to overflow. */
+    uint32_t dropped;
+    /** \brief The most samples which have been waiting at once. */
+    int32_t highWaterMark;
+    /** \brief The number of samples currently waiting. */
+    int32_t length;
+} RBRSampleQueueStatistics;
+
+/**
+ * \brief Sample queue context object.
+ *
+ * Users are strongly discouraged from accessing the fields of this structure
+ * directly as layout and field availability maybe unstable from version to
+ * version.
+ *
+ * \see RBRSampleQueue_init() to initialize a queue
+ * \see RBRSampleQueue_destroy() to release a queue
+ */
+typedef struct RBRSampleQueue
+{
+    /** \brief The queue configuration. */
+    RBRSampleQueueConfig config;
+
+    /** \brief Sample storage. */
+    uint8_t *buffer;
+
+    /** \brief The number of bytes occupied by each sample in the buffer. */
+    int32_t stride;
+
+    /** \brief Arbitrary user data; useful in callbacks. */
+    void *userData;
+
+    /**
+     * \brief Whether the instance memory was dynamically allocated by the
+     * constructor.
+     */
+    bool managedAllocation;
+
+    /**
+     * \brief Whether the sample storage was dynamically allocated by the
+     * constructor.
+     */
+    bool managedBuffer;
+
+    /** \brief Separates the shared configuration from the producer. */
+    uint8_t producerPadding[RBRSAMPLEQUEUE_CACHE_LINE_SIZE];
+
+    /** \brief The index of the next slot to be written. Producer-owned. */
+    uint32_t writeIndex;
+
+    /** \brief The number of samples pushed. Producer-owned. */
+    uint32_t pushed;
+
+    /** \brief The number of samples dropped. Producer-owned. */
+    uint32_t dropped;
+
+    /** \brief The high-water mark. Producer-owned. */
+    int32_t highWaterMark;
+
+    /** \brief Separates the producer from the consumer. */
+    uint8_t consumerPadding[RBRSAMPLEQUEUE_CACHE_LINE_SIZE];
+
+    /**
+     * \brief The index of the next slot to be read.
+     *
+     * Consumer-owned, except that the producer advances it when dropping the
+     * oldest sample.
+     */
+    uint32_t readIndex;
+
+    /** \brief The number of samples popped. Consumer-owned. */
+    uint32_t popped;
+
+    /** \brief Keeps the consumer fields off of any following data. */
+    uint8_t trailingPadding[RBRSAMPLEQUEUE_CACHE_LINE_SIZE];
+} RBRSampleQueue;
+
+/**
+ * \brief Get the number of bytes of sample storage needed by a queue.
+ *
+ * \param [in] config the queue configuration
+ * \return the size of the storage buffer, in bytes
+ * \see RBRSampleQueue_init()
+ */
+int32_t RBRSampleQueue_bufferSize(const RBRSampleQueueConfig *config);
+
+/**
+ * \brief Initialize a sample queue.
+ *
+ * The use of the \a queue argument is the same as that of the \a instrument
+ * argument to RBRInstrument_open(): when given as `NULL`, instance memory will
+ * be allocated for you; otherwise, the pointer target will be used as instance
+ * storage. Likewise, when \a buffer is given as `NULL`, sample storage will be
+ * allocated for you; otherwise, it must be at least
+ * RBRSampleQueue_bufferSize() bytes long and suitably aligned for an
+ * RBRInstrumentSample.
+ *
+ * The \a config structure is copied into the queue and no reference to it is
+ * retained.
+ *
+ * To feed the queue from a streaming instrument, call RBRSampleQueue_push()
+ * from the RBRInstrumentCallbacks.sample callback. Under the
+ * #RBRSAMPLEQUEUE_DROP_NEWEST and #RBRSAMPLEQUEUE_DROP_OLDEST policies, doing
+ * so never waits on the consumer.
+ *
+ * In the event of any return value other than #RBRINSTRUMENT_SUCCESS, any
+ * memory allocated by this constructor is freed.
+ *
+ * \param [in,out] queue the context object to populate
+ * \param [in] config the queue configuration
+ * \param [in] buffer sample storage, or `NULL` to allocate it
+ * \param [in] userData arbitrary user data; useful in callbacks
+ * \return #RBRINSTRUMENT_SUCCESS if the queue was initialized successfully
+ * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the config is invalid
+ * \see RBRSampleQueue_destroy()
+ */
+RBRInstrumentError RBRSampleQueue_init(RBRSampleQueue **queue,
+                                       const RBRSampleQueueConfig *config,
+                                       void *buffer,
+                                       void *userData);
+
+/**
+ * \brief Release any resources held by the queue.
+ *
+ * \param [in,out] queue the sample queue
+ * \return #RBRINSTRUMENT_SUCCESS if the queue was released successfully
+ * \see RBRSampleQueue_init()
+ */
+RBRInstrumentError RBRSampleQueue_destroy(RBRSampleQueue *queue);
+
+/**
+ * \brief Get the pointer to arbitrary user data.
+ *
+ * \param [in] queue the sample queue
+ * \return the arbitrary user data pointer
+ */
+void *RBRSampleQueue_getUserData(const RBRSampleQueue *queue);
+
+/**
+ * \brief Add a sample to the queue.
+ *
+ * May only be called from the producer thread.
+ *
+ * When the queue is full, the configured overflow policy is applied. A sample
+ * dropped due to overflow is counted in RBRSampleQueueStatistics.dropped but
+ * is not considered an error, so the result of this function can be returned
+ * directly from an instrument sample callback.
+ *
+ * \param [in,out] queue the sample queue
+ * \param [in] sample the sample to add
+ * \return #RBRINSTRUMENT_SUCCESS when the sample was queued or dropped
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by the wait callback
+ */
+RBRInstrumentError RBRSampleQueue_push(RBRSampleQueue *queue,
+                                       const RBRInstrumentSample *sample);
+
+/**
+ * \brief Remove samples from the queue.
+ *
+ * May only be called from the consumer thread. Never waits: if fewer samples
+ * are available than requested, only those available are returned.
+ *
+ * \param [in,out] queue the sample queue
+ * \param [out] samples where to put the samples
+ * \param [in,out] count initially, the number of samples which will fit in
+ *                       \a samples; set to the number of samples removed
+ * \return #RBRINSTRUMENT_SUCCESS
+ */
+RBRInstrumentError RBRSampleQueue_pop(RBRSampleQueue *queue,
+                                      RBRInstrumentSample *samples,
+                                      int32_t *count);
+
+/**
+ * \brief Get a snapshot of the queue activity counters.
+ *
+ * May be called from either thread. Because the counters continue to change
+ * while they are read, they are not guaranteed to be mutually consistent.
+ *
+ * \param [in] queue the sample queue
+ * \param [out] statistics the queue counters
+ */
+void RBRSampleQueue_getStatistics(const RBRSampleQueue *queue,
+                                  RBRSampleQueueStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_RBRSAMPLEQUEUE_H */
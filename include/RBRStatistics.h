@@ -0,0 +1,290 @@
+/**
+ * \file RBRStatistics.h
+ *
+ * \brief Streaming per-channel summary statistics.
+ *
+ * Checking a deployment usually starts with a summary of each channel: how
+ * many readings there were, their range, mean, and spread, and how many were
+ * missing or flagged as errors. An accumulator computes those summaries in
+ * the same pass as parsing or streaming: push each sample into it (e.g., from
+ * RBRParserCallbacks.sample or RBRInstrumentCallbacks.sample), and read the
+ * summaries at any time, without keeping the samples or reading the data a
+ * second time.
+ *
+ * Means and variances are accumulated by Welford's method, which stays
+ * precise however many readings there are. Quantiles (e.g., the median) can
+ * optionally be estimated by the P² algorithm of Jain and Chlamtac, which
+ * keeps only five markers per quantile instead of the readings themselves;
+ * its estimates are approximate, but typically close for smooth
+ * distributions and large numbers of readings.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef LIBRBR_RBRSTATISTICS_H
+#define LIBRBR_RBRSTATISTICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "RBRInstrument.h"
+
+/** \brief The maximum number of quantiles estimated for each channel. */
+#define RBRSTATISTICS_QUANTILE_MAX 8
+
+/**
+ * \brief Configuration for a RBRStatistics accumulator.
+ */
+typedef struct RBRStatisticsConfig
+{
+    /**
+     * \brief The number of channels to summarize.
+     *
+     * Readings beyond this count are ignored. Must be between 1 and
+     * #RBRINSTRUMENT_CHANNEL_MAX.
+     */
+    int32_t channels;
+
+    /**
+     * \brief The number of quantiles to estimate for each channel.
+     *
+     * Between 0 and #RBRSTATISTICS_QUANTILE_MAX. Each quantile costs a little
+     * work per reading and a little storage per channel, so leave this at 0
+     * when quantiles aren't wanted.
+     */
+    int32_t quantileCount;
+
+    /**
+     * \brief The quantiles to estimate, each strictly between 0 and 1; e.g.,
+     * 0.5 for the median.
+     */
+    double quantiles[RBRSTATISTICS_QUANTILE_MAX];
+} RBRStatisticsConfig;
+
+/**
+ * \brief A summary of the readings of one channel.
+ */
+typedef struct RBRStatisticsChannel
+{
+    /** \brief The number of readings, including NaN readings. */
+    int64_t readings;
+
+    /** \brief The number of valid (non-NaN) readings. */
+    int64_t count;
+
+    /**
+     * \brief The number of NaN readings, whether or not they're flagged.
+     */
+    int64_t nans;
+
+    /**
+     * \brief The number of readings with each flag.
+     *
+     * Indexed by RBRInstrumentReadingFlag. The count for
+     * #RBRINSTRUMENT_READING_FLAG_NONE is the number of NaN readings with no
+     * flag. NaN readings with unrecognized flags are counted only in
+     * RBRStatisticsChannel.nans.
+     *
+     * \see RBRInstrumentReading_getFlag()
+     */
+    int64_t flags[RBRINSTRUMENT_READING_FLAG_COUNT];
+
+    /** \brief The smallest valid reading, or NaN if there were none. */
+    double min;
+
+    /** \brief The largest valid reading, or NaN if there were none. */
+    double max;
+
+    /** \brief The mean of the valid readings, or NaN if there were none. */
+    double mean;
+
+    /**
+     * \brief The sample variance of the valid readings.
+     *
+     * 0 when there was only one valid reading, and NaN when there were none.
+     */
+    double variance;
+
+    /**
+     * \brief The estimate of each configured quantile, in the order of
+     * RBRStatisticsConfig.quantiles, or NaN if there were no valid readings.
+     *
+     * Exact when there were five or fewer valid readings.
+     */
+    double quantiles[RBRSTATISTICS_QUANTILE_MAX];
+} RBRStatisticsChannel;
+
+/**
+ * \brief Statistics accumulator context object.
+ *
+ * The per-channel accumulators are kept as arrays indexed by channel, rather
+ * than as an array of per-channel structures, so that each sample updates
+ * all channels with the same arithmetic in a loop which the compiler can
+ * vectorize.
+ *
+ * Users are strongly discouraged from accessing the fields of this structure
+ * directly as layout and field availability maybe unstable from version to
+ * version.
+ *
+ * \see RBRStatistics_init() to initialize an accumulator
+ * \see RBRStatistics_destroy() to release an accumulator
+ */
+typedef struct RBRStatistics
+{
+    /** \brief The accumulator configuration. */
+    RBRStatisticsConfig config;
+
+    /** \brief The number of readings of each channel. */
+    double readings[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief The number of valid readings of each channel. */
+    double counts[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief The smallest valid reading of each channel. */
+    double mins[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief The largest valid reading of each channel. */
+    double maxes[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief The running mean of each channel. */
+    double means[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief The running sum of squared differences from the mean of each
+     * channel.
+     */
+    double squares[RBRINSTRUMENT_CHANNEL_MAX];
+
+    /**
+     * \brief The number of readings of each channel with each flag.
+     *
+     * Indexed first by RBRInstrumentReadingFlag.
+     */
+    int64_t flags[RBRINSTRUMENT_READING_FLAG_COUNT][RBRINSTRUMENT_CHANNEL_MAX];
+
+    /** \brief Quantile marker storage. */
+    void *markers;
+
+    /** \brief Arbitrary user data. */
+    void *userData;
+
+    /**
+     * \brief Whether the instance memory was dynamically allocated by the
+     * constructor.
+     */
+    bool managedAllocation;
+
+    /**
+     * \brief Whether the marker storage was dynamically allocated by the
+     * constructor.
+     */
+    bool managedBuffer;
+} RBRStatistics;
+
+/**
+ * \brief Get the number of bytes of quantile marker storage needed by an
+ * accumulator.
+ *
+ * \param [in] config the accumulator configuration
+ * \return the size of the storage buffer, in bytes; 0 when no quantiles are
+ *         configured
+ * \see RBRStatistics_init()
+ */
+int32_t RBRStatistics_bufferSize(const RBRStatisticsConfig *config);
+
+/**
+ * \brief Initialize a statistics accumulator.
+ *
+ * The use of the \a statistics argument is the same as that of the
+ * \a instrument argument to RBRInstrument_open(): when given as `NULL`,
+ * instance memory will be allocated for you; otherwise, the pointer target
+ * will be used as instance storage. Likewise, when \a buffer is given as
+ * `NULL`, quantile marker storage will be allocated for you if any is needed;
+ * otherwise, it must be at least RBRStatistics_bufferSize() bytes long and
+ * suitably aligned for a `double`.
+ *
+ * The \a config structure is copied into the accumulator and no reference to
+ * it is retained.
+ *
+ * In the event of any return value other than #RBRINSTRUMENT_SUCCESS, any
+ * memory allocated by this constructor is freed.
+ *
+ * \param [in,out] statistics the context object to populate
+ * \param [in] config the accumulator configuration
+ * \param [in] buffer quantile marker storage, or `NULL` to allocate it
+ * \param [in] userData arbitrary user data
+ * \return #RBRINSTRUMENT_SUCCESS if the accumulator was initialized
+ * \return #RBRINSTRUMENT_ALLOCATION_FAILURE if memory allocation failed
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if the config is invalid
+ * \see RBRStatistics_destroy()
+ */
+RBRInstrumentError RBRStatistics_init(RBRStatistics **statistics,
+                                      const RBRStatisticsConfig *config,
+                                      void *buffer,
+                                      void *userData);
+
+/**
+ * \brief Release any resources held by the accumulator.
+ *
+ * \param [in,out] statistics the accumulator
+ * \return #RBRINSTRUMENT_SUCCESS if the accumulator was released successfully
+ * \see RBRStatistics_init()
+ */
+RBRInstrumentError RBRStatistics_destroy(RBRStatistics *statistics);
+
+/**
+ * \brief Get the pointer to arbitrary user data.
+ *
+ * \param [in] statistics the accumulator
+ * \return the arbitrary user data pointer
+ */
+void *RBRStatistics_getUserData(const RBRStatistics *statistics);
+
+/**
+ * \brief Forget all readings accumulated so far; e.g., to start on the next
+ * deployment.
+ *
+ * \param [in,out] statistics the accumulator
+ */
+void RBRStatistics_reset(RBRStatistics *statistics);
+
+/**
+ * \brief Add the readings of a sample to the accumulator.
+ *
+ * Samples can be pushed in any order. Channels the sample doesn't have
+ * aren't counted.
+ *
+ * The result of this function can be returned directly from a parser or
+ * instrument sample callback.
+ *
+ * \param [in,out] statistics the accumulator
+ * \param [in] sample the sample to add
+ * \return #RBRINSTRUMENT_SUCCESS
+ */
+RBRInstrumentError RBRStatistics_push(RBRStatistics *statistics,
+                                      const RBRInstrumentSample *sample);
+
+/**
+ * \brief Get the summary of a channel's readings so far.
+ *
+ * \param [in] statistics the accumulator
+ * \param [in] channel the zero-based channel index
+ * \param [out] summary the summary
+ * \return #RBRINSTRUMENT_SUCCESS if the summary was retrieved
+ * \return #RBRINSTRUMENT_INVALID_PARAMETER_VALUE if \a channel is out of range
+ */
+RBRInstrumentError RBRStatistics_getChannel(const RBRStatistics *statistics,
+                                            int32_t channel,
+                                            RBRStatisticsChannel *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRBR_RBRSTATISTICS_H */
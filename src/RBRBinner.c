@@ -0,0 +1,489 @@
+/**
+ * \file RBRBinner.c
+ *
+ * \brief Library implementation.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for ceil, floor, isnan, NAN, sqrt. */
+#include <math.h>
+/* Required for memcpy, memset, strcmp. */
+#include <string.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+
+#include "RBRInstrument.h"
+#include "RBRInstrumentInternal.h"
+#include "RBRBinner.h"
+
+/**
+ * \brief The fixed part of each bin.
+ *
+ * The accumulators follow it, as three arrays of RBRBinner.sourceCount
+ * doubles: the number of valid readings, their sum, and the sum of their
+ * squares, all of readings less RBRBinner.shift.
+ */
+typedef struct RBRBinnerBin
+{
+    /** \brief The timestamp reported for the bin. */
+    RBRInstrumentDateTime timestamp;
+    /** \brief The number of samples in the bin. */
+    int64_t samples;
+} RBRBinnerBin;
+
+/**
+ * \brief Find a channel by label.
+ *
+ * \return the index of the channel, or -1 if there isn't one
+ */
+static int32_t RBRBinner_findChannel(const RBRBinnerConfig *config,
+                                     const char *label)
+{
+    for (int32_t i = 0; i < config->channels; i++)
+    {
+        if (strcmp(config->labels[i], label) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Validate a configuration and work out the resulting channel mapping
+ * and bin layout.
+ */
+static RBRInstrumentError RBRBinner_layout(const RBRBinnerConfig *config,
+                                           RBRBinner *binner)
+{
+    const RBRInstrumentPostprocessing *postprocessing =
+        &config->postprocessing;
+    const RBRInstrumentPostprocessingChannelsList *channelsList =
+        &postprocessing->channels;
+
+    binner->timeBinning = strcmp(postprocessing->binReference, "tstamp") == 0;
+
+    if (config->channels < 1
+        || config->channels > RBRINSTRUMENT_CHANNEL_MAX
+        || config->bin == NULL
+        || channelsList->count < 1
+        || channelsList->count > RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX
+        || (int) postprocessing->binFilter < 0
+        || postprocessing->binFilter
+        >= RBRINSTRUMENT_POSTPROCESSING_BINFILTER_COUNT
+        || (binner->timeBinning
+            && postprocessing->binFilter
+            != RBRINSTRUMENT_POSTPROCESSING_BINFILTER_NONE)
+        || !(postprocessing->binSize >= 0)
+        || postprocessing->tstampMin > postprocessing->tstampMax
+        || (!binner->timeBinning
+            && !(postprocessing->depthMin <= postprocessing->depthMax)))
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    binner->reference = -1;
+    if (!binner->timeBinning
+        && (binner->reference = RBRBinner_findChannel(
+                config,
+                postprocessing->binReference)) < 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    /* Several post-processing channels may aggregate the same sample channel
+     * (e.g., its mean and its standard deviation); it only needs to be
+     * accumulated once. */
+    binner->sourceCount = 0;
+    for (int32_t i = 0; i < channelsList->count; i++)
+    {
+        if ((int) channelsList->channels[i].function < 0
+            || channelsList->channels[i].function
+            >= RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_COUNT)
+        {
+            return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+        }
+
+        int32_t channel = RBRBinner_findChannel(
+            config,
+            channelsList->channels[i].label);
+        if (channel < 0)
+        {
+            return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+        }
+
+        int32_t source;
+        for (source = 0; source < binner->sourceCount; source++)
+        {
+            if (binner->sources[source] == channel)
+            {
+                break;
+            }
+        }
+        if (source == binner->sourceCount)
+        {
+            binner->sources[binner->sourceCount++] = channel;
+        }
+        binner->channelSources[i] = source;
+    }
+
+    binner->binStride = sizeof(RBRBinnerBin)
+                        + sizeof(double) * 3 * binner->sourceCount;
+
+    /* Time bins are delivered as they're completed, and without a bin size,
+     * every sample is its own bin; either way, only one bin is needed. */
+    double binCount = 1;
+    if (!binner->timeBinning && postprocessing->binSize > 0)
+    {
+        binCount = ceil((postprocessing->depthMax - postprocessing->depthMin)
+                        / postprocessing->binSize);
+        if (binCount < 1)
+        {
+            binCount = 1;
+        }
+    }
+    if (binCount > INT32_MAX / binner->binStride)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+    binner->binCount = (int32_t) binCount;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+int32_t RBRBinner_bufferSize(const RBRBinnerConfig *config)
+{
+    RBRBinner binner;
+    if (RBRBinner_layout(config, &binner) != RBRINSTRUMENT_SUCCESS)
+    {
+        return 0;
+    }
+    return binner.binCount * binner.binStride;
+}
+
+RBRInstrumentError RBRBinner_init(RBRBinner **binner,
+                                  const RBRBinnerConfig *config,
+                                  void *buffer,
+                                  void *userData)
+{
+    RBRBinner layout;
+    RBR_TRY(RBRBinner_layout(config, &layout));
+
+    bool allocated = false;
+    if (*binner == NULL)
+    {
+        allocated = true;
+        if ((*binner = malloc(sizeof(RBRBinner))) == NULL)
+        {
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    int32_t bufferSize = layout.binCount * layout.binStride;
+    bool bufferAllocated = false;
+    if (buffer == NULL)
+    {
+        bufferAllocated = true;
+        if ((buffer = malloc(bufferSize)) == NULL)
+        {
+            if (allocated)
+            {
+                free(*binner);
+            }
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    memcpy(*binner, &layout, sizeof(RBRBinner));
+    memcpy(&(*binner)->config, config, sizeof(RBRBinnerConfig));
+    memset(buffer, 0, bufferSize);
+    memset((*binner)->shifted, 0, sizeof((*binner)->shifted));
+    (*binner)->bins              = buffer;
+    (*binner)->binning           = false;
+    (*binner)->lastReference     = NAN;
+    (*binner)->userData          = userData;
+    (*binner)->managedAllocation = allocated;
+    (*binner)->managedBuffer     = bufferAllocated;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRBinner_destroy(RBRBinner *binner)
+{
+    if (binner->managedBuffer)
+    {
+        free(binner->bins);
+    }
+
+    if (binner->managedAllocation)
+    {
+        free(binner);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void *RBRBinner_getUserData(const RBRBinner *binner)
+{
+    return binner->userData;
+}
+
+static RBRBinnerBin *RBRBinner_bin(const RBRBinner *binner, int32_t index)
+{
+    return (RBRBinnerBin *) ((uint8_t *) binner->bins
+                             + (int64_t) index * binner->binStride);
+}
+
+static void RBRBinner_accumulate(RBRBinner *binner,
+                                 RBRBinnerBin *bin,
+                                 const RBRInstrumentSample *sample)
+{
+    int32_t sourceCount = binner->sourceCount;
+    double values[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+    double valid[RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX];
+
+    /* Gather the aggregated readings first, so that the accumulation below is
+     * a straight pass over contiguous arrays which the compiler can
+     * vectorize. NaN readings contribute nothing. */
+    for (int32_t s = 0; s < sourceCount; s++)
+    {
+        int32_t channel = binner->sources[s];
+        double reading = (channel < sample->channels)
+                         ? sample->readings[channel]
+                         : NAN;
+        if (isnan(reading))
+        {
+            valid[s] = 0.0;
+            values[s] = 0.0;
+            continue;
+        }
+
+        if (!binner->shifted[s])
+        {
+            binner->shift[s] = reading;
+            binner->shifted[s] = true;
+        }
+        valid[s] = 1.0;
+        values[s] = reading - binner->shift[s];
+    }
+
+    double *counts = (double *) (bin + 1);
+    double *sums = counts + sourceCount;
+    double *squares = sums + sourceCount;
+    for (int32_t s = 0; s < sourceCount; s++)
+    {
+        counts[s] += valid[s];
+        sums[s] += values[s];
+        squares[s] += values[s] * values[s];
+    }
+
+    ++bin->samples;
+}
+
+/**
+ * \brief Deliver a bin to the callback, then clear it.
+ */
+static RBRInstrumentError RBRBinner_deliver(RBRBinner *binner,
+                                            RBRBinnerBin *bin)
+{
+    const RBRInstrumentPostprocessingChannelsList *channelsList =
+        &binner->config.postprocessing.channels;
+    int32_t sourceCount = binner->sourceCount;
+    const double *counts = (const double *) (bin + 1);
+    const double *sums = counts + sourceCount;
+    const double *squares = sums + sourceCount;
+
+    binner->binBuffer.timestamp = bin->timestamp;
+    binner->binBuffer.channels = channelsList->count;
+    for (int32_t i = 0; i < channelsList->count; i++)
+    {
+        int32_t s = binner->channelSources[i];
+        double n = counts[s];
+        double reading;
+        switch (channelsList->channels[i].function)
+        {
+        case RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_MEAN:
+            reading = (n > 0) ? binner->shift[s] + sums[s] / n : NAN;
+            break;
+        case RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_STD:
+            if (n > 1)
+            {
+                /* Sample standard deviation. */
+                double variance = (squares[s] - sums[s] * sums[s] / n)
+                                  / (n - 1);
+                reading = (variance > 0) ? sqrt(variance) : 0.0;
+            }
+            else
+            {
+                reading = (n > 0) ? 0.0 : NAN;
+            }
+            break;
+        case RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_SAMPLE_COUNT:
+            reading = n;
+            break;
+        case RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_COUNT:
+        case RBRINSTRUMENT_UNKNOWN_POSTPROCESSING_AGGREGATE:
+        default:
+            reading = NAN;
+            break;
+        }
+        binner->binBuffer.readings[i] = reading;
+    }
+
+    memset(bin, 0, binner->binStride);
+    return binner->config.bin(binner, &binner->binBuffer);
+}
+
+RBRInstrumentError RBRBinner_push(RBRBinner *binner,
+                                  const RBRInstrumentSample *sample)
+{
+    const RBRInstrumentPostprocessing *postprocessing =
+        &binner->config.postprocessing;
+
+    if (sample->timestamp < postprocessing->tstampMin
+        || sample->timestamp > postprocessing->tstampMax)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    RBRBinnerBin *bin;
+    if (binner->timeBinning)
+    {
+        bin = RBRBinner_bin(binner, 0);
+        if (binner->binning
+            && (sample->timestamp < bin->timestamp
+                || sample->timestamp >= binner->binEnd))
+        {
+            binner->binning = false;
+            RBR_TRY(RBRBinner_deliver(binner, bin));
+        }
+        if (!binner->binning)
+        {
+            bin->timestamp = sample->timestamp;
+            if (postprocessing->binSize > 0)
+            {
+                /* Rounding both bounds up keeps integer timestamps in the
+                 * same bins as they'd be in without rounding. */
+                double binSize = postprocessing->binSize;
+                double bins = floor((sample->timestamp
+                                     - postprocessing->tstampMin)
+                                    / binSize);
+                bin->timestamp = postprocessing->tstampMin
+                                 + (RBRInstrumentDateTime) ceil(bins
+                                                                * binSize);
+                binner->binEnd = postprocessing->tstampMin
+                                 + (RBRInstrumentDateTime) ceil((bins + 1)
+                                                                * binSize);
+            }
+            binner->binning = true;
+        }
+    }
+    else
+    {
+        double reference = (binner->reference < sample->channels)
+                           ? sample->readings[binner->reference]
+                           : NAN;
+        if (isnan(reference))
+        {
+            return RBRINSTRUMENT_SUCCESS;
+        }
+
+        /* The direction of travel is judged from the previous reading, so
+         * the very first sample is excluded by either filter. */
+        double last = binner->lastReference;
+        binner->lastReference = reference;
+        switch (postprocessing->binFilter)
+        {
+        case RBRINSTRUMENT_POSTPROCESSING_BINFILTER_ASCENTONLY:
+            if (!(reference < last))
+            {
+                return RBRINSTRUMENT_SUCCESS;
+            }
+            break;
+        case RBRINSTRUMENT_POSTPROCESSING_BINFILTER_DESCENTONLY:
+            if (!(reference > last))
+            {
+                return RBRINSTRUMENT_SUCCESS;
+            }
+            break;
+        case RBRINSTRUMENT_POSTPROCESSING_BINFILTER_NONE:
+        case RBRINSTRUMENT_POSTPROCESSING_BINFILTER_COUNT:
+        case RBRINSTRUMENT_UNKNOWN_POSTPROCESSING_BINFILTER:
+        default:
+            break;
+        }
+
+        if (reference < postprocessing->depthMin
+            || reference > postprocessing->depthMax)
+        {
+            return RBRINSTRUMENT_SUCCESS;
+        }
+
+        int32_t index = 0;
+        if (postprocessing->binSize > 0)
+        {
+            /* Ascending bins count up from the bottom. */
+            double distance;
+            if (postprocessing->binFilter
+                == RBRINSTRUMENT_POSTPROCESSING_BINFILTER_ASCENTONLY)
+            {
+                distance = postprocessing->depthMax - reference;
+            }
+            else
+            {
+                distance = reference - postprocessing->depthMin;
+            }
+            index = (int32_t) (distance / postprocessing->binSize);
+            if (index >= binner->binCount)
+            {
+                index = binner->binCount - 1;
+            }
+        }
+
+        bin = RBRBinner_bin(binner, index);
+        if (bin->samples == 0)
+        {
+            bin->timestamp = sample->timestamp;
+        }
+    }
+
+    RBRBinner_accumulate(binner, bin, sample);
+
+    /* Without a bin size, there's no binning to be done. */
+    if (postprocessing->binSize == 0)
+    {
+        binner->binning = false;
+        return RBRBinner_deliver(binner, bin);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRBinner_flush(RBRBinner *binner)
+{
+    binner->lastReference = NAN;
+
+    if (binner->timeBinning)
+    {
+        if (binner->binning)
+        {
+            binner->binning = false;
+            return RBRBinner_deliver(binner, RBRBinner_bin(binner, 0));
+        }
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    for (int32_t i = 0; i < binner->binCount; i++)
+    {
+        RBRBinnerBin *bin = RBRBinner_bin(binner, i);
+        if (bin->samples > 0)
+        {
+            RBR_TRY(RBRBinner_deliver(binner, bin));
+        }
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
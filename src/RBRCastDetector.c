@@ -0,0 +1,273 @@
+/**
+ * \file RBRCastDetector.c
+ *
+ * \brief Library implementation.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for fabs, isnan, NAN. */
+#include <math.h>
+/* Required for memcpy. */
+#include <string.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+
+#include "RBRInstrument.h"
+#include "RBRInstrumentInternal.h"
+#include "RBRCastDetector.h"
+
+const char *RBRCastDetectorState_name(RBRCastDetectorState state)
+{
+    switch (state)
+    {
+    case RBRCASTDETECTOR_UNKNOWN:
+        return "unknown";
+    case RBRCASTDETECTOR_SOAK:
+        return "soak";
+    case RBRCASTDETECTOR_DOWN_CAST:
+        return "down-cast";
+    case RBRCASTDETECTOR_UP_CAST:
+        return "up-cast";
+    case RBRCASTDETECTOR_STATE_COUNT:
+        return "state count";
+    case RBRCASTDETECTOR_UNKNOWN_STATE:
+    default:
+        return "unknown state";
+    }
+}
+
+/**
+ * \brief Forget all samples seen so far.
+ */
+static void RBRCastDetector_reset(RBRCastDetector *detector)
+{
+    detector->state           = RBRCASTDETECTOR_UNKNOWN;
+    detector->minPressure     = NAN;
+    detector->minTimestamp    = 0;
+    detector->maxPressure     = NAN;
+    detector->maxTimestamp    = 0;
+    detector->steadyPressure  = NAN;
+    detector->steadyTimestamp = 0;
+    detector->lastTimestamp   = 0;
+}
+
+RBRInstrumentError RBRCastDetector_init(RBRCastDetector **detector,
+                                        const RBRCastDetectorConfig *config,
+                                        void *userData)
+{
+    /* The negated comparisons reject NaN thresholds, too. */
+    if (config->event == NULL
+        || config->channel < 0
+        || config->channel >= RBRINSTRUMENT_CHANNEL_MAX
+        || !(config->soakThreshold >= 0)
+        || !(config->castThreshold > config->soakThreshold)
+        || config->soakDuration <= 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    bool allocated = false;
+    if (*detector == NULL)
+    {
+        allocated = true;
+        if ((*detector = malloc(sizeof(RBRCastDetector))) == NULL)
+        {
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    memcpy(&(*detector)->config, config, sizeof(RBRCastDetectorConfig));
+    RBRCastDetector_reset(*detector);
+    (*detector)->userData          = userData;
+    (*detector)->managedAllocation = allocated;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRCastDetector_destroy(RBRCastDetector *detector)
+{
+    if (detector->managedAllocation)
+    {
+        free(detector);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void *RBRCastDetector_getUserData(const RBRCastDetector *detector)
+{
+    return detector->userData;
+}
+
+RBRCastDetectorState RBRCastDetector_getState(
+    const RBRCastDetector *detector)
+{
+    return detector->state;
+}
+
+static RBRInstrumentError RBRCastDetector_event(
+    RBRCastDetector *detector,
+    RBRInstrumentEventType type,
+    RBRInstrumentDateTime timestamp)
+{
+    detector->eventBuffer.type                = type;
+    detector->eventBuffer.timestamp           = timestamp;
+    detector->eventBuffer.auxiliaryDataLength = 0;
+    return detector->config.event(detector, &detector->eventBuffer);
+}
+
+/**
+ * \brief Begin a cast at the given pressure extreme.
+ *
+ * Any cast already in progress is ended at the same time.
+ */
+static RBRInstrumentError RBRCastDetector_begin(
+    RBRCastDetector *detector,
+    RBRCastDetectorState state,
+    RBRInstrumentDateTime timestamp,
+    double pressure,
+    RBRInstrumentDateTime now)
+{
+    bool ending = detector->state == RBRCASTDETECTOR_DOWN_CAST
+                  || detector->state == RBRCASTDETECTOR_UP_CAST;
+
+    /* The current sample is the opposite extreme of the new cast so far: all
+     * the samples since the turn were within the cast threshold of it. */
+    detector->state = state;
+    if (state == RBRCASTDETECTOR_DOWN_CAST)
+    {
+        detector->maxPressure  = pressure;
+        detector->maxTimestamp = now;
+    }
+    else
+    {
+        detector->minPressure  = pressure;
+        detector->minTimestamp = now;
+    }
+    detector->steadyPressure  = pressure;
+    detector->steadyTimestamp = now;
+
+    if (ending)
+    {
+        RBR_TRY(RBRCastDetector_event(
+                    detector,
+                    RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST,
+                    timestamp));
+    }
+    return RBRCastDetector_event(
+        detector,
+        (state == RBRCASTDETECTOR_DOWN_CAST)
+        ? RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST
+        : RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST,
+        timestamp);
+}
+
+RBRInstrumentError RBRCastDetector_push(RBRCastDetector *detector,
+                                        const RBRInstrumentSample *sample)
+{
+    const RBRCastDetectorConfig *config = &detector->config;
+    if (config->channel >= sample->channels
+        || isnan(sample->readings[config->channel]))
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    double pressure = sample->readings[config->channel];
+    RBRInstrumentDateTime timestamp = sample->timestamp;
+    detector->lastTimestamp = timestamp;
+
+    if (isnan(detector->steadyPressure))
+    {
+        detector->minPressure     = pressure;
+        detector->minTimestamp    = timestamp;
+        detector->maxPressure     = pressure;
+        detector->maxTimestamp    = timestamp;
+        detector->steadyPressure  = pressure;
+        detector->steadyTimestamp = timestamp;
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    if (fabs(pressure - detector->steadyPressure) > config->soakThreshold)
+    {
+        detector->steadyPressure  = pressure;
+        detector->steadyTimestamp = timestamp;
+    }
+    else if (detector->state != RBRCASTDETECTOR_SOAK
+             && timestamp - detector->steadyTimestamp >= config->soakDuration)
+    {
+        bool ending = detector->state != RBRCASTDETECTOR_UNKNOWN;
+
+        /* Casts out of the soak are measured from the pressure at which it
+         * began. */
+        detector->state        = RBRCASTDETECTOR_SOAK;
+        detector->minPressure  = detector->steadyPressure;
+        detector->minTimestamp = detector->steadyTimestamp;
+        detector->maxPressure  = detector->steadyPressure;
+        detector->maxTimestamp = detector->steadyTimestamp;
+
+        if (ending)
+        {
+            RBR_TRY(RBRCastDetector_event(
+                        detector,
+                        RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST,
+                        detector->steadyTimestamp));
+        }
+    }
+
+    /* Ties move the extremes later, so that a cast out of a hold begins as
+     * the hold ends. */
+    if (pressure <= detector->minPressure)
+    {
+        detector->minPressure  = pressure;
+        detector->minTimestamp = timestamp;
+    }
+    if (pressure >= detector->maxPressure)
+    {
+        detector->maxPressure  = pressure;
+        detector->maxTimestamp = timestamp;
+    }
+
+    /* A down-cast can only turn up, and an up-cast only down; otherwise,
+     * either direction begins a cast. Each begins at the extreme it moved
+     * away from. */
+    if (detector->state != RBRCASTDETECTOR_DOWN_CAST
+        && pressure >= detector->minPressure + config->castThreshold)
+    {
+        return RBRCastDetector_begin(detector,
+                                     RBRCASTDETECTOR_DOWN_CAST,
+                                     detector->minTimestamp,
+                                     pressure,
+                                     timestamp);
+    }
+    if (detector->state != RBRCASTDETECTOR_UP_CAST
+        && pressure <= detector->maxPressure - config->castThreshold)
+    {
+        return RBRCastDetector_begin(detector,
+                                     RBRCASTDETECTOR_UP_CAST,
+                                     detector->maxTimestamp,
+                                     pressure,
+                                     timestamp);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRCastDetector_flush(RBRCastDetector *detector)
+{
+    bool ending = detector->state == RBRCASTDETECTOR_DOWN_CAST
+                  || detector->state == RBRCASTDETECTOR_UP_CAST;
+    RBRInstrumentDateTime timestamp = detector->lastTimestamp;
+
+    RBRCastDetector_reset(detector);
+    if (ending)
+    {
+        return RBRCastDetector_event(
+            detector,
+            RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST,
+            timestamp);
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
@@ -0,0 +1,601 @@
+/**
+ * \file RBRDownsampler.c
+ *
+ * \brief Library implementation.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for fabs, isnan, NAN. */
+#include <math.h>
+/* Required for memcpy, memset. */
+#include <string.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+
+#include "RBRInstrument.h"
+#include "RBRDownsampler.h"
+
+const char *RBRDownsamplerMethod_name(RBRDownsamplerMethod method)
+{
+    switch (method)
+    {
+    case RBRDOWNSAMPLER_DECIMATE:
+        return "decimate";
+    case RBRDOWNSAMPLER_MIN_MAX:
+        return "min/max";
+    case RBRDOWNSAMPLER_LTTB:
+        return "LTTB";
+    case RBRDOWNSAMPLER_METHOD_COUNT:
+        return "method count";
+    case RBRDOWNSAMPLER_UNKNOWN_METHOD:
+    default:
+        return "unknown method";
+    }
+}
+
+int32_t RBRDownsampler_bufferSize(const RBRDownsamplerConfig *config)
+{
+    return (int32_t) sizeof(RBRDownsamplerPoint)
+           * config->channels
+           * config->capacity;
+}
+
+RBRInstrumentError RBRDownsampler_init(RBRDownsampler **downsampler,
+                                       const RBRDownsamplerConfig *config,
+                                       void *buffer,
+                                       void *userData)
+{
+    if ((int) config->method < 0
+        || config->method >= RBRDOWNSAMPLER_METHOD_COUNT
+        || config->channels < 1
+        || config->channels > RBRINSTRUMENT_CHANNEL_MAX
+        || config->capacity <= 0
+        || config->capacity % 4 != 0
+        || config->capacity > INT32_MAX
+                              / config->channels
+                              / (int32_t) sizeof(RBRDownsamplerPoint)
+        || config->bucketSize < 1)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    bool allocated = false;
+    if (*downsampler == NULL)
+    {
+        allocated = true;
+        if ((*downsampler = malloc(sizeof(RBRDownsampler))) == NULL)
+        {
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    bool bufferAllocated = false;
+    if (buffer == NULL)
+    {
+        bufferAllocated = true;
+        if ((buffer = malloc(RBRDownsampler_bufferSize(config))) == NULL)
+        {
+            if (allocated)
+            {
+                free(*downsampler);
+            }
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    memset(*downsampler, 0, sizeof(RBRDownsampler));
+    memcpy(&(*downsampler)->config, config, sizeof(RBRDownsamplerConfig));
+    (*downsampler)->points            = buffer;
+    (*downsampler)->bucketSize        = config->bucketSize;
+    (*downsampler)->userData          = userData;
+    (*downsampler)->managedAllocation = allocated;
+    (*downsampler)->managedBuffer     = bufferAllocated;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRDownsampler_destroy(RBRDownsampler *downsampler)
+{
+    if (downsampler->managedBuffer)
+    {
+        free(downsampler->points);
+    }
+
+    if (downsampler->managedAllocation)
+    {
+        free(downsampler);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void *RBRDownsampler_getUserData(const RBRDownsampler *downsampler)
+{
+    return downsampler->userData;
+}
+
+/**
+ * \brief Get the number of points each bucket is reduced to.
+ */
+static int32_t RBRDownsampler_pointsPerBucket(
+    const RBRDownsampler *downsampler)
+{
+    return (downsampler->config.method == RBRDOWNSAMPLER_MIN_MAX) ? 2 : 1;
+}
+
+static RBRDownsamplerPoint *RBRDownsampler_channelPoints(
+    const RBRDownsampler *downsampler,
+    int32_t channel)
+{
+    return downsampler->points + channel * downsampler->config.capacity;
+}
+
+/**
+ * \brief Get the point before the next one to be kept: the last one kept,
+ * which is the first sample if no others have been kept yet (LTTB).
+ */
+static const RBRDownsamplerPoint *RBRDownsampler_reference(
+    const RBRDownsampler *downsampler,
+    int32_t channel)
+{
+    return &RBRDownsampler_channelPoints(downsampler, channel)
+           [downsampler->length - 1];
+}
+
+/**
+ * \brief Get the time of a point in milliseconds since the first sample, as
+ * used for triangle areas.
+ */
+static double RBRDownsampler_x(const RBRDownsampler *downsampler,
+                               const RBRDownsamplerPoint *point)
+{
+    return (double) (point->timestamp - downsampler->origin);
+}
+
+/**
+ * \brief Get twice the area of the triangle formed by three points.
+ *
+ * NaN if any of the readings are NaN.
+ */
+static double RBRDownsampler_area(double ax, double ay,
+                                  double bx, double by,
+                                  double cx, double cy)
+{
+    return fabs((ax - cx) * (by - ay) - (ax - bx) * (cy - ay));
+}
+
+/**
+ * \brief Choose whichever of two candidates forms the larger triangle with
+ * the points before and after them.
+ *
+ * Favours the first candidate when the areas can't be compared.
+ */
+static const RBRDownsamplerPoint *RBRDownsampler_largestTriangle(
+    const RBRDownsampler *downsampler,
+    const RBRDownsamplerPoint *a,
+    const RBRDownsamplerPoint *b1,
+    const RBRDownsamplerPoint *b2,
+    double cx,
+    double cy)
+{
+    double ax = RBRDownsampler_x(downsampler, a);
+    double area1 = RBRDownsampler_area(ax, a->value,
+                                       RBRDownsampler_x(downsampler, b1),
+                                       b1->value,
+                                       cx, cy);
+    double area2 = RBRDownsampler_area(ax, a->value,
+                                       RBRDownsampler_x(downsampler, b2),
+                                       b2->value,
+                                       cx, cy);
+    return (area2 > area1) ? b2 : b1;
+}
+
+/**
+ * \brief Halve the number of points kept by merging the points of adjacent
+ * buckets, and double the size of subsequent buckets.
+ */
+static void RBRDownsampler_compact(RBRDownsampler *downsampler)
+{
+    int32_t length = 0;
+    for (int32_t c = 0; c < downsampler->config.channels; c++)
+    {
+        RBRDownsamplerPoint *points = RBRDownsampler_channelPoints(downsampler,
+                                                                   c);
+        length = 0;
+        switch (downsampler->config.method)
+        {
+        case RBRDOWNSAMPLER_DECIMATE:
+            for (int32_t i = 0; i < downsampler->length; i += 2)
+            {
+                /* The first reading of the merged bucket, unless it's NaN. */
+                if (isnan(points[i].value) && !isnan(points[i + 1].value))
+                {
+                    points[length++] = points[i + 1];
+                }
+                else
+                {
+                    points[length++] = points[i];
+                }
+            }
+            break;
+        case RBRDOWNSAMPLER_MIN_MAX:
+            for (int32_t i = 0; i < downsampler->length; i += 4)
+            {
+                const RBRDownsamplerPoint *minimum = NULL;
+                const RBRDownsamplerPoint *maximum = NULL;
+                for (int32_t j = i; j < i + 4; j++)
+                {
+                    if (isnan(points[j].value))
+                    {
+                        continue;
+                    }
+                    if (minimum == NULL || points[j].value < minimum->value)
+                    {
+                        minimum = &points[j];
+                    }
+                    if (maximum == NULL || points[j].value > maximum->value)
+                    {
+                        maximum = &points[j];
+                    }
+                }
+
+                RBRDownsamplerPoint first;
+                RBRDownsamplerPoint second;
+                if (minimum == NULL)
+                {
+                    first = second = points[i];
+                }
+                else if (minimum->timestamp <= maximum->timestamp)
+                {
+                    first = *minimum;
+                    second = *maximum;
+                }
+                else
+                {
+                    first = *maximum;
+                    second = *minimum;
+                }
+                points[length++] = first;
+                points[length++] = second;
+            }
+            break;
+        case RBRDOWNSAMPLER_LTTB:
+            /* The first sample stays as it is. The points after it always
+             * come in pairs: see RBRDownsampler_reserve(). */
+            length = 1;
+            for (int32_t i = 1; i < downsampler->length; i += 2)
+            {
+                double cx;
+                double cy;
+                const RBRDownsamplerBucket *pending = &downsampler->pending[c];
+                if (i + 2 < downsampler->length)
+                {
+                    cx = (RBRDownsampler_x(downsampler, &points[i + 2])
+                          + RBRDownsampler_x(downsampler, &points[i + 3]))
+                         / 2;
+                    cy = (points[i + 2].value + points[i + 3].value) / 2;
+                }
+                else if (downsampler->hasPending && pending->count > 0)
+                {
+                    cx = pending->timeSum / pending->count;
+                    cy = pending->valueSum / pending->count;
+                }
+                else
+                {
+                    cx = RBRDownsampler_x(downsampler, &downsampler->last[c]);
+                    cy = downsampler->last[c].value;
+                }
+                points[length] = *RBRDownsampler_largestTriangle(
+                    downsampler,
+                    &points[length - 1],
+                    &points[i],
+                    &points[i + 1],
+                    cx,
+                    cy);
+                ++length;
+            }
+            break;
+        case RBRDOWNSAMPLER_METHOD_COUNT:
+        case RBRDOWNSAMPLER_UNKNOWN_METHOD:
+        default:
+            break;
+        }
+    }
+
+    downsampler->length = length;
+    downsampler->bucketSize *= 2;
+}
+
+/**
+ * \brief Make sure there's room for a number of points for each channel,
+ * compacting as needed.
+ *
+ * LTTB also keeps room for the last sample, which RBRDownsampler_flush()
+ * adds as the final point. With the first sample as the first point, the
+ * points in between then fill an even number of places, so that they can be
+ * merged in pairs.
+ */
+static void RBRDownsampler_reserve(RBRDownsampler *downsampler,
+                                   int32_t count)
+{
+    if (downsampler->config.method == RBRDOWNSAMPLER_LTTB)
+    {
+        ++count;
+    }
+    while (downsampler->length + count > downsampler->config.capacity)
+    {
+        RBRDownsampler_compact(downsampler);
+    }
+}
+
+/**
+ * \brief Reduce the current bucket to its points (decimation and min/max).
+ */
+static void RBRDownsampler_emitCurrent(RBRDownsampler *downsampler)
+{
+    int32_t count = RBRDownsampler_pointsPerBucket(downsampler);
+    RBRDownsampler_reserve(downsampler, count);
+
+    for (int32_t c = 0; c < downsampler->config.channels; c++)
+    {
+        const RBRDownsamplerBucket *bucket = &downsampler->current[c];
+        RBRDownsamplerPoint first;
+        RBRDownsamplerPoint second;
+        if (bucket->count == 0)
+        {
+            first.timestamp = downsampler->bucketStart;
+            first.value = NAN;
+            second = first;
+        }
+        else if (downsampler->config.method == RBRDOWNSAMPLER_DECIMATE
+                 || bucket->minimum.timestamp <= bucket->maximum.timestamp)
+        {
+            first = bucket->minimum;
+            second = bucket->maximum;
+        }
+        else
+        {
+            first = bucket->maximum;
+            second = bucket->minimum;
+        }
+
+        RBRDownsamplerPoint *points = RBRDownsampler_channelPoints(downsampler,
+                                                                   c);
+        points[downsampler->length] = first;
+        if (count > 1)
+        {
+            points[downsampler->length + 1] = second;
+        }
+    }
+
+    downsampler->length += count;
+}
+
+/**
+ * \brief Select the point for the pending bucket (LTTB), given the point
+ * after it for each channel: either the average of the following bucket or,
+ * when there isn't one, the last sample.
+ */
+static void RBRDownsampler_emitPending(RBRDownsampler *downsampler,
+                                       bool average)
+{
+    RBRDownsampler_reserve(downsampler, 1);
+
+    for (int32_t c = 0; c < downsampler->config.channels; c++)
+    {
+        const RBRDownsamplerBucket *pending = &downsampler->pending[c];
+        const RBRDownsamplerBucket *next = &downsampler->current[c];
+        RBRDownsamplerPoint point;
+        if (pending->count == 0)
+        {
+            point.timestamp = downsampler->pendingStart;
+            point.value = NAN;
+        }
+        else
+        {
+            const RBRDownsamplerPoint *a = RBRDownsampler_reference(
+                downsampler,
+                c);
+            double cx;
+            double cy;
+            if (average && next->count > 0)
+            {
+                cx = next->timeSum / next->count;
+                cy = next->valueSum / next->count;
+            }
+            else
+            {
+                cx = RBRDownsampler_x(downsampler, &downsampler->last[c]);
+                cy = downsampler->last[c].value;
+            }
+            point = *RBRDownsampler_largestTriangle(downsampler,
+                                                    a,
+                                                    &pending->minimum,
+                                                    &pending->maximum,
+                                                    cx,
+                                                    cy);
+        }
+        RBRDownsampler_channelPoints(downsampler, c)[downsampler->length]
+            = point;
+    }
+
+    ++downsampler->length;
+    downsampler->hasPending = false;
+}
+
+/**
+ * \brief Finish the current bucket.
+ */
+static void RBRDownsampler_complete(RBRDownsampler *downsampler)
+{
+    if (downsampler->config.method == RBRDOWNSAMPLER_LTTB)
+    {
+        if (downsampler->hasPending)
+        {
+            RBRDownsampler_emitPending(downsampler, true);
+        }
+        memcpy(downsampler->pending,
+               downsampler->current,
+               sizeof(downsampler->pending));
+        downsampler->pendingStart = downsampler->bucketStart;
+        downsampler->hasPending = true;
+    }
+    else
+    {
+        RBRDownsampler_emitCurrent(downsampler);
+    }
+
+    downsampler->count = 0;
+}
+
+RBRInstrumentError RBRDownsampler_push(RBRDownsampler *downsampler,
+                                       const RBRInstrumentSample *sample)
+{
+    int32_t channels = downsampler->config.channels;
+    if (sample->channels < channels)
+    {
+        channels = sample->channels;
+    }
+
+    if (downsampler->samples == 0)
+    {
+        downsampler->origin = sample->timestamp;
+
+        /* LTTB keeps the first sample as the first point, and as the
+         * reference point for the first bucket, rather than bucketing it. */
+        if (downsampler->config.method == RBRDOWNSAMPLER_LTTB)
+        {
+            for (int32_t c = 0; c < downsampler->config.channels; c++)
+            {
+                RBRDownsamplerPoint *points =
+                    RBRDownsampler_channelPoints(downsampler, c);
+                points[0].timestamp = sample->timestamp;
+                points[0].value = (c < channels) ? sample->readings[c] : NAN;
+            }
+            downsampler->length = 1;
+            downsampler->samples = 1;
+            return RBRINSTRUMENT_SUCCESS;
+        }
+    }
+
+    if (downsampler->count == 0)
+    {
+        /* Merge buckets now, rather than when this one is complete, so that
+         * this one is the same size as the merged ones. */
+        RBRDownsampler_reserve(downsampler,
+                               RBRDownsampler_pointsPerBucket(downsampler));
+        downsampler->bucketStart = sample->timestamp;
+        memset(downsampler->current, 0, sizeof(downsampler->current));
+    }
+
+    double x = (double) (sample->timestamp - downsampler->origin);
+    for (int32_t c = 0; c < channels; c++)
+    {
+        RBRDownsamplerBucket *bucket = &downsampler->current[c];
+        RBRDownsamplerPoint point = {
+            .timestamp = sample->timestamp,
+            .value = sample->readings[c]
+        };
+
+        downsampler->last[c] = point;
+        if (isnan(point.value))
+        {
+            continue;
+        }
+
+        if (bucket->count == 0)
+        {
+            bucket->minimum = point;
+            bucket->maximum = point;
+        }
+        else if (downsampler->config.method != RBRDOWNSAMPLER_DECIMATE)
+        {
+            if (point.value < bucket->minimum.value)
+            {
+                bucket->minimum = point;
+            }
+            if (point.value > bucket->maximum.value)
+            {
+                bucket->maximum = point;
+            }
+        }
+        if (downsampler->config.method == RBRDOWNSAMPLER_LTTB)
+        {
+            bucket->timeSum += x;
+            bucket->valueSum += point.value;
+        }
+        ++bucket->count;
+    }
+
+    for (int32_t c = channels; c < downsampler->config.channels; c++)
+    {
+        downsampler->last[c].timestamp = sample->timestamp;
+        downsampler->last[c].value = NAN;
+    }
+
+    ++downsampler->samples;
+    if (++downsampler->count >= downsampler->bucketSize)
+    {
+        RBRDownsampler_complete(downsampler);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRDownsampler_flush(RBRDownsampler *downsampler)
+{
+    if (downsampler->config.method == RBRDOWNSAMPLER_LTTB)
+    {
+        /* Anything pushed since the first sample or the last flush ends with
+         * a sample which isn't a point yet. */
+        bool end = downsampler->hasPending || downsampler->count > 0;
+        if (downsampler->hasPending)
+        {
+            RBRDownsampler_emitPending(downsampler, downsampler->count > 0);
+        }
+        /* A bucket of only the last sample needs no point besides it. */
+        if (downsampler->count > 1)
+        {
+            memcpy(downsampler->pending,
+                   downsampler->current,
+                   sizeof(downsampler->pending));
+            downsampler->pendingStart = downsampler->bucketStart;
+            RBRDownsampler_emitPending(downsampler, false);
+        }
+        /* RBRDownsampler_reserve() always leaves room for this. */
+        if (end)
+        {
+            for (int32_t c = 0; c < downsampler->config.channels; c++)
+            {
+                RBRDownsampler_channelPoints(downsampler, c)
+                [downsampler->length] = downsampler->last[c];
+            }
+            ++downsampler->length;
+        }
+    }
+    else if (downsampler->count > 0)
+    {
+        RBRDownsampler_emitCurrent(downsampler);
+    }
+
+    downsampler->count = 0;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+const RBRDownsamplerPoint *RBRDownsampler_getPoints(
+    const RBRDownsampler *downsampler,
+    int32_t channel,
+    int32_t *length)
+{
+    if (channel < 0 || channel >= downsampler->config.channels)
+    {
+        *length = 0;
+        return NULL;
+    }
+
+    *length = downsampler->length;
+    return RBRDownsampler_channelPoints(downsampler, channel);
+}
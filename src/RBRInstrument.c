@@ -110,6 +110,26 @@ const char *RBRInstrumentResponseType_name(RBRInstrumentResponseType type)
     }
 }
 
+const char *RBRInstrumentTraceType_name(RBRInstrumentTraceType type)
+{
+    switch (type)
+    {
+    case RBRINSTRUMENT_TRACE_READ:
+        return "read";
+    case RBRINSTRUMENT_TRACE_WRITE:
+        return "write";
+    case RBRINSTRUMENT_TRACE_SLEEP:
+        return "sleep";
+    case RBRINSTRUMENT_TRACE_WAKE:
+        return "wake";
+    case RBRINSTRUMENT_TRACE_TYPE_COUNT:
+        return "trace type count";
+    case RBRINSTRUMENT_UNKNOWN_TRACE_TYPE:
+    default:
+        return "unknown trace type";
+    }
+}
+
 static RBRInstrumentError RBRInstrument_populateGeneration(
     RBRInstrument *instrument)
 {
@@ -123,20 +143,7 @@ static RBRInstrumentError RBRInstrument_populateGeneration(
         return RBRINSTRUMENT_UNSUPPORTED;
     }
 
-    /* The concept of firmware type was introduced part-way through Logger2, so
-     * early instruments with very old firmware won't report a firmware type.
-     * Newer firmware versions and newer instruments within the generation will
-     * report a firmware type of 100–103. */
-    if (instrument->id.fwtype == 0
-        || (instrument->id.fwtype >= 100
-            && instrument->id.fwtype <= 103))
-    {
-        instrument->generation = RBRINSTRUMENT_LOGGER2;
-    }
-    else
-    {
-        instrument->generation = RBRINSTRUMENT_LOGGER3;
-    }
+    instrument->generation = RBRInstrumentId_getGeneration(&instrument->id);
     return RBRINSTRUMENT_SUCCESS;
 }
 
@@ -150,11 +157,20 @@ RBRInstrumentError RBRInstrument_open(RBRInstrument **instrument,
         || callbacks->sleep == NULL
         || callbacks->read == NULL
         || callbacks->write == NULL
-        || (callbacks->sample != NULL && callbacks->sampleBuffer == NULL))
+        || (callbacks->sample != NULL && callbacks->sampleBuffer == NULL)
+        || (callbacks->sampleBatch != NULL
+            && callbacks->sampleBatchBuffer == NULL))
     {
         return RBRINSTRUMENT_MISSING_CALLBACK;
     }
 
+    if (callbacks->sampleBatch != NULL
+        && (callbacks->sampleBatchSize <= 0
+            || callbacks->sampleBatchTimeout < 0))
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
     bool allocated = false;
     if (*instrument == NULL)
     {
@@ -169,10 +185,12 @@ RBRInstrumentError RBRInstrument_open(RBRInstrument **instrument,
     memcpy(&(*instrument)->callbacks,
            callbacks,
            sizeof(RBRInstrumentCallbacks));
-    /* We don't want the streaming sample data callback to be called before the
-     * constructor has finished. */
-    (*instrument)->callbacks.sample  = NULL;
+    /* We don't want the streaming sample data callbacks to be called before
+     * the constructor has finished. */
+    (*instrument)->callbacks.sample      = NULL;
+    (*instrument)->callbacks.sampleBatch = NULL;
     (*instrument)->commandTimeout    = commandTimeout;
+    (*instrument)->responseTimeout   = -1;
     (*instrument)->userData          = userData;
     (*instrument)->lastActivityTime  = RBRINSTRUMENT_NO_ACTIVITY;
     (*instrument)->response.type     = RBRINSTRUMENT_RESPONSE_UNKNOWN_TYPE;
@@ -199,9 +217,10 @@ RBRInstrumentError RBRInstrument_open(RBRInstrument **instrument,
         return RBRINSTRUMENT_UNSUPPORTED;
     }
 
-    /* Enable the streaming callback, if applicable. */
+    /* Enable the streaming callbacks, if applicable. */
     (*instrument)->callbacks.sample = callbacks->sample;
     (*instrument)->callbacks.sampleBuffer = callbacks->sampleBuffer;
+    (*instrument)->callbacks.sampleBatch = callbacks->sampleBatch;
 
     return RBRINSTRUMENT_SUCCESS;
 }
@@ -234,6 +253,246 @@ void RBRInstrument_setCommandTimeout(RBRInstrument *instrument,
     instrument->commandTimeout = commandTimeout;
 }
 
+/**
+ * \brief Find a command in the timeout override table.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] command the command word; need not be null-terminated
+ * \param [in] commandLength the length of the command word
+ * \return the index of the override, or -1 if there is none
+ */
+static int32_t RBRInstrument_findTimeoutOverride(
+    const RBRInstrument *instrument,
+    const char *command,
+    int32_t commandLength)
+{
+    if (commandLength > RBRINSTRUMENT_COMMAND_NAME_MAX)
+    {
+        commandLength = RBRINSTRUMENT_COMMAND_NAME_MAX;
+    }
+
+    for (int32_t i = 0; i < instrument->timeoutOverridesLength; ++i)
+    {
+        const char *name = instrument->timeoutOverrides[i].command;
+        if (memcmp(name, command, commandLength) == 0
+            && name[commandLength] == '\0')
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+RBRInstrumentError RBRInstrument_setCommandTimeoutOverride(
+    RBRInstrument *instrument,
+    const char *command,
+    RBRInstrumentDateTime timeout)
+{
+    int32_t commandLength = strlen(command);
+    if (commandLength == 0 || commandLength > RBRINSTRUMENT_COMMAND_NAME_MAX)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    int32_t index = RBRInstrument_findTimeoutOverride(instrument,
+                                                      command,
+                                                      commandLength);
+
+    if (timeout < 0)
+    {
+        if (index >= 0)
+        {
+            /* Fill the hole with the last entry. */
+            memcpy(&instrument->timeoutOverrides[index],
+                   &instrument->timeoutOverrides[
+                       --instrument->timeoutOverridesLength],
+                   sizeof(RBRInstrumentCommandTimeout));
+        }
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    if (index < 0)
+    {
+        if (instrument->timeoutOverridesLength
+            >= RBRINSTRUMENT_COMMAND_TIMEOUT_OVERRIDE_MAX)
+        {
+            return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+        }
+
+        index = instrument->timeoutOverridesLength++;
+        memcpy(instrument->timeoutOverrides[index].command,
+               command,
+               commandLength + 1);
+    }
+    instrument->timeoutOverrides[index].timeout = timeout;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void RBRInstrument_getAdaptiveTimeout(
+    const RBRInstrument *instrument,
+    RBRInstrumentAdaptiveTimeout *adaptiveTimeout)
+{
+    memcpy(adaptiveTimeout,
+           &instrument->adaptiveTimeout,
+           sizeof(RBRInstrumentAdaptiveTimeout));
+}
+
+RBRInstrumentError RBRInstrument_setAdaptiveTimeout(
+    RBRInstrument *instrument,
+    const RBRInstrumentAdaptiveTimeout *adaptiveTimeout)
+{
+#if RBRINSTRUMENT_STATISTICS
+    if (adaptiveTimeout->enabled
+        && (adaptiveTimeout->percentile < 1
+            || adaptiveTimeout->percentile > 100
+            || adaptiveTimeout->multiplier < 1
+            || adaptiveTimeout->minObservations < 1
+            || adaptiveTimeout->minimum < 1))
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    memcpy(&instrument->adaptiveTimeout,
+           adaptiveTimeout,
+           sizeof(RBRInstrumentAdaptiveTimeout));
+    return RBRINSTRUMENT_SUCCESS;
+#else
+    (void) instrument;
+    (void) adaptiveTimeout;
+    return RBRINSTRUMENT_UNSUPPORTED;
+#endif
+}
+
+#if RBRINSTRUMENT_STATISTICS
+/**
+ * \brief Derive a command timeout from its latency histogram.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] command the command word; need not be null-terminated
+ * \param [in] commandLength the length of the command word
+ * \param [out] timeout the derived timeout
+ * \return whether enough observations were available to derive a timeout
+ */
+static bool RBRInstrument_getAdaptiveCommandTimeout(
+    const RBRInstrument *instrument,
+    const char *command,
+    int32_t commandLength,
+    RBRInstrumentDateTime *timeout)
+{
+    const RBRInstrumentAdaptiveTimeout *adaptive =
+        &instrument->adaptiveTimeout;
+    const RBRInstrumentStatistics *statistics = &instrument->statistics;
+
+    if (commandLength > RBRINSTRUMENT_COMMAND_NAME_MAX)
+    {
+        commandLength = RBRINSTRUMENT_COMMAND_NAME_MAX;
+    }
+
+    const RBRInstrumentCommandStatistics *entry = NULL;
+    for (int32_t i = 0; i < statistics->commandsLength; ++i)
+    {
+        if (memcmp(statistics->commands[i].command,
+                   command,
+                   commandLength) == 0
+            && statistics->commands[i].command[commandLength] == '\0')
+        {
+            entry = &statistics->commands[i];
+            break;
+        }
+    }
+
+    if (entry == NULL || entry->count < adaptive->minObservations)
+    {
+        return false;
+    }
+
+    /* Find the first bucket at which the cumulative count reaches the
+     * percentile, rounding the target up so that the 100th percentile is the
+     * last populated bucket. */
+    int64_t target = ((int64_t) entry->count * adaptive->percentile + 99)
+                     / 100;
+    int64_t cumulative = 0;
+    int32_t bucket = 0;
+    for (; bucket < RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS - 1; ++bucket)
+    {
+        cumulative += entry->histogram[bucket];
+        if (cumulative >= target)
+        {
+            break;
+        }
+    }
+
+    RBRInstrumentDateTime latency = entry->maxLatency;
+    if (bucket < RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS - 1
+        && ((RBRInstrumentDateTime) 1 << bucket) < latency)
+    {
+        latency = (RBRInstrumentDateTime) 1 << bucket;
+    }
+
+    *timeout = latency * adaptive->multiplier;
+    if (*timeout < adaptive->minimum)
+    {
+        *timeout = adaptive->minimum;
+    }
+    if (*timeout > instrument->commandTimeout)
+    {
+        *timeout = instrument->commandTimeout;
+    }
+
+    return true;
+}
+#endif
+
+RBRInstrumentDateTime RBRInstrument_getCommandWordTimeout(
+    const RBRInstrument *instrument,
+    const char *command,
+    int32_t commandLength,
+    bool *adaptive)
+{
+    if (adaptive != NULL)
+    {
+        *adaptive = false;
+    }
+
+    int32_t index = RBRInstrument_findTimeoutOverride(instrument,
+                                                      command,
+                                                      commandLength);
+    if (index >= 0)
+    {
+        return instrument->timeoutOverrides[index].timeout;
+    }
+
+#if RBRINSTRUMENT_STATISTICS
+    RBRInstrumentDateTime timeout;
+    if (instrument->adaptiveTimeout.enabled
+        && RBRInstrument_getAdaptiveCommandTimeout(instrument,
+                                                   command,
+                                                   commandLength,
+                                                   &timeout))
+    {
+        if (adaptive != NULL)
+        {
+            *adaptive = true;
+        }
+        return timeout;
+    }
+#endif
+
+    return instrument->commandTimeout;
+}
+
+RBRInstrumentDateTime RBRInstrument_getEffectiveCommandTimeout(
+    const RBRInstrument *instrument,
+    const char *command)
+{
+    return RBRInstrument_getCommandWordTimeout(instrument,
+                                               command,
+                                               strlen(command),
+                                               NULL);
+}
+
 void *RBRInstrument_getUserData(const RBRInstrument *instrument)
 {
     return instrument->userData;
@@ -244,6 +503,33 @@ void RBRInstrument_setUserData(RBRInstrument *instrument, void *userData)
     instrument->userData = userData;
 }
 
+RBRInstrumentError RBRInstrument_getStatistics(
+    const RBRInstrument *instrument,
+    RBRInstrumentStatistics *statistics)
+{
+#if RBRINSTRUMENT_STATISTICS
+    memcpy(statistics,
+           &instrument->statistics,
+           sizeof(RBRInstrumentStatistics));
+    return RBRINSTRUMENT_SUCCESS;
+#else
+    (void) instrument;
+    memset(statistics, 0, sizeof(RBRInstrumentStatistics));
+    return RBRINSTRUMENT_UNSUPPORTED;
+#endif
+}
+
+RBRInstrumentError RBRInstrument_resetStatistics(RBRInstrument *instrument)
+{
+#if RBRINSTRUMENT_STATISTICS
+    memset(&instrument->statistics, 0, sizeof(RBRInstrumentStatistics));
+    return RBRINSTRUMENT_SUCCESS;
+#else
+    (void) instrument;
+    return RBRINSTRUMENT_UNSUPPORTED;
+#endif
+}
+
 RBRInstrumentHardwareError RBRInstrument_getLastHardwareError(
     const RBRInstrument *instrument)
 {
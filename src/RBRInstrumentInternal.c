@@ -137,6 +137,146 @@ void *rbr_memmem(void *ptr1, size_t num1, const void *ptr2, size_t num2)
     return NULL;
 }
 
+/**
+ * \brief Get a timestamp for a trace record.
+ *
+ * Does nothing when no trace callback has been given.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [out] time the current time in microseconds
+ * \return #RBRINSTRUMENT_SUCCESS when the time is successfully retrieved
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
+ */
+static RBRInstrumentError RBRInstrument_traceTime(RBRInstrument *instrument,
+                                                  int64_t *time)
+{
+    if (instrument->callbacks.trace == NULL)
+    {
+        *time = 0;
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    if (instrument->callbacks.traceTime != NULL)
+    {
+        return instrument->callbacks.traceTime(instrument, time);
+    }
+
+    RBRInstrumentDateTime now;
+    RBR_TRY(instrument->callbacks.time(instrument, &now));
+    *time = now * 1000;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/**
+ * \brief Report activity to the trace callback, if there is one.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] type the kind of activity
+ * \param [in] begin when the activity began
+ * \param [in] data the data read or written, if any
+ * \param [in] size the size of \a data
+ * \param [in] result the result of the activity
+ * \return #RBRINSTRUMENT_SUCCESS when the record is successfully reported
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
+ */
+static RBRInstrumentError RBRInstrument_trace(RBRInstrument *instrument,
+                                              RBRInstrumentTraceType type,
+                                              int64_t begin,
+                                              const void *data,
+                                              int32_t size,
+                                              RBRInstrumentError result)
+{
+    if (instrument->callbacks.trace == NULL)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    RBRInstrumentTraceRecord record = {
+        .type = type,
+        .begin = begin,
+        .data = data,
+        .size = size,
+        .result = result
+    };
+    RBR_TRY(RBRInstrument_traceTime(instrument, &record.end));
+    return instrument->callbacks.trace(instrument, &record);
+}
+
+RBRInstrumentError RBRInstrument_tracedRead(RBRInstrument *instrument,
+                                            void *data,
+                                            int32_t *size)
+{
+    int64_t begin;
+    RBR_TRY(RBRInstrument_traceTime(instrument, &begin));
+
+    RBRInstrumentError err = instrument->callbacks.read(instrument,
+                                                        data,
+                                                        size);
+    RBR_STATISTIC_ADD(instrument, reads, 1);
+    if (err == RBRINSTRUMENT_SUCCESS)
+    {
+        RBR_STATISTIC_ADD(instrument, bytesRead, *size);
+    }
+
+    RBR_TRY(RBRInstrument_trace(instrument,
+                                RBRINSTRUMENT_TRACE_READ,
+                                begin,
+                                data,
+                                (err == RBRINSTRUMENT_SUCCESS) ? *size : 0,
+                                err));
+    return err;
+}
+
+RBRInstrumentError RBRInstrument_tracedWrite(RBRInstrument *instrument,
+                                             const void *data,
+                                             int32_t size)
+{
+    int64_t begin;
+    RBR_TRY(RBRInstrument_traceTime(instrument, &begin));
+
+    RBRInstrumentError err = instrument->callbacks.write(instrument,
+                                                         data,
+                                                         size);
+    if (err == RBRINSTRUMENT_SUCCESS)
+    {
+        RBR_STATISTIC_ADD(instrument, bytesWritten, size);
+    }
+
+    RBR_TRY(RBRInstrument_trace(instrument,
+                                RBRINSTRUMENT_TRACE_WRITE,
+                                begin,
+                                data,
+                                size,
+                                err));
+    return err;
+}
+
+/**
+ * \brief Sleep via RBRInstrumentCallbacks.sleep.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] time the amount of time to sleep in milliseconds
+ * \return the result of the sleep callback
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by the trace callbacks
+ */
+static RBRInstrumentError RBRInstrument_tracedSleep(
+    RBRInstrument *instrument,
+    RBRInstrumentDateTime time)
+{
+    int64_t begin;
+    RBR_TRY(RBRInstrument_traceTime(instrument, &begin));
+
+    RBRInstrumentError err = instrument->callbacks.sleep(instrument, time);
+
+    RBR_TRY(RBRInstrument_trace(instrument,
+                                RBRINSTRUMENT_TRACE_SLEEP,
+                                begin,
+                                NULL,
+                                (int32_t) time,
+                                err));
+    return err;
+}
+
 /**
  * \brief Wake the instrument from sleep, if necessary.
  *
@@ -145,7 +285,7 @@ void *rbr_memmem(void *ptr1, size_t num1, const void *ptr2, size_t num2)
  * \return #RBRINSTRUMENT_TIMEOUT when a timeout occurs
  * \return #RBRINSTRUMENT_CALLBACK_ERROR when an unrecoverable error occurs
  */
-static RBRInstrumentError RBRInstrument_wake(const RBRInstrument *instrument)
+static RBRInstrumentError RBRInstrument_wake(RBRInstrument *instrument)
 {
     RBRInstrumentDateTime now;
     RBR_TRY(instrument->callbacks.time(instrument, &now));
@@ -156,16 +296,33 @@ static RBRInstrumentError RBRInstrument_wake(const RBRInstrument *instrument)
         return RBRINSTRUMENT_SUCCESS;
     }
 
+    int64_t begin;
+    RBR_TRY(RBRInstrument_traceTime(instrument, &begin));
+
     /* Send the wake sequence twice to make sure it gets noticed. */
-    for (int pass = 0; pass < 2; ++pass)
+    RBRInstrumentError err = RBRINSTRUMENT_SUCCESS;
+    for (int pass = 0; pass < 2 && err == RBRINSTRUMENT_SUCCESS; ++pass)
+    {
+        err = RBRInstrument_tracedWrite(instrument,
+                                        WAKE_COMMAND,
+                                        WAKE_COMMAND_LEN);
+        if (err == RBRINSTRUMENT_SUCCESS)
+        {
+            err = RBRInstrument_tracedSleep(instrument, WAKE_COMMAND_WAIT);
+        }
+    }
+    if (err == RBRINSTRUMENT_SUCCESS)
     {
-        RBR_TRY(instrument->callbacks.write(instrument,
-                                            WAKE_COMMAND,
-                                            WAKE_COMMAND_LEN));
-        RBR_TRY(instrument->callbacks.sleep(instrument, WAKE_COMMAND_WAIT));
+        RBR_STATISTIC_ADD(instrument, wakes, 1);
     }
 
-    return RBRINSTRUMENT_SUCCESS;
+    RBR_TRY(RBRInstrument_trace(instrument,
+                                RBRINSTRUMENT_TRACE_WAKE,
+                                begin,
+                                NULL,
+                                0,
+                                err));
+    return err;
 }
 
 RBRInstrumentError RBRInstrument_sendBuffer(RBRInstrument *instrument)
@@ -179,9 +336,9 @@ RBRInstrumentError RBRInstrument_sendBuffer(RBRInstrument *instrument)
     }
 
     /* Send the command to the instrument. */
-    RBR_TRY(instrument->callbacks.write(instrument,
-                                        instrument->commandBuffer,
-                                        instrument->commandBufferLength));
+    RBR_TRY(RBRInstrument_tracedWrite(instrument,
+                                      instrument->commandBuffer,
+                                      instrument->commandBufferLength));
     RBR_TRY(instrument->callbacks.time(instrument,
                                        &instrument->lastActivityTime));
     return RBRINSTRUMENT_SUCCESS;
@@ -285,6 +442,12 @@ static RBRInstrumentError RBRInstrument_readSingleResponse(
     char **end)
 {
     RBRInstrumentDateTime now;
+    RBRInstrumentDateTime timeout = instrument->commandTimeout;
+    if (instrument->responseTimeout >= 0)
+    {
+        timeout = instrument->responseTimeout;
+    }
+
     int32_t readLength;
     while ((*end = (char *) rbr_memmem(
                 instrument->responseBuffer,
@@ -313,7 +476,7 @@ static RBRInstrumentError RBRInstrument_readSingleResponse(
          * to the caller.
          */
         RBR_TRY(instrument->callbacks.time(instrument, &now));
-        if (now - startTime > instrument->commandTimeout)
+        if (now - startTime > timeout)
         {
             return RBRINSTRUMENT_TIMEOUT;
         }
@@ -326,12 +489,13 @@ static RBRInstrumentError RBRInstrument_readSingleResponse(
         {
             instrument->responseBufferLength = 0;
             instrument->lastResponseLength = 0;
+            RBR_STATISTIC_ADD(instrument, responseBufferOverflows, 1);
         }
 
         readLength = RBRINSTRUMENT_RESPONSE_BUFFER_MAX
                      - instrument->responseBufferLength;
 
-        RBR_TRY(instrument->callbacks.read(
+        RBR_TRY(RBRInstrument_tracedRead(
                     instrument,
                     instrument->responseBuffer
                     + instrument->responseBufferLength,
@@ -413,7 +577,7 @@ static RBRInstrumentError RBRInstrumentSample_parse(
     RBRInstrumentSample *sample,
     char *response)
 {
-    memset(sample, 0, sizeof(RBRInstrumentSample));
+    sample->channels = 0;
 
     char *values;
     RBR_TRY(RBRInstrumentDateTime_parseSampleTime(response,
@@ -469,6 +633,10 @@ static RBRInstrumentError RBRInstrumentSample_parse(
 
         sample->readings[sample->channels++] = reading;
     }
+    /* Clear only the readings we didn't just populate. */
+    memset(sample->readings + sample->channels,
+           0,
+           sizeof(double) * (RBRINSTRUMENT_CHANNEL_MAX - sample->channels));
 
     return RBRINSTRUMENT_SUCCESS;
 }
@@ -583,6 +751,41 @@ static RBRInstrumentError RBRInstrument_errorCheckResponse(
     return RBRINSTRUMENT_SUCCESS;
 }
 
+/**
+ * \brief Account for a sample parsed into the sample batch buffer.
+ *
+ * Delivers the batch via RBRInstrumentCallbacks.sampleBatch if it is full or
+ * if its deadline has passed.
+ *
+ * \param [in,out] instrument the instrument connection
+ * \return #RBRINSTRUMENT_SUCCESS when the sample is successfully batched
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by a callback
+ */
+static RBRInstrumentError RBRInstrument_batchSample(RBRInstrument *instrument)
+{
+    RBRInstrumentDateTime now = 0;
+    if (instrument->callbacks.sampleBatchTimeout > 0)
+    {
+        RBR_TRY(instrument->callbacks.time(instrument, &now));
+    }
+
+    if (instrument->sampleBatchLength == 0)
+    {
+        instrument->sampleBatchStartTime = now;
+    }
+    ++instrument->sampleBatchLength;
+
+    if (instrument->sampleBatchLength >= instrument->callbacks.sampleBatchSize
+        || (instrument->callbacks.sampleBatchTimeout > 0
+            && now - instrument->sampleBatchStartTime
+            >= instrument->callbacks.sampleBatchTimeout))
+    {
+        return RBRInstrument_flushSamples(instrument);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
 RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
                                               bool breakOnSample,
                                               RBRInstrumentSample *sample)
@@ -592,6 +795,10 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
     instrument->response.error = RBRINSTRUMENT_HARDWARE_ERROR_NONE;
     instrument->response.response = NULL;
 
+    /* When batching, samples are parsed straight into the next free slot of
+     * the batch buffer so that they needn't be copied later. */
+    bool batching = (sample == NULL
+                     && instrument->callbacks.sampleBatch != NULL);
     RBRInstrumentSample *sampleTarget;
     if (sample == NULL)
     {
@@ -606,6 +813,17 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
      * until we exceed the command timeout. */
     RBRInstrumentDateTime startTime;
     RBR_TRY(instrument->callbacks.time(instrument, &startTime));
+
+    /* Deliver any partial batch which went stale while we weren't reading. */
+    if (batching
+        && instrument->sampleBatchLength > 0
+        && instrument->callbacks.sampleBatchTimeout > 0
+        && startTime - instrument->sampleBatchStartTime
+        >= instrument->callbacks.sampleBatchTimeout)
+    {
+        RBR_TRY(RBRInstrument_flushSamples(instrument));
+    }
+
     while (true)
     {
         RBRInstrument_removeLastResponse(instrument);
@@ -614,13 +832,25 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
         char *end;
         RBR_TRY(RBRInstrument_readSingleResponse(instrument, startTime, &end));
         RBRInstrument_terminateResponse(instrument, &beginning, end);
+        RBR_STATISTIC_ADD(instrument, responses, 1);
+
+        if (batching)
+        {
+            sampleTarget = instrument->callbacks.sampleBatchBuffer
+                           + instrument->sampleBatchLength;
+        }
 
         if (sampleTarget != NULL
             && RBRInstrumentSample_parse(sampleTarget, beginning)
             == RBRINSTRUMENT_SUCCESS)
         {
-            if (instrument->callbacks.sample != NULL
-                && sample == NULL)
+            RBR_STATISTIC_ADD(instrument, samples, 1);
+            if (batching)
+            {
+                RBR_TRY(RBRInstrument_batchSample(instrument));
+            }
+            else if (instrument->callbacks.sample != NULL
+                     && sample == NULL)
             {
                 RBR_TRY(instrument->callbacks.sample(instrument,
                                                      sampleTarget));
@@ -629,6 +859,7 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
             {
                 return RBRINSTRUMENT_SAMPLE;
             }
+            RBR_STATISTIC_ADD(instrument, skippedResponses, 1);
         }
         else
         {
@@ -642,13 +873,25 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
 void RBRInstrument_parseResponse(RBRInstrument *instrument,
                                  char **command,
                                  RBRInstrumentResponseParameter *parameter)
+{
+    RBRInstrument_parseResponseBuffer(instrument->response.response,
+                                      instrument->generation,
+                                      command,
+                                      parameter);
+}
+
+void RBRInstrument_parseResponseBuffer(
+    char *response,
+    RBRInstrumentGeneration generation,
+    char **command,
+    RBRInstrumentResponseParameter *parameter)
 {
     bool hasParameters = true;
     if (*command == NULL)
     {
         memset(parameter, 0, sizeof(RBRInstrumentResponseParameter));
 
-        *command = instrument->response.response;
+        *command = response;
         char *commandEnd = *command;
 
         while (true)
@@ -789,7 +1032,7 @@ foundCommandEnd:
         {
             separatorLength = PARAMETER_SEPARATOR_LEN;
         }
-        else if (instrument->generation == RBRINSTRUMENT_LOGGER2
+        else if (generation == RBRINSTRUMENT_LOGGER2
                  && memcmp(parameter->nextKey,
                            ARRAY_SEPARATOR_L2,
                            ARRAY_SEPARATOR_LEN_L2) == 0)
@@ -825,6 +1068,94 @@ foundCommandEnd:
     }
 }
 
+RBRInstrumentGeneration RBRInstrumentId_getGeneration(
+    const RBRInstrumentId *id)
+{
+    /* The concept of firmware type was introduced part-way through Logger2, so
+     * early instruments with very old firmware won't report a firmware type.
+     * Newer firmware versions and newer instruments within the generation will
+     * report a firmware type of 100–103. */
+    if (id->fwtype == 0 || (id->fwtype >= 100 && id->fwtype <= 103))
+    {
+        return RBRINSTRUMENT_LOGGER2;
+    }
+    return RBRINSTRUMENT_LOGGER3;
+}
+
+#if RBRINSTRUMENT_STATISTICS
+/**
+ * \brief Record the latency of a command in RBRInstrument.statistics.
+ *
+ * The command is identified by the first \a commandLength bytes of
+ * RBRInstrument.commandBuffer.
+ *
+ * \param [in,out] instrument the instrument connection
+ * \param [in] commandLength the length of the command word
+ * \param [in] latency the command latency
+ */
+static void RBRInstrument_recordCommandLatency(RBRInstrument *instrument,
+                                               int32_t commandLength,
+                                               RBRInstrumentDateTime latency)
+{
+    RBRInstrumentStatistics *statistics = &instrument->statistics;
+
+    if (commandLength > RBRINSTRUMENT_COMMAND_NAME_MAX)
+    {
+        commandLength = RBRINSTRUMENT_COMMAND_NAME_MAX;
+    }
+
+    RBRInstrumentCommandStatistics *entry = NULL;
+    for (int32_t i = 0; i < statistics->commandsLength; ++i)
+    {
+        if (memcmp(statistics->commands[i].command,
+                   instrument->commandBuffer,
+                   commandLength) == 0
+            && statistics->commands[i].command[commandLength] == '\0')
+        {
+            entry = &statistics->commands[i];
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        if (statistics->commandsLength
+            >= RBRINSTRUMENT_STATISTICS_COMMAND_MAX)
+        {
+            return;
+        }
+
+        entry = &statistics->commands[statistics->commandsLength++];
+        memcpy(entry->command, instrument->commandBuffer, commandLength);
+        entry->command[commandLength] = '\0';
+        entry->minLatency = latency;
+        entry->maxLatency = latency;
+    }
+
+    /* Bucket n holds latencies in [2^(n-1), 2^n). */
+    int32_t bucket = 0;
+    for (RBRInstrumentDateTime bound = 1;
+         bound <= latency
+         && bucket < RBRINSTRUMENT_LATENCY_HISTOGRAM_BUCKETS - 1;
+         bound <<= 1)
+    {
+        ++bucket;
+    }
+    ++entry->histogram[bucket];
+
+    ++entry->count;
+    entry->totalLatency += latency;
+    if (latency < entry->minLatency)
+    {
+        entry->minLatency = latency;
+    }
+    if (latency > entry->maxLatency)
+    {
+        entry->maxLatency = latency;
+    }
+}
+#endif
+
 RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
                                           const char *command,
                                           ...)
@@ -837,6 +1168,8 @@ RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
     /* Keep firing off the command and looking for a response until we find one
      * which matches. */
     bool retry;
+    /* Whether an adaptive timeout has already expired for this command. */
+    bool extended = false;
     do
     {
         /* The retry flag might be set on by the “E0102 invalid command” error
@@ -844,6 +1177,15 @@ RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
          * so that we don't accidentally retry infinitely. */
         retry = false;
 
+#if RBRINSTRUMENT_STATISTICS
+        RBRInstrumentDateTime sendTime;
+        err = instrument->callbacks.time(instrument, &sendTime);
+        if (err != RBRINSTRUMENT_SUCCESS)
+        {
+            break;
+        }
+#endif
+
         /* Can't use RBR_TRY anywhere within these while loops because we need
          * to be sure to call va_end() on both va_lists before returning. */
         va_copy(formatSend, format);
@@ -877,9 +1219,25 @@ RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
             commandResponse = (uint8_t *) "data";
         }
 
+        bool adaptive = false;
+        if (extended)
+        {
+            instrument->responseTimeout = instrument->commandTimeout;
+        }
+        else
+        {
+            instrument->responseTimeout = RBRInstrument_getCommandWordTimeout(
+                instrument,
+                (const char *) instrument->commandBuffer,
+                commandLength,
+                &adaptive);
+        }
+
+        int32_t responsesRead = 0;
         do
         {
             err = RBRInstrument_readResponse(instrument, false, NULL);
+            ++responsesRead;
 
             /*
              * There are a few reasons the instrument might generate an “E0102
@@ -950,6 +1308,7 @@ RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
                                    commandLength) == 0)
                 {
                     retry = true;
+                    RBR_STATISTIC_ADD(instrument, commandRetries, 1);
                     break;
                 }
                 /* Not our garbage, not our problem. We won't retry, but we'll
@@ -967,8 +1326,46 @@ RBRInstrumentError RBRInstrument_converse(RBRInstrument *instrument,
                   || memcmp(instrument->response.response,
                             commandResponse,
                             commandLength) != 0));
+
+        /* Everything before the response which ended the loop was passed
+         * over. */
+        RBR_STATISTIC_ADD(instrument, skippedResponses, responsesRead - 1);
+
+        /* A timeout learned from past latency can be too short for a command
+         * which has since become slower. Give it one more try with the
+         * general timeout, so that its latency can be observed and the
+         * learned timeout can grow to match. */
+        if (err == RBRINSTRUMENT_TIMEOUT
+            && adaptive
+            && instrument->responseTimeout < instrument->commandTimeout)
+        {
+            extended = true;
+            retry = true;
+            RBR_STATISTIC_ADD(instrument, commandRetries, 1);
+        }
+
+#if RBRINSTRUMENT_STATISTICS
+        if (!retry
+            && (err == RBRINSTRUMENT_SUCCESS
+                || err == RBRINSTRUMENT_HARDWARE_ERROR))
+        {
+            /* Don't clobber a hardware error with the time callback result. */
+            RBRInstrumentDateTime receiveTime;
+            RBRInstrumentError timeErr;
+            timeErr = instrument->callbacks.time(instrument, &receiveTime);
+            if (timeErr != RBRINSTRUMENT_SUCCESS)
+            {
+                err = timeErr;
+                break;
+            }
+            RBRInstrument_recordCommandLatency(instrument,
+                                               commandLength,
+                                               receiveTime - sendTime);
+        }
+#endif
     } while (retry);
 
+    instrument->responseTimeout = -1;
     va_end(format);
 
     return err;
@@ -57,6 +57,52 @@ extern "C" {
         } \
 } while (0)
 
+#if RBRINSTRUMENT_STATISTICS
+/**
+ * \brief Add a value to one of the counters in RBRInstrument.statistics.
+ *
+ * When statistics are disabled, the value is evaluated (so that variables
+ * used only for statistics don't produce warnings) but otherwise discarded.
+ */
+#define RBR_STATISTIC_ADD(instrument, counter, value) \
+    ((instrument)->statistics.counter += (value))
+#else
+#define RBR_STATISTIC_ADD(instrument, counter, value) ((void) (value))
+#endif
+
+/**
+ * \brief Read from the instrument via RBRInstrumentCallbacks.read.
+ *
+ * All library reads from the instrument should go through this function so
+ * that they are counted in RBRInstrument.statistics and reported to
+ * RBRInstrumentCallbacks.trace.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [out] data the buffer into which to read
+ * \param [in,out] size the size of the buffer; set to the number of bytes read
+ * \return the result of the read callback
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by the trace callbacks
+ * \see RBRInstrumentReadCallback()
+ */
+RBRInstrumentError RBRInstrument_tracedRead(RBRInstrument *instrument,
+                                            void *data,
+                                            int32_t *size);
+
+/**
+ * \brief Write to the instrument via RBRInstrumentCallbacks.write.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] data the data to write
+ * \param [in] size the number of bytes to write
+ * \return the result of the write callback
+ * \return #RBRINSTRUMENT_CALLBACK_ERROR returned by the trace callbacks
+ * \see RBRInstrument_tracedRead()
+ * \see RBRInstrumentWriteCallback()
+ */
+RBRInstrumentError RBRInstrument_tracedWrite(RBRInstrument *instrument,
+                                             const void *data,
+                                             int32_t size);
+
 /**
  * Send the first RBRInstrument.commandBufferLength bytes of
  * RBRInstrument.commandBuffer to the instrument. No formatting or validation
@@ -122,7 +168,9 @@ RBRInstrumentError RBRInstrument_sendCommand(RBRInstrument *instrument,
  * If \a sample is given as a non-`NULL` pointer and a sample response (either
  * streamed or fetched) is found, that sample will be written to \a sample.
  * Otherwise, sample data will be sent to the RBRInstrumentSampleCallback set
- * via RBRInstrumentCallbacks.sample, if populated. It doesn't make much sense
+ * via RBRInstrumentCallbacks.sample, if populated, or accumulated for the
+ * RBRInstrumentSampleBatchCallback set via RBRInstrumentCallbacks.sampleBatch,
+ * if that is populated instead. It doesn't make much sense
  * to set this without also passing \a breakOnSample as true; if
  * \a breakOnSample is false then \a sample will be populated with the most
  * recent sample incidentally encountered while parsing other responses.
@@ -142,6 +190,23 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
                                               bool breakOnSample,
                                               RBRInstrumentSample *sample);
 
+/**
+ * \brief Determine the timeout for a command.
+ *
+ * \param [in] instrument the instrument connection
+ * \param [in] command the command word; need not be null-terminated
+ * \param [in] commandLength the length of the command word
+ * \param [out] adaptive whether the timeout was derived from observed
+ *                       latency; may be `NULL`
+ * \return the timeout in milliseconds
+ * \see RBRInstrument_getEffectiveCommandTimeout()
+ */
+RBRInstrumentDateTime RBRInstrument_getCommandWordTimeout(
+    const RBRInstrument *instrument,
+    const char *command,
+    int32_t commandLength,
+    bool *adaptive);
+
 /**
  * \brief Send a command to the instrument and await an appropriate response.
  *
@@ -153,6 +218,10 @@ RBRInstrumentError RBRInstrument_readResponse(RBRInstrument *instrument,
  * from this function means that a timeout was reached waiting for the
  * _correct_ response, not just _any_ response.
  *
+ * The response is awaited for as long as
+ * RBRInstrument_getCommandWordTimeout() dictates for the command, and the
+ * latency of the exchange is recorded in RBRInstrument.statistics.
+ *
  * \param [in] instrument the instrument connection
  * \param [in] command the command to send as a printf-style format string
  * \return #RBRINSTRUMENT_SUCCESS when the command was successfully sent and a
@@ -286,6 +355,36 @@ void RBRInstrument_parseResponse(RBRInstrument *instrument,
                                  char **command,
                                  RBRInstrumentResponseParameter *parameter);
 
+/**
+ * \brief Parse a command response held somewhere other than an instrument
+ * response buffer.
+ *
+ * Behaves exactly as RBRInstrument_parseResponse(), but tokenizes the
+ * null-terminated \a response instead; e.g., a response stored in instrument
+ * memory. The \a generation determines which array member separator is
+ * recognized.
+ *
+ * \param [in,out] response the command response
+ * \param [in] generation the generation of the instrument which responded
+ * \param [in,out] command the name of the command as indicated by the response
+ * \param [in,out] parameter the most-recently-parsed response parameter
+ * \see RBRInstrument_parseResponse()
+ */
+void RBRInstrument_parseResponseBuffer(
+    char *response,
+    RBRInstrumentGeneration generation,
+    char **command,
+    RBRInstrumentResponseParameter *parameter);
+
+/**
+ * \brief Determine the generation of an instrument from its identity.
+ *
+ * \param [in] id the instrument identity, as reported by the `id` command
+ * \return the instrument generation
+ */
+RBRInstrumentGeneration RBRInstrumentId_getGeneration(
+    const RBRInstrumentId *id);
+
 /**
  * \brief Parse a date/time string from a sample (i.e.,
  * “YYYY-mm-dd HH:MM:SS.sss” format) to a timestamp.
@@ -350,6 +449,18 @@ void RBRInstrumentDateTime_toSampleTime(RBRInstrumentDateTime timestamp,
 void RBRInstrumentDateTime_toScheduleTime(RBRInstrumentDateTime timestamp,
                                           char *s);
 
+/**
+ * \brief Calculate the CRC of a block of instrument memory.
+ *
+ * This is the CRC-CCITT (polynomial 0x1021, initial value 0xFFFF) used by
+ * instruments to protect `readdata` responses and EasyParse event records.
+ *
+ * \param [in] data the data
+ * \param [in] size the size of the data
+ * \return the CRC
+ */
+uint16_t RBRInstrument_calculateCrc(const void *data, int32_t size);
+
 #ifdef __cplusplus
 }
 #endif
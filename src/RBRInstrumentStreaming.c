@@ -10,7 +10,7 @@
 
 /* Required for isnan, NAN. */
 #include <math.h>
-/* Required for strchr, strcmp. */
+/* Required for memset, strchr, strcmp. */
 #include <string.h>
 /* Required for snprintf. */
 #include <stdio.h>
@@ -23,6 +23,12 @@
 #define READING_ERROR_MASK    0x0000FFFF
 #define READING_ERROR_OFFSET (0 * 8)
 
+/* The bits of a NaN reading which carry its flag and error value. The
+ * single-precision mantissa has room for 22 payload bits below the quiet bit,
+ * which is plenty for the flags and error values we use. */
+#define COMPACT_READING_PAYLOAD_MASK 0x003FFFFF
+#define COMPACT_READING_NAN          0x7FC00000
+
 RBRInstrumentError RBRInstrument_getChannelsList(
     RBRInstrument *instrument,
     RBRInstrumentChannelsList *channelsList)
@@ -540,6 +546,87 @@ inline double RBRInstrumentReading_setError(RBRInstrumentReadingFlag flag,
     return alias.reading;
 }
 
+static float compactReading(double reading)
+{
+    if (!isnan(reading))
+    {
+        return (float) reading;
+    }
+
+    union
+    {
+        double reading;
+        uint64_t raw;
+    }
+    wide;
+    wide.reading = reading;
+
+    union
+    {
+        float reading;
+        uint32_t raw;
+    }
+    narrow;
+    narrow.raw = COMPACT_READING_NAN
+                 | (uint32_t) (wide.raw & COMPACT_READING_PAYLOAD_MASK);
+
+    return narrow.reading;
+}
+
+static double expandReading(float reading)
+{
+    if (!isnan(reading))
+    {
+        return reading;
+    }
+
+    union
+    {
+        float reading;
+        uint32_t raw;
+    }
+    narrow;
+    narrow.reading = reading;
+
+    union
+    {
+        double reading;
+        uint64_t raw;
+    }
+    wide;
+    wide.reading = NAN;
+    wide.raw |= narrow.raw & COMPACT_READING_PAYLOAD_MASK;
+
+    return wide.reading;
+}
+
+void RBRInstrumentCompactSample_fromSample(
+    RBRInstrumentCompactSample *compact,
+    const RBRInstrumentSample *sample)
+{
+    compact->timestamp = sample->timestamp;
+    compact->channels = sample->channels;
+    for (int32_t channel = 0; channel < sample->channels; ++channel)
+    {
+        compact->readings[channel] = compactReading(sample->readings[channel]);
+    }
+}
+
+void RBRInstrumentCompactSample_toSample(
+    RBRInstrumentSample *sample,
+    const RBRInstrumentCompactSample *compact)
+{
+    sample->timestamp = compact->timestamp;
+    sample->channels = compact->channels;
+    for (int32_t channel = 0; channel < compact->channels; ++channel)
+    {
+        sample->readings[channel] = expandReading(compact->readings[channel]);
+    }
+    memset(sample->readings + compact->channels,
+           0,
+           sizeof(double) * (RBRINSTRUMENT_CHANNEL_MAX - compact->channels));
+}
+
 RBRInstrumentError RBRInstrument_readSample(RBRInstrument *instrument)
 {
     RBRInstrumentError err;
@@ -560,3 +647,22 @@ RBRInstrumentError RBRInstrument_readSample(RBRInstrument *instrument)
 
     return err;
 }
+
+RBRInstrumentError RBRInstrument_flushSamples(RBRInstrument *instrument)
+{
+    if (instrument->callbacks.sampleBatch == NULL
+        || instrument->sampleBatchLength <= 0)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    /* Reset the batch before handing it over so that an error from the
+     * callback doesn't leave us redelivering the same samples forever. */
+    int32_t count = instrument->sampleBatchLength;
+    instrument->sampleBatchLength = 0;
+
+    return instrument->callbacks.sampleBatch(
+        instrument,
+        instrument->callbacks.sampleBatchBuffer,
+        count);
+}
@@ -17,7 +17,18 @@
 #include <stddef.h>
 
 #include "RBRParser.h"
-/* Required for RBR_TRY. */
+#if RBRPARSER_SIMD && defined(__SSE2__)
+/* Required for _mm_cvtps_pd, _mm_loadu_ps, _MM_TRANSPOSE4_PS, etc. */
+#include <emmintrin.h>
+/** \brief Whether readings are decoded in blocks of four by four. */
+#define RBRPARSER_BLOCKS 1
+#elif RBRPARSER_SIMD && defined(__ARM_NEON)
+/* Required for vld1q_u8, vtrnq_f32, vst1q_f32, etc. */
+#include <arm_neon.h>
+/** \brief Whether readings are decoded in blocks of four by four. */
+#define RBRPARSER_BLOCKS 1
+#endif
+/* Required for RBR_TRY, RBRInstrument_calculateCrc. */
 #include "RBRInstrumentInternal.h"
 
 const char *RBRInstrumentEventType_name(RBRInstrumentEventType type)
@@ -110,6 +121,14 @@ const char *RBRInstrumentEventType_name(RBRInstrumentEventType type)
     }
 }
 
+static bool RBRParser_isSelecting(const RBRParserEasyParseConfig *easyParse)
+{
+    return easyParse->selectedChannelCount > 0
+           || easyParse->startTime != 0
+           || easyParse->endTime != 0
+           || easyParse->filterReadings;
+}
+
 RBRInstrumentError RBRParser_init(RBRParser **parser,
                                   const RBRParserCallbacks *callbacks,
                                   const RBRParserConfig *config,
@@ -127,11 +146,35 @@ RBRInstrumentError RBRParser_init(RBRParser **parser,
         return RBRINSTRUMENT_UNSUPPORTED;
     }
 
-    if (config->formatConfig.easyParse.channels <= 0
-        || config->formatConfig.easyParse.channels > RBRINSTRUMENT_CHANNEL_MAX)
+    const RBRParserEasyParseConfig *easyParse =
+        &config->formatConfig.easyParse;
+    if (easyParse->channels < 0
+        || easyParse->channels > RBRINSTRUMENT_CHANNEL_MAX
+        || easyParse->postprocessingChannels < 0
+        || easyParse->postprocessingChannels
+        > RBRINSTRUMENT_POSTPROCESSING_CHANNEL_MAX
+        || (easyParse->channels == 0
+            && easyParse->postprocessingChannels == 0))
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    if (easyParse->selectedChannelCount < 0
+        || easyParse->selectedChannelCount > easyParse->channels
+        || (easyParse->filterReadings
+            && (easyParse->filterChannel < 0
+                || easyParse->filterChannel >= easyParse->channels)))
     {
         return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
     }
+    for (int32_t i = 0; i < easyParse->selectedChannelCount; ++i)
+    {
+        if (easyParse->selectedChannels[i] < 0
+            || easyParse->selectedChannels[i] >= easyParse->channels)
+        {
+            return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+        }
+    }
 
     bool allocated = false;
     if (*parser == NULL)
@@ -148,6 +191,7 @@ RBRInstrumentError RBRParser_init(RBRParser **parser,
     memcpy(&(*parser)->callbacks, callbacks, sizeof(RBRParserCallbacks));
     (*parser)->userData          = userData;
     (*parser)->managedAllocation = allocated;
+    (*parser)->selecting         = RBRParser_isSelecting(easyParse);
 
     return RBRINSTRUMENT_SUCCESS;
 }
@@ -184,6 +228,105 @@ void RBRParser_setUserData(RBRParser *parser, void *userData)
 #define EP_EVENT_TIMESTAMP_OFFSET 4
 #define EP_EVENT_PAYLOAD_OFFSET   12
 
+static void RBRParser_decodeEPEvent(const uint8_t *const data,
+                                    RBRInstrumentEvent *event)
+{
+    memset(event, 0, sizeof(RBRInstrumentEvent));
+
+    event->type = *(uint8_t *) (data + EP_EVENT_TYPE_OFFSET);
+    event->timestamp =
+        *(RBRInstrumentDateTime *) (data + EP_EVENT_TIMESTAMP_OFFSET);
+    switch (event->type)
+    {
+    case RBRINSTRUMENT_EVENT_START_OF_REGIME_BIN:
+    case RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST:
+    case RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST:
+    case RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST:
+        event->auxiliaryDataLength = 1;
+        event->auxiliaryData[0] =
+            *(uint32_t *) (data + EP_EVENT_PAYLOAD_OFFSET);
+        break;
+    default:
+        event->auxiliaryDataLength = 0;
+    }
+}
+
+#define EP_EVENT_MARKER 0xF4
+
+static RBRInstrumentError RBRParser_checkEPEvent(const uint8_t *const data)
+{
+    if (data[EP_EVENT_MARKER_OFFSET] != EP_EVENT_MARKER
+        || data[EP_EVENT_TYPE_OFFSET]
+        > RBRINSTRUMENT_EVENT_ENERGY_USED_MARKER_EXTERNAL_POWER_SOURCE)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    /* The CRC covers everything after itself, and is stored little-endian
+     * like the rest of the record. This layout is inferred, not checked
+     * against instrument data; see RBRParserEasyParseConfig.validateEvents.
+     */
+    uint16_t crc = data[EP_EVENT_CRC_OFFSET]
+                   | (data[EP_EVENT_CRC_OFFSET + 1] << 8);
+    if (RBRInstrument_calculateCrc(data + EP_EVENT_TYPE_OFFSET,
+                                   EP_EVENT_SIZE - EP_EVENT_TYPE_OFFSET)
+        != crc)
+    {
+        return RBRINSTRUMENT_CHECKSUM_ERROR;
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Validates an event if configured to, handing it to the corrupt event
+ * callback if it fails. */
+static RBRInstrumentError RBRParser_validateEPEvent(RBRParser *parser,
+                                                    const uint8_t *const data,
+                                                    bool *valid)
+{
+    *valid = true;
+    if (!parser->config.formatConfig.easyParse.validateEvents)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    RBRInstrumentError reason = RBRParser_checkEPEvent(data);
+    if (reason == RBRINSTRUMENT_SUCCESS)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    *valid = false;
+    if (parser->callbacks.corruptEvent != NULL)
+    {
+        return parser->callbacks.corruptEvent(parser,
+                                              data,
+                                              EP_EVENT_SIZE,
+                                              reason);
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Validates and decodes an event, then hands it to the event callback. */
+static RBRInstrumentError RBRParser_deliverEPEvent(RBRParser *parser,
+                                                   const uint8_t *const data,
+                                                   RBRInstrumentEvent *event)
+{
+    bool valid;
+    RBR_TRY(RBRParser_validateEPEvent(parser, data, &valid));
+    if (!valid)
+    {
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    RBRParser_decodeEPEvent(data, event);
+    if (parser->callbacks.event != NULL)
+    {
+        return parser->callbacks.event(parser, event);
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
 static RBRInstrumentError RBRParser_parseEPEvents(
     RBRParser *parser,
     const uint8_t *const data,
@@ -200,31 +343,7 @@ static RBRInstrumentError RBRParser_parseEPEvents(
 
     for (; *size + EP_EVENT_SIZE <= maxSize; *size += EP_EVENT_SIZE)
     {
-        memset(event, 0, sizeof(RBRInstrumentEvent));
-
-        event->type = *(uint8_t *) (data + *size + EP_EVENT_TYPE_OFFSET);
-        event->timestamp =
-            *(RBRInstrumentDateTime *) (data
-                                        + *size
-                                        + EP_EVENT_TIMESTAMP_OFFSET);
-        switch (event->type)
-        {
-        case RBRINSTRUMENT_EVENT_START_OF_REGIME_BIN:
-        case RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST:
-        case RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST:
-        case RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST:
-            event->auxiliaryDataLength = 1;
-            event->auxiliaryData[0] =
-                *(uint32_t *) (data + *size + EP_EVENT_PAYLOAD_OFFSET);
-            break;
-        default:
-            event->auxiliaryDataLength = 0;
-        }
-
-        if (parser->callbacks.event != NULL)
-        {
-            RBR_TRY(parser->callbacks.event(parser, event));
-        }
+        RBR_TRY(RBRParser_deliverEPEvent(parser, data + *size, event));
     }
 
     return RBRINSTRUMENT_SUCCESS;
@@ -233,37 +352,125 @@ static RBRInstrumentError RBRParser_parseEPEvents(
 #define EP_SAMPLE_TIMESTAMP_SIZE ((int32_t) sizeof(RBRInstrumentDateTime))
 #define EP_SAMPLE_READING_SIZE ((int32_t) sizeof(float))
 
+static void RBRParser_decodeEPSample(const uint8_t *const data,
+                                     int32_t channels,
+                                     RBRInstrumentSample *sample)
+{
+    sample->timestamp = *(RBRInstrumentDateTime *) data;
+    sample->channels = channels;
+    for (int32_t channel = 0; channel < channels; ++channel)
+    {
+        sample->readings[channel] =
+            *(float *) (data
+                        + EP_SAMPLE_TIMESTAMP_SIZE
+                        + channel * EP_SAMPLE_READING_SIZE);
+    }
+    /* Only the unused tail of the readings needs clearing; the rest was just
+     * overwritten. */
+    memset(sample->readings + channels,
+           0,
+           sizeof(double) * (RBRINSTRUMENT_CHANNEL_MAX - channels));
+}
+
+/* Decodes a sample subject to the configured selection. Returns false, having
+ * read no more of the sample than it had to, if the sample isn't selected. */
+static bool RBRParser_decodeSelectedEPSample(
+    const RBRParserEasyParseConfig *easyParse,
+    const uint8_t *const data,
+    RBRInstrumentSample *sample)
+{
+    RBRInstrumentDateTime timestamp = *(RBRInstrumentDateTime *) data;
+    if (timestamp < easyParse->startTime
+        || (easyParse->endTime != 0 && timestamp >= easyParse->endTime))
+    {
+        return false;
+    }
+
+    if (easyParse->filterReadings)
+    {
+        float reading = *(float *) (data
+                                    + EP_SAMPLE_TIMESTAMP_SIZE
+                                    + easyParse->filterChannel
+                                    * EP_SAMPLE_READING_SIZE);
+        /* Written so that NaN fails. */
+        if (!(reading >= easyParse->filterMinimum
+              && reading <= easyParse->filterMaximum))
+        {
+            return false;
+        }
+    }
+
+    if (easyParse->selectedChannelCount == 0)
+    {
+        RBRParser_decodeEPSample(data, easyParse->channels, sample);
+        return true;
+    }
+
+    int32_t channels = easyParse->selectedChannelCount;
+    sample->timestamp = timestamp;
+    sample->channels = channels;
+    for (int32_t i = 0; i < channels; ++i)
+    {
+        sample->readings[i] =
+            *(float *) (data
+                        + EP_SAMPLE_TIMESTAMP_SIZE
+                        + easyParse->selectedChannels[i]
+                        * EP_SAMPLE_READING_SIZE);
+    }
+    memset(sample->readings + channels,
+           0,
+           sizeof(double) * (RBRINSTRUMENT_CHANNEL_MAX - channels));
+    return true;
+}
+
+/* Post-processed bins share the sample layout; only the number of values
+ * differs. The sample selection applies only to sample data. */
 static RBRInstrumentError RBRParser_parseEPSamples(
     RBRParser *parser,
     const uint8_t *const data,
-    int32_t *size)
+    int32_t *size,
+    int32_t channels,
+    bool select)
 {
     int32_t maxSize = *size;
     *size = 0;
 
+    if (channels <= 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
     RBRInstrumentSample *sample = parser->callbacks.sampleBuffer;
     if (sample == NULL)
     {
         return RBRINSTRUMENT_SUCCESS;
     }
 
-    int32_t channels = parser->config.formatConfig.easyParse.channels;
     int32_t sampleSize = EP_SAMPLE_TIMESTAMP_SIZE
                          + EP_SAMPLE_READING_SIZE * channels;
-    for (; *size + sampleSize <= maxSize; *size += sampleSize)
+    if (select && parser->selecting)
     {
-        memset(sample, 0, sizeof(RBRInstrumentEvent));
-
-        sample->timestamp = *(RBRInstrumentDateTime *) (data + *size);
-        sample->channels = channels;
-        for (int32_t channel = 0; channel < channels; ++channel)
+        for (; *size + sampleSize <= maxSize; *size += sampleSize)
         {
-            sample->readings[channel] =
-                *(float *) (data
-                            + *size
-                            + EP_SAMPLE_TIMESTAMP_SIZE
-                            + channel * EP_SAMPLE_READING_SIZE);
+            if (!RBRParser_decodeSelectedEPSample(
+                    &parser->config.formatConfig.easyParse,
+                    data + *size,
+                    sample))
+            {
+                continue;
+            }
+
+            if (parser->callbacks.sample != NULL)
+            {
+                RBR_TRY(parser->callbacks.sample(parser, sample));
+            }
         }
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    for (; *size + sampleSize <= maxSize; *size += sampleSize)
+    {
+        RBRParser_decodeEPSample(data + *size, channels, sample);
 
         if (parser->callbacks.sample != NULL)
         {
@@ -286,9 +493,992 @@ RBRInstrumentError RBRParser_parse(RBRParser *parser,
     case RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS:
         return RBRParser_parseEPEvents(parser, d, size);
     case RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA:
-        return RBRParser_parseEPSamples(parser, d, size);
+        return RBRParser_parseEPSamples(
+            parser,
+            d,
+            size,
+            parser->config.formatConfig.easyParse.channels,
+            true);
+    case RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA:
+        return RBRParser_parseEPSamples(
+            parser,
+            d,
+            size,
+            parser->config.formatConfig.easyParse.postprocessingChannels,
+            false);
     case RBRINSTRUMENT_DATASET_EASYPARSE_DEPLOYMENT_HEADER:
     default:
         return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
     }
 }
+
+RBRInstrumentError RBRParser_getRecordSize(const RBRParser *parser,
+                                           RBRInstrumentDataset dataset,
+                                           int32_t *size)
+{
+    const RBRParserEasyParseConfig *easyParse =
+        &parser->config.formatConfig.easyParse;
+    int32_t channels;
+    switch (dataset)
+    {
+    case RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS:
+        *size = EP_EVENT_SIZE;
+        return RBRINSTRUMENT_SUCCESS;
+    case RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA:
+        channels = easyParse->channels;
+        break;
+    case RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA:
+        channels = easyParse->postprocessingChannels;
+        break;
+    case RBRINSTRUMENT_DATASET_EASYPARSE_DEPLOYMENT_HEADER:
+    default:
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    if (channels <= 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    *size = EP_SAMPLE_TIMESTAMP_SIZE + EP_SAMPLE_READING_SIZE * channels;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_parseBuffer(RBRParser *parser,
+                                         RBRInstrumentDataset dataset,
+                                         const void *const data,
+                                         int64_t *size)
+{
+    const uint8_t *d = (const uint8_t *const) data;
+    int64_t maxSize = *size;
+    *size = 0;
+
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+
+    /* The largest window RBRParser_parse() can take which ends on a record
+     * boundary. */
+    int32_t windowMax = INT32_MAX - INT32_MAX % recordSize;
+    while (maxSize - *size >= recordSize)
+    {
+        int32_t window = windowMax;
+        if (maxSize - *size < window)
+        {
+            window = (int32_t) (maxSize - *size);
+        }
+
+        int32_t parsed = window;
+        RBRInstrumentError err = RBRParser_parse(parser,
+                                                 dataset,
+                                                 d + *size,
+                                                 &parsed);
+        *size += parsed;
+        if (err != RBRINSTRUMENT_SUCCESS)
+        {
+            return err;
+        }
+        else if (parsed == 0)
+        {
+            /* No buffer for this dataset, so nothing will ever be
+             * consumed. */
+            break;
+        }
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_splitBuffer(const RBRParser *parser,
+                                         RBRInstrumentDataset dataset,
+                                         int64_t size,
+                                         int32_t chunks,
+                                         int64_t *boundaries)
+{
+    if (chunks <= 0 || size < 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+
+    /* Deal the records out as evenly as possible, with the first chunks
+     * taking one extra record each until the remainder is used up. Records
+     * are fixed-size, so this is pure arithmetic; no data is examined. */
+    int64_t records = size / recordSize;
+    int64_t share = records / chunks;
+    int64_t remainder = records % chunks;
+    for (int32_t chunk = 0; chunk <= chunks; ++chunk)
+    {
+        int64_t extra = (chunk < remainder) ? chunk : remainder;
+        boundaries[chunk] = (share * chunk + extra) * recordSize;
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_parseMerged(RBRParser *parser,
+                                         const void *const events,
+                                         int64_t *eventsSize,
+                                         const void *const samples,
+                                         int64_t *samplesSize,
+                                         bool finished)
+{
+    const uint8_t *e = (const uint8_t *const) events;
+    const uint8_t *s = (const uint8_t *const) samples;
+    int64_t eventsMax = *eventsSize;
+    int64_t samplesMax = *samplesSize;
+    *eventsSize = 0;
+    *samplesSize = 0;
+
+    RBRInstrumentEvent *event = parser->callbacks.eventBuffer;
+    RBRInstrumentSample *sample = parser->callbacks.sampleBuffer;
+    if (event == NULL || sample == NULL)
+    {
+        return RBRINSTRUMENT_MISSING_CALLBACK;
+    }
+
+    int32_t channels = parser->config.formatConfig.easyParse.channels;
+    if (channels <= 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+    int32_t sampleSize = EP_SAMPLE_TIMESTAMP_SIZE
+                         + EP_SAMPLE_READING_SIZE * channels;
+
+    while (true)
+    {
+        bool haveEvent = eventsMax - *eventsSize >= EP_EVENT_SIZE;
+        bool haveSample = samplesMax - *samplesSize >= sampleSize;
+
+        /* Until the end of both datasets, either might yet hold the earlier
+         * record, so both are needed to decide. */
+        if ((!haveEvent && !haveSample)
+            || (!finished && (!haveEvent || !haveSample)))
+        {
+            break;
+        }
+
+        RBRInstrumentDateTime eventTime = 0;
+        RBRInstrumentDateTime sampleTime = 0;
+        if (haveEvent)
+        {
+            memcpy(&eventTime,
+                   e + *eventsSize + EP_EVENT_TIMESTAMP_OFFSET,
+                   sizeof(eventTime));
+        }
+        if (haveSample)
+        {
+            memcpy(&sampleTime, s + *samplesSize, sizeof(sampleTime));
+        }
+
+        /* Events go first on a tie: they mark the start of whatever the
+         * sample belongs to (a cast, a regime, a burst). */
+        if (haveEvent && (!haveSample || eventTime <= sampleTime))
+        {
+            RBR_TRY(RBRParser_deliverEPEvent(parser,
+                                             e + *eventsSize,
+                                             event));
+            *eventsSize += EP_EVENT_SIZE;
+        }
+        else
+        {
+            bool selected = true;
+            if (parser->selecting)
+            {
+                selected = RBRParser_decodeSelectedEPSample(
+                    &parser->config.formatConfig.easyParse,
+                    s + *samplesSize,
+                    sample);
+            }
+            else
+            {
+                RBRParser_decodeEPSample(s + *samplesSize, channels, sample);
+            }
+            if (selected && parser->callbacks.sample != NULL)
+            {
+                RBR_TRY(parser->callbacks.sample(parser, sample));
+            }
+            *samplesSize += sampleSize;
+        }
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Every timestamped record starts with its timestamp except for events, which
+ * lead with a CRC, type, and marker. */
+static int32_t RBRParser_timestampOffset(RBRInstrumentDataset dataset)
+{
+    if (dataset == RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS)
+    {
+        return EP_EVENT_TIMESTAMP_OFFSET;
+    }
+    return 0;
+}
+
+static RBRInstrumentDateTime RBRParser_recordTime(const uint8_t *data,
+                                                  int64_t record,
+                                                  int32_t recordSize,
+                                                  int32_t timestampOffset)
+{
+    RBRInstrumentDateTime timestamp;
+    memcpy(&timestamp,
+           data + record * recordSize + timestampOffset,
+           sizeof(timestamp));
+    return timestamp;
+}
+
+/* Returns the first record in [first, last) whose timestamp isn't earlier
+ * than the given time, or last if there is none. */
+static int64_t RBRParser_searchTime(const uint8_t *data,
+                                    int32_t recordSize,
+                                    int32_t timestampOffset,
+                                    int64_t first,
+                                    int64_t last,
+                                    RBRInstrumentDateTime time)
+{
+    while (first < last)
+    {
+        int64_t middle = first + (last - first) / 2;
+        if (RBRParser_recordTime(data, middle, recordSize, timestampOffset)
+            < time)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+RBRInstrumentError RBRParser_findTime(const RBRParser *parser,
+                                      RBRInstrumentDataset dataset,
+                                      const void *const data,
+                                      int64_t size,
+                                      RBRInstrumentDateTime time,
+                                      int64_t *offset)
+{
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+
+    int64_t record = RBRParser_searchTime((const uint8_t *const) data,
+                                          recordSize,
+                                          RBRParser_timestampOffset(dataset),
+                                          0,
+                                          size / recordSize,
+                                          time);
+    *offset = record * recordSize;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_buildIndex(const RBRParser *parser,
+                                        RBRInstrumentDataset dataset,
+                                        const void *const data,
+                                        int64_t size,
+                                        int32_t interval,
+                                        RBRParserIndexEntry *entries,
+                                        int32_t capacity,
+                                        int32_t *length)
+{
+    const uint8_t *d = (const uint8_t *const) data;
+    *length = 0;
+
+    if (interval < 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+    int32_t timestampOffset = RBRParser_timestampOffset(dataset);
+
+    int64_t records = size / recordSize;
+    RBRInstrumentDateTime previous = 0;
+    int64_t sinceEntry = 0;
+    for (int64_t record = 0; record < records; ++record)
+    {
+        RBRInstrumentDateTime timestamp =
+            RBRParser_recordTime(d, record, recordSize, timestampOffset);
+        bool discontinuity = record == 0 || timestamp < previous;
+        if (discontinuity || (interval > 0 && sinceEntry >= interval))
+        {
+            if (*length < capacity)
+            {
+                entries[*length].offset = record * recordSize;
+                entries[*length].timestamp = timestamp;
+                entries[*length].discontinuity = discontinuity;
+            }
+            ++*length;
+            sinceEntry = 0;
+        }
+        ++sinceEntry;
+        previous = timestamp;
+    }
+
+    if (*length > capacity)
+    {
+        return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_parseTimeRange(
+    RBRParser *parser,
+    RBRInstrumentDataset dataset,
+    const void *const data,
+    int64_t size,
+    RBRInstrumentDateTime begin,
+    RBRInstrumentDateTime end,
+    const RBRParserIndexEntry *index,
+    int32_t indexLength)
+{
+    const uint8_t *d = (const uint8_t *const) data;
+
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+    int32_t timestampOffset = RBRParser_timestampOffset(dataset);
+
+    if (index == NULL)
+    {
+        indexLength = 0;
+    }
+
+    int64_t records = size / recordSize;
+    int64_t runStart = 0;
+    int32_t entry = 0;
+    do
+    {
+        /* Without an index, the whole dataset is one run. Otherwise, each run
+         * extends up to the next discontinuity. */
+        int32_t next = entry + 1;
+        while (next < indexLength && !index[next].discontinuity)
+        {
+            ++next;
+        }
+        int64_t runEnd = records;
+        if (next < indexLength && index[next].offset / recordSize < records)
+        {
+            runEnd = index[next].offset / recordSize;
+        }
+
+        /* The periodic entries within the run bracket both ends of the range
+         * before the binary search takes over. */
+        int64_t beginLow = runStart;
+        int64_t beginHigh = runEnd;
+        int64_t endLow = runStart;
+        int64_t endHigh = runEnd;
+        for (int32_t i = entry; i < next && i < indexLength; ++i)
+        {
+            int64_t record = index[i].offset / recordSize;
+            if (record < runStart || record >= runEnd)
+            {
+                continue;
+            }
+
+            if (index[i].timestamp < begin)
+            {
+                beginLow = record;
+            }
+            else if (record < beginHigh)
+            {
+                beginHigh = record;
+            }
+
+            if (index[i].timestamp < end)
+            {
+                endLow = record;
+            }
+            else if (record < endHigh)
+            {
+                endHigh = record;
+            }
+        }
+
+        int64_t first = RBRParser_searchTime(d,
+                                             recordSize,
+                                             timestampOffset,
+                                             beginLow,
+                                             beginHigh,
+                                             begin);
+        if (endLow < first)
+        {
+            endLow = first;
+        }
+        int64_t last = RBRParser_searchTime(d,
+                                            recordSize,
+                                            timestampOffset,
+                                            endLow,
+                                            endHigh,
+                                            end);
+
+        if (last > first)
+        {
+            int64_t rangeSize = (last - first) * recordSize;
+            RBR_TRY(RBRParser_parseBuffer(parser,
+                                          dataset,
+                                          d + first * recordSize,
+                                          &rangeSize));
+        }
+
+        runStart = runEnd;
+        entry = next;
+    } while (entry < indexLength && runStart < records);
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Returns the next record when every record is returned. */
+static RBRInstrumentError RBRParser_nextEach(RBRParser *parser,
+                                             RBRParserRecord *record)
+{
+    int64_t offset = parser->cursor.offset;
+    if (parser->cursor.size - offset < parser->cursor.recordSize)
+    {
+        return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+    }
+    parser->cursor.offset = offset + parser->cursor.recordSize;
+
+    record->dataset = parser->cursor.dataset;
+    if (record->dataset == RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS)
+    {
+        RBRParser_decodeEPEvent(parser->cursor.data + offset,
+                                &record->value.event);
+    }
+    else
+    {
+        RBRParser_decodeEPSample(parser->cursor.data + offset,
+                                 parser->cursor.channels,
+                                 &record->value.sample);
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+/* Returns the next record which passes event validation or sample selection,
+ * skipping any others. */
+static RBRInstrumentError RBRParser_nextSelected(RBRParser *parser,
+                                                 RBRParserRecord *record)
+{
+    record->dataset = parser->cursor.dataset;
+    bool events = record->dataset == RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS;
+    while (parser->cursor.size - parser->cursor.offset
+           >= parser->cursor.recordSize)
+    {
+        const uint8_t *data = parser->cursor.data + parser->cursor.offset;
+        parser->cursor.offset += parser->cursor.recordSize;
+
+        if (events)
+        {
+            bool valid;
+            RBR_TRY(RBRParser_validateEPEvent(parser, data, &valid));
+            if (valid)
+            {
+                RBRParser_decodeEPEvent(data, &record->value.event);
+                return RBRINSTRUMENT_SUCCESS;
+            }
+        }
+        else if (RBRParser_decodeSelectedEPSample(
+                     &parser->config.formatConfig.easyParse,
+                     data,
+                     &record->value.sample))
+        {
+            return RBRINSTRUMENT_SUCCESS;
+        }
+    }
+
+    return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+}
+
+RBRInstrumentError RBRParser_setBuffer(RBRParser *parser,
+                                       RBRInstrumentDataset dataset,
+                                       const void *const data,
+                                       int64_t size)
+{
+    int32_t recordSize;
+    RBR_TRY(RBRParser_getRecordSize(parser, dataset, &recordSize));
+
+    const RBRParserEasyParseConfig *easyParse =
+        &parser->config.formatConfig.easyParse;
+    parser->cursor.dataset = dataset;
+    parser->cursor.data = (const uint8_t *) data;
+    parser->cursor.size = size;
+    parser->cursor.offset = 0;
+    parser->cursor.recordSize = recordSize;
+    if (dataset == RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA)
+    {
+        parser->cursor.channels = easyParse->postprocessingChannels;
+    }
+    else
+    {
+        parser->cursor.channels = easyParse->channels;
+    }
+
+    /* Decide now whether any records can be skipped, so that RBRParser_next()
+     * doesn't have to ask for every record. */
+    bool skipping;
+    switch (dataset)
+    {
+    case RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS:
+        skipping = easyParse->validateEvents;
+        break;
+    case RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA:
+        skipping = parser->selecting;
+        break;
+    default:
+        skipping = false;
+    }
+    parser->cursor.next = skipping ? RBRParser_nextSelected
+                                   : RBRParser_nextEach;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_next(RBRParser *parser, RBRParserRecord *record)
+{
+    /* Until a buffer is given, there's nothing to return. */
+    if (parser->cursor.next == NULL)
+    {
+        return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+    }
+
+    return parser->cursor.next(parser, record);
+}
+
+int64_t RBRParser_getBufferOffset(const RBRParser *parser)
+{
+    return parser->cursor.offset;
+}
+
+/* The instrument channel number in an index value; e.g., “3” in “3” or in
+ * “channel 3” (the latter after an array member separator). */
+static int32_t RBRParser_channelIndex(const char *indexValue)
+{
+    const char *number = strrchr(indexValue, ' ');
+    number = (number == NULL) ? indexValue : number + 1;
+    return strtol(number, NULL, 10);
+}
+
+static RBRInstrumentError RBRParser_parseDeploymentHeaderLine(
+    char *line,
+    RBRParserDeploymentHeader *header)
+{
+    /* The id response normally comes first; until it's seen, assume Logger3
+     * array member separators. */
+    RBRInstrumentGeneration generation = RBRINSTRUMENT_LOGGER3;
+    if (header->hasId)
+    {
+        generation = RBRInstrumentId_getGeneration(&header->id);
+    }
+
+    char *command = NULL;
+    RBRInstrumentResponseParameter parameter;
+    while (true)
+    {
+        RBRInstrument_parseResponseBuffer(line,
+                                          generation,
+                                          &command,
+                                          &parameter);
+
+        if (parameter.key == NULL || parameter.value == NULL)
+        {
+            break;
+        }
+
+        if (strcmp(command, "id") == 0)
+        {
+            RBRInstrumentId *id = &header->id;
+            header->hasId = true;
+            if (strcmp(parameter.key, "model") == 0)
+            {
+                snprintf(id->model, sizeof(id->model), "%s", parameter.value);
+            }
+            else if (strcmp(parameter.key, "version") == 0)
+            {
+                snprintf(id->version,
+                         sizeof(id->version),
+                         "%s",
+                         parameter.value);
+            }
+            else if (strcmp(parameter.key, "serial") == 0)
+            {
+                id->serial = strtol(parameter.value, NULL, 10);
+            }
+            else if (strcmp(parameter.key, "fwtype") == 0)
+            {
+                id->fwtype = strtol(parameter.value, NULL, 10);
+            }
+            else if (strcmp(parameter.key, "mode") == 0)
+            {
+                snprintf(id->mode, sizeof(id->mode), "%s", parameter.value);
+            }
+        }
+        else if (strcmp(command, "channel") == 0
+                 && parameter.indexValue != NULL)
+        {
+            int32_t index = RBRParser_channelIndex(parameter.indexValue) - 1;
+            if (index < 0 || index >= RBRINSTRUMENT_CHANNEL_MAX)
+            {
+                continue;
+            }
+
+            /* Channels are enabled unless the header says otherwise. */
+            for (; header->channelCount <= index; ++header->channelCount)
+            {
+                header->channels[header->channelCount].status = true;
+            }
+
+            RBRParserDeploymentHeaderChannel *channel =
+                &header->channels[index];
+            if (strcmp(parameter.key, "status") == 0)
+            {
+                channel->status = (strcmp(parameter.value, "on") == 0);
+            }
+            else if (strcmp(parameter.key, "label") == 0)
+            {
+                snprintf(channel->label,
+                         sizeof(channel->label),
+                         "%s",
+                         parameter.value);
+            }
+            else if (strcmp(parameter.key, "userunits") == 0
+                     || strcmp(parameter.key, "units") == 0)
+            {
+                snprintf(channel->userUnits,
+                         sizeof(channel->userUnits),
+                         "%s",
+                         parameter.value);
+            }
+        }
+        else if (strcmp(command, "sampling") == 0
+                 && strcmp(parameter.key, "period") == 0)
+        {
+            header->period = strtol(parameter.value, NULL, 10);
+        }
+        /* Logger3 reports these via the deployment command; Logger2, via
+         * commands of the same name. */
+        else if (strcmp(parameter.key, "starttime") == 0)
+        {
+            RBR_TRY(RBRInstrumentDateTime_parseScheduleTime(
+                        parameter.value,
+                        &header->startTime,
+                        NULL));
+        }
+        else if (strcmp(parameter.key, "endtime") == 0)
+        {
+            RBR_TRY(RBRInstrumentDateTime_parseScheduleTime(
+                        parameter.value,
+                        &header->endTime,
+                        NULL));
+        }
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParser_parseDeploymentHeader(
+    const void *const data,
+    int32_t *size,
+    RBRParserDeploymentHeader *header)
+{
+    const char *d = (const char *const) data;
+    int32_t maxSize = *size;
+    *size = 0;
+
+    /* The response parser works in place, so each line is copied out of the
+     * caller's (constant) data first. */
+    char line[RBRINSTRUMENT_RESPONSE_BUFFER_MAX];
+    while (*size < maxSize)
+    {
+        const char *start = d + *size;
+        int32_t length = 0;
+        while (*size + length < maxSize
+               && start[length] != '\r'
+               && start[length] != '\n'
+               && start[length] != '\0')
+        {
+            ++length;
+        }
+
+        if (*size + length == maxSize)
+        {
+            /* The rest of the line is in the next chunk. */
+            break;
+        }
+        else if (length >= (int32_t) sizeof(line))
+        {
+            return RBRINSTRUMENT_BUFFER_TOO_SMALL;
+        }
+
+        /* Each half of a CR/LF pair ends a line, so the empty line between
+         * them is just skipped. */
+        if (length > 0)
+        {
+            memcpy(line, start, length);
+            line[length] = '\0';
+            RBR_TRY(RBRParser_parseDeploymentHeaderLine(line, header));
+        }
+        *size += length + 1;
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRParserDeploymentHeader_getConfig(
+    const RBRParserDeploymentHeader *header,
+    RBRParserConfig *config)
+{
+    int32_t channels = 0;
+    for (int32_t channel = 0; channel < header->channelCount; ++channel)
+    {
+        channels += header->channels[channel].status;
+    }
+
+    if (channels == 0)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    memset(config, 0, sizeof(RBRParserConfig));
+    config->format = RBRINSTRUMENT_MEMFORMAT_CALBIN00;
+    config->formatConfig.easyParse.channels = channels;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static void RBRParser_decodeEPTimestamps(const uint8_t *data,
+                                         int32_t sampleSize,
+                                         int32_t samples,
+                                         RBRParserColumns *columns)
+{
+    RBRInstrumentDateTime *timestamps = columns->timestamps;
+    int32_t start = columns->length;
+    RBRInstrumentDateTime previous = INT64_MIN;
+    if (timestamps != NULL && start > 0)
+    {
+        previous = timestamps[start - 1];
+    }
+
+    /* Accumulate the counts without branching on them so the loop stays
+     * cheap; valid data never takes a different path. */
+    int32_t invalid = 0;
+    int32_t unordered = 0;
+    for (int32_t i = 0; i < samples; ++i)
+    {
+        RBRInstrumentDateTime timestamp;
+        memcpy(&timestamp, data + i * sampleSize, EP_SAMPLE_TIMESTAMP_SIZE);
+        invalid += (timestamp < RBRINSTRUMENT_DATETIME_MIN)
+                   | (timestamp > RBRINSTRUMENT_DATETIME_MAX);
+        unordered += timestamp < previous;
+        previous = timestamp;
+        if (timestamps != NULL)
+        {
+            timestamps[start + i] = timestamp;
+        }
+    }
+
+    columns->invalidTimestamps += invalid;
+    columns->unorderedTimestamps += unordered;
+}
+
+static void RBRParser_decodeEPReadings(const uint8_t *data,
+                                       int32_t sampleSize,
+                                       int32_t channel,
+                                       int32_t from,
+                                       int32_t to,
+                                       RBRParserColumns *columns)
+{
+    const uint8_t *source = data
+                            + EP_SAMPLE_TIMESTAMP_SIZE
+                            + channel * EP_SAMPLE_READING_SIZE;
+    float *floatReadings = columns->floatReadings[channel];
+    double *readings = columns->readings[channel];
+    int32_t start = columns->length;
+
+    if (floatReadings != NULL)
+    {
+        for (int32_t i = from; i < to; ++i)
+        {
+            memcpy(&floatReadings[start + i],
+                   source + i * sampleSize,
+                   EP_SAMPLE_READING_SIZE);
+        }
+    }
+
+    if (readings != NULL)
+    {
+        for (int32_t i = from; i < to; ++i)
+        {
+            float reading;
+            memcpy(&reading, source + i * sampleSize, EP_SAMPLE_READING_SIZE);
+            readings[start + i] = reading;
+        }
+    }
+}
+
+#if RBRPARSER_BLOCKS
+/*
+ * Decode the readings of whole blocks of four samples by four channels.
+ *
+ * Each sample's four readings are loaded as one vector and the four vectors
+ * are transposed, leaving each channel's four consecutive readings in one
+ * vector which can be stored (or widened and stored) into its column in one
+ * go. Returns the number of channels so decoded; together with
+ * \a blockSamples, this tells the caller what's left for the scalar path.
+ *
+ * 32-bit ARM has no double-precision vectors, so there the transposed
+ * readings are widened one at a time.
+ */
+static int32_t RBRParser_decodeEPReadingBlocks(const uint8_t *data,
+                                               int32_t sampleSize,
+                                               int32_t channels,
+                                               int32_t blockSamples,
+                                               RBRParserColumns *columns)
+{
+    int32_t blockChannels = channels & ~3;
+    int32_t start = columns->length;
+
+    for (int32_t channel = 0; channel < blockChannels; channel += 4)
+    {
+        const uint8_t *source = data
+                                + EP_SAMPLE_TIMESTAMP_SIZE
+                                + channel * EP_SAMPLE_READING_SIZE;
+        for (int32_t i = 0; i < blockSamples; i += 4)
+        {
+#if defined(__SSE2__)
+            __m128 r[4];
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                r[j] = _mm_loadu_ps(
+                    (const float *) (source + (i + j) * sampleSize));
+            }
+            _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                float *floatReadings = columns->floatReadings[channel + j];
+                double *readings = columns->readings[channel + j];
+                if (floatReadings != NULL)
+                {
+                    _mm_storeu_ps(floatReadings + start + i, r[j]);
+                }
+                if (readings != NULL)
+                {
+                    _mm_storeu_pd(readings + start + i, _mm_cvtps_pd(r[j]));
+                    _mm_storeu_pd(readings + start + i + 2,
+                                  _mm_cvtps_pd(_mm_movehl_ps(r[j], r[j])));
+                }
+            }
+#else
+            /* Loading bytes sidesteps any alignment requirement of loading
+             * floats. */
+            float32x4_t s[4];
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                s[j] = vreinterpretq_f32_u8(
+                    vld1q_u8(source + (i + j) * sampleSize));
+            }
+            float32x4x2_t t01 = vtrnq_f32(s[0], s[1]);
+            float32x4x2_t t23 = vtrnq_f32(s[2], s[3]);
+            float32x4_t r[4] = {
+                vcombine_f32(vget_low_f32(t01.val[0]),
+                             vget_low_f32(t23.val[0])),
+                vcombine_f32(vget_low_f32(t01.val[1]),
+                             vget_low_f32(t23.val[1])),
+                vcombine_f32(vget_high_f32(t01.val[0]),
+                             vget_high_f32(t23.val[0])),
+                vcombine_f32(vget_high_f32(t01.val[1]),
+                             vget_high_f32(t23.val[1]))
+            };
+
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                float *floatReadings = columns->floatReadings[channel + j];
+                double *readings = columns->readings[channel + j];
+                if (floatReadings != NULL)
+                {
+                    vst1q_f32(floatReadings + start + i, r[j]);
+                }
+                if (readings != NULL)
+                {
+#if defined(__aarch64__)
+                    vst1q_f64(readings + start + i,
+                              vcvt_f64_f32(vget_low_f32(r[j])));
+                    vst1q_f64(readings + start + i + 2,
+                              vcvt_high_f64_f32(r[j]));
+#else
+                    float lanes[4];
+                    vst1q_f32(lanes, r[j]);
+                    for (int32_t k = 0; k < 4; ++k)
+                    {
+                        readings[start + i + k] = lanes[k];
+                    }
+#endif
+                }
+            }
+#endif
+        }
+    }
+
+    return blockChannels;
+}
+#endif
+
+RBRInstrumentError RBRParser_parseColumns(RBRParser *parser,
+                                          const void *const data,
+                                          int32_t *size,
+                                          RBRParserColumns *columns)
+{
+    int32_t maxSize = *size;
+    *size = 0;
+
+    int32_t channels = parser->config.formatConfig.easyParse.channels;
+    if (parser->config.format != RBRINSTRUMENT_MEMFORMAT_CALBIN00
+        || channels <= 0
+        || columns->length < 0
+        || columns->length > columns->capacity)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    int32_t sampleSize = EP_SAMPLE_TIMESTAMP_SIZE
+                         + EP_SAMPLE_READING_SIZE * channels;
+    int32_t samples = maxSize / sampleSize;
+    if (samples > columns->capacity - columns->length)
+    {
+        samples = columns->capacity - columns->length;
+    }
+
+    const uint8_t *d = (const uint8_t *) data;
+
+    /* Walk each column in turn rather than each sample: every pass then
+     * writes one contiguous output array. */
+    RBRParser_decodeEPTimestamps(d, sampleSize, samples, columns);
+
+    int32_t blockSamples = 0;
+    int32_t blockChannels = 0;
+#if RBRPARSER_BLOCKS
+    blockSamples = samples & ~3;
+    blockChannels = RBRParser_decodeEPReadingBlocks(d,
+                                                    sampleSize,
+                                                    channels,
+                                                    blockSamples,
+                                                    columns);
+#endif
+
+    for (int32_t channel = 0; channel < channels; ++channel)
+    {
+        int32_t from = (channel < blockChannels) ? blockSamples : 0;
+        RBRParser_decodeEPReadings(d,
+                                   sampleSize,
+                                   channel,
+                                   from,
+                                   samples,
+                                   columns);
+    }
+
+    columns->length += samples;
+    *size = samples * sampleSize;
+    return RBRINSTRUMENT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/**
+ * \file RBRSampleQueue.c
+ *
+ * \brief Library implementation.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for memcpy, memset. */
+#include <string.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+
+#include "RBRInstrument.h"
+#include "RBRInstrumentInternal.h"
+#include "RBRSampleQueue.h"
+
+/* Atomic operations on 32-bit unsigned integers. These default to the
+ * GCC/Clang builtins; see porting.md for what's required when porting to a
+ * compiler which lacks them. */
+#ifndef RBR_ATOMIC_LOAD
+#define RBR_ATOMIC_LOAD(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#endif
+#ifndef RBR_ATOMIC_STORE
+#define RBR_ATOMIC_STORE(pointer, value) \
+    __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#endif
+#ifndef RBR_ATOMIC_COMPARE_EXCHANGE
+#define RBR_ATOMIC_COMPARE_EXCHANGE(pointer, expected, desired) \
+    __atomic_compare_exchange_n((pointer), \
+                                (expected), \
+                                (desired), \
+                                false, \
+                                __ATOMIC_ACQ_REL, \
+                                __ATOMIC_ACQUIRE)
+#endif
+
+const char *RBRSampleQueueOverflowPolicy_name(
+    RBRSampleQueueOverflowPolicy policy)
+{
+    switch (policy)
+    {
+    case RBRSAMPLEQUEUE_DROP_NEWEST:
+        return "drop newest";
+    case RBRSAMPLEQUEUE_DROP_OLDEST:
+        return "drop oldest";
+    case RBRSAMPLEQUEUE_BLOCK:
+        return "block";
+    case RBRSAMPLEQUEUE_OVERFLOW_POLICY_COUNT:
+        return "overflow policy count";
+    case RBRSAMPLEQUEUE_UNKNOWN_OVERFLOW_POLICY:
+    default:
+        return "unknown overflow policy";
+    }
+}
+
+static int32_t RBRSampleQueue_stride(const RBRSampleQueueConfig *config)
+{
+    if (config->channels == 0)
+    {
+        return (int32_t) sizeof(RBRInstrumentSample);
+    }
+    else
+    {
+        return RBRINSTRUMENT_COMPACT_SAMPLE_SIZE(config->channels);
+    }
+}
+
+int32_t RBRSampleQueue_bufferSize(const RBRSampleQueueConfig *config)
+{
+    return RBRSampleQueue_stride(config) * config->capacity;
+}
+
+RBRInstrumentError RBRSampleQueue_init(RBRSampleQueue **queue,
+                                       const RBRSampleQueueConfig *config,
+                                       void *buffer,
+                                       void *userData)
+{
+    if (config->capacity <= 0
+        || (config->capacity & (config->capacity - 1)) != 0
+        || config->channels < 0
+        || config->channels > RBRINSTRUMENT_CHANNEL_MAX
+        || (int) config->overflowPolicy < 0
+        || config->overflowPolicy >= RBRSAMPLEQUEUE_OVERFLOW_POLICY_COUNT)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    bool allocated = false;
+    if (*queue == NULL)
+    {
+        allocated = true;
+        if ((*queue = malloc(sizeof(RBRSampleQueue))) == NULL)
+        {
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    bool bufferAllocated = false;
+    if (buffer == NULL)
+    {
+        bufferAllocated = true;
+        if ((buffer = malloc(RBRSampleQueue_bufferSize(config))) == NULL)
+        {
+            if (allocated)
+            {
+                free(*queue);
+            }
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    memset(*queue, 0, sizeof(RBRSampleQueue));
+    memcpy(&(*queue)->config, config, sizeof(RBRSampleQueueConfig));
+    (*queue)->buffer            = buffer;
+    (*queue)->stride            = RBRSampleQueue_stride(config);
+    (*queue)->userData          = userData;
+    (*queue)->managedAllocation = allocated;
+    (*queue)->managedBuffer     = bufferAllocated;
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRSampleQueue_destroy(RBRSampleQueue *queue)
+{
+    if (queue->managedBuffer)
+    {
+        free(queue->buffer);
+    }
+
+    if (queue->managedAllocation)
+    {
+        free(queue);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void *RBRSampleQueue_getUserData(const RBRSampleQueue *queue)
+{
+    return queue->userData;
+}
+
+static void *RBRSampleQueue_slot(const RBRSampleQueue *queue, uint32_t index)
+{
+    return queue->buffer
+           + (index & (uint32_t) (queue->config.capacity - 1)) * queue->stride;
+}
+
+RBRInstrumentError RBRSampleQueue_push(RBRSampleQueue *queue,
+                                       const RBRInstrumentSample *sample)
+{
+    uint32_t capacity = (uint32_t) queue->config.capacity;
+    uint32_t writeIndex = queue->writeIndex;
+    uint32_t readIndex = RBR_ATOMIC_LOAD(&queue->readIndex);
+
+    RBR_ATOMIC_STORE(&queue->pushed, queue->pushed + 1);
+
+    if (writeIndex - readIndex >= capacity)
+    {
+        switch (queue->config.overflowPolicy)
+        {
+        case RBRSAMPLEQUEUE_DROP_NEWEST:
+            RBR_ATOMIC_STORE(&queue->dropped, queue->dropped + 1);
+            return RBRINSTRUMENT_SUCCESS;
+        case RBRSAMPLEQUEUE_DROP_OLDEST:
+            /* If this fails, the consumer beat us to it and there's now room
+             * anyway. If it succeeds, any pop of the oldest slot which is in
+             * progress will fail its own exchange and retry. */
+            if (RBR_ATOMIC_COMPARE_EXCHANGE(&queue->readIndex,
+                                            &readIndex,
+                                            readIndex + 1))
+            {
+                RBR_ATOMIC_STORE(&queue->dropped, queue->dropped + 1);
+            }
+            break;
+        case RBRSAMPLEQUEUE_BLOCK:
+        default:
+            while (writeIndex - RBR_ATOMIC_LOAD(&queue->readIndex)
+                   >= capacity)
+            {
+                if (queue->config.wait != NULL)
+                {
+                    RBR_TRY(queue->config.wait(queue));
+                }
+            }
+            break;
+        }
+    }
+
+    void *slot = RBRSampleQueue_slot(queue, writeIndex);
+    if (queue->config.channels == 0)
+    {
+        memcpy(slot, sample, sizeof(RBRInstrumentSample));
+    }
+    else
+    {
+        RBRInstrumentCompactSample *compact = slot;
+        RBRInstrumentSample truncated;
+        const RBRInstrumentSample *source = sample;
+        if (sample->channels > queue->config.channels)
+        {
+            memcpy(&truncated, sample, sizeof(RBRInstrumentSample));
+            truncated.channels = queue->config.channels;
+            source = &truncated;
+        }
+        RBRInstrumentCompactSample_fromSample(compact, source);
+    }
+    RBR_ATOMIC_STORE(&queue->writeIndex, writeIndex + 1);
+
+    int32_t length = writeIndex + 1 - RBR_ATOMIC_LOAD(&queue->readIndex);
+    if (length > queue->highWaterMark)
+    {
+        RBR_ATOMIC_STORE(&queue->highWaterMark, length);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRSampleQueue_pop(RBRSampleQueue *queue,
+                                      RBRInstrumentSample *samples,
+                                      int32_t *count)
+{
+    int32_t maxCount = *count;
+    *count = 0;
+
+    while (*count < maxCount)
+    {
+        uint32_t readIndex = RBR_ATOMIC_LOAD(&queue->readIndex);
+        if (readIndex == RBR_ATOMIC_LOAD(&queue->writeIndex))
+        {
+            break;
+        }
+
+        void *slot = RBRSampleQueue_slot(queue, readIndex);
+        if (queue->config.channels == 0)
+        {
+            memcpy(&samples[*count], slot, sizeof(RBRInstrumentSample));
+        }
+        else
+        {
+            RBRInstrumentCompactSample_toSample(&samples[*count], slot);
+        }
+
+        /* If the producer dropped this sample while we were copying it, the
+         * copy may be torn; discard it and try again with the next one. */
+        if (RBR_ATOMIC_COMPARE_EXCHANGE(&queue->readIndex,
+                                        &readIndex,
+                                        readIndex + 1))
+        {
+            ++*count;
+        }
+    }
+
+    RBR_ATOMIC_STORE(&queue->popped, queue->popped + *count);
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void RBRSampleQueue_getStatistics(const RBRSampleQueue *queue,
+                                  RBRSampleQueueStatistics *statistics)
+{
+    uint32_t readIndex = RBR_ATOMIC_LOAD(&queue->readIndex);
+    uint32_t writeIndex = RBR_ATOMIC_LOAD(&queue->writeIndex);
+
+    statistics->pushed        = RBR_ATOMIC_LOAD(&queue->pushed);
+    statistics->popped        = RBR_ATOMIC_LOAD(&queue->popped);
+    statistics->dropped       = RBR_ATOMIC_LOAD(&queue->dropped);
+    statistics->highWaterMark = RBR_ATOMIC_LOAD(&queue->highWaterMark);
+    statistics->length        = (int32_t) (writeIndex - readIndex);
+}
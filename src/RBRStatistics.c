@@ -0,0 +1,402 @@
+/**
+ * \file RBRStatistics.c
+ *
+ * \brief Library implementation.
+ *
+ * \copyright
+ * Copyright (c) 2018 RBR Ltd.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+/* Required for INFINITY, isgreater, isless, isnan, NAN. */
+#include <math.h>
+/* Required for memcpy, memset. */
+#include <string.h>
+/* Required for free, malloc. */
+#include <stdlib.h>
+
+#include "RBRInstrument.h"
+#include "RBRInstrumentInternal.h"
+#include "RBRStatistics.h"
+
+/** \brief The number of P² markers per quantile. */
+#define MARKERS 5
+
+/**
+ * \brief P² markers for one quantile of one channel.
+ *
+ * Until there have been #MARKERS valid readings, the readings themselves are
+ * kept in RBRStatisticsMarkers.heights, in arrival order.
+ */
+typedef struct RBRStatisticsMarkers
+{
+    /** \brief The marker heights: estimates of the quantiles they track. */
+    double heights[MARKERS];
+    /** \brief The zero-based positions of the markers among the readings. */
+    double positions[MARKERS];
+    /** \brief The ideal positions of the markers. */
+    double desired[MARKERS];
+} RBRStatisticsMarkers;
+
+int32_t RBRStatistics_bufferSize(const RBRStatisticsConfig *config)
+{
+    return (int32_t) sizeof(RBRStatisticsMarkers)
+           * config->channels
+           * config->quantileCount;
+}
+
+RBRInstrumentError RBRStatistics_init(RBRStatistics **statistics,
+                                      const RBRStatisticsConfig *config,
+                                      void *buffer,
+                                      void *userData)
+{
+    if (config->channels < 1
+        || config->channels > RBRINSTRUMENT_CHANNEL_MAX
+        || config->quantileCount < 0
+        || config->quantileCount > RBRSTATISTICS_QUANTILE_MAX)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    /* The negated comparison rejects NaN quantiles, too. */
+    for (int32_t i = 0; i < config->quantileCount; i++)
+    {
+        if (!(config->quantiles[i] > 0.0 && config->quantiles[i] < 1.0))
+        {
+            return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+        }
+    }
+
+    bool allocated = false;
+    if (*statistics == NULL)
+    {
+        allocated = true;
+        if ((*statistics = malloc(sizeof(RBRStatistics))) == NULL)
+        {
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    int32_t bufferSize = RBRStatistics_bufferSize(config);
+    bool bufferAllocated = false;
+    if (buffer == NULL && bufferSize > 0)
+    {
+        bufferAllocated = true;
+        if ((buffer = malloc(bufferSize)) == NULL)
+        {
+            if (allocated)
+            {
+                free(*statistics);
+            }
+            return RBRINSTRUMENT_ALLOCATION_FAILURE;
+        }
+    }
+
+    memcpy(&(*statistics)->config, config, sizeof(RBRStatisticsConfig));
+    (*statistics)->markers           = buffer;
+    (*statistics)->userData          = userData;
+    (*statistics)->managedAllocation = allocated;
+    (*statistics)->managedBuffer     = bufferAllocated;
+    RBRStatistics_reset(*statistics);
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRStatistics_destroy(RBRStatistics *statistics)
+{
+    if (statistics->managedBuffer)
+    {
+        free(statistics->markers);
+    }
+
+    if (statistics->managedAllocation)
+    {
+        free(statistics);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+void *RBRStatistics_getUserData(const RBRStatistics *statistics)
+{
+    return statistics->userData;
+}
+
+void RBRStatistics_reset(RBRStatistics *statistics)
+{
+    for (int32_t i = 0; i < RBRINSTRUMENT_CHANNEL_MAX; i++)
+    {
+        statistics->readings[i] = 0.0;
+        statistics->counts[i]   = 0.0;
+        statistics->mins[i]     = INFINITY;
+        statistics->maxes[i]    = -INFINITY;
+        statistics->means[i]    = 0.0;
+        statistics->squares[i]  = 0.0;
+    }
+    memset(statistics->flags, 0, sizeof(statistics->flags));
+}
+
+static RBRStatisticsMarkers *RBRStatistics_markers(
+    const RBRStatistics *statistics,
+    int32_t channel,
+    int32_t quantile)
+{
+    return (RBRStatisticsMarkers *) statistics->markers
+           + channel * statistics->config.quantileCount
+           + quantile;
+}
+
+static void RBRStatistics_sort(double *values, int32_t length)
+{
+    for (int32_t i = 1; i < length; i++)
+    {
+        double value = values[i];
+        int32_t j = i;
+        for (; j > 0 && values[j - 1] > value; j--)
+        {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+}
+
+/**
+ * \brief Get the quantile \a p of some sorted values, interpolating linearly
+ * between the nearest two.
+ */
+static double RBRStatistics_interpolate(const double *sorted,
+                                        int32_t length,
+                                        double p)
+{
+    double position = p * (length - 1);
+    int32_t below = (int32_t) position;
+    if (below >= length - 1)
+    {
+        return sorted[length - 1];
+    }
+    return sorted[below]
+           + (position - below) * (sorted[below + 1] - sorted[below]);
+}
+
+/**
+ * \brief Update the P² markers of quantile \a p with a valid reading.
+ *
+ * \param [in,out] markers the markers
+ * \param [in] p the quantile
+ * \param [in] count the number of valid readings, including this one
+ * \param [in] reading the reading
+ */
+static void RBRStatistics_updateMarkers(RBRStatisticsMarkers *markers,
+                                        double p,
+                                        int64_t count,
+                                        double reading)
+{
+    double *heights = markers->heights;
+    double *positions = markers->positions;
+    double *desired = markers->desired;
+
+    if (count <= MARKERS)
+    {
+        heights[count - 1] = reading;
+        if (count == MARKERS)
+        {
+            RBRStatistics_sort(heights, MARKERS);
+            for (int32_t i = 0; i < MARKERS; i++)
+            {
+                positions[i] = i;
+            }
+            desired[0] = 0.0;
+            desired[1] = 2.0 * p;
+            desired[2] = 4.0 * p;
+            desired[3] = 2.0 + 2.0 * p;
+            desired[4] = 4.0;
+        }
+        return;
+    }
+
+    /* Find the cell the reading falls in, stretching the outer markers to
+     * take it in if need be, and move the markers above it along. */
+    int32_t cell;
+    if (reading < heights[0])
+    {
+        heights[0] = reading;
+        cell = 0;
+    }
+    else if (reading >= heights[MARKERS - 1])
+    {
+        heights[MARKERS - 1] = reading;
+        cell = MARKERS - 2;
+    }
+    else
+    {
+        cell = 0;
+        while (reading >= heights[cell + 1])
+        {
+            ++cell;
+        }
+    }
+    for (int32_t i = cell + 1; i < MARKERS; i++)
+    {
+        ++positions[i];
+    }
+
+    desired[1] += p / 2.0;
+    desired[2] += p;
+    desired[3] += (1.0 + p) / 2.0;
+    desired[4] += 1.0;
+
+    /* Nudge each inner marker which has drifted a whole position from where
+     * it ought to be, preferably along the parabola through it and its
+     * neighbours. */
+    for (int32_t i = 1; i < MARKERS - 1; i++)
+    {
+        double drift = desired[i] - positions[i];
+        if ((drift >= 1.0 && positions[i + 1] - positions[i] > 1.0)
+            || (drift <= -1.0 && positions[i - 1] - positions[i] < -1.0))
+        {
+            int32_t d = (drift > 0.0) ? 1 : -1;
+            double height = heights[i]
+                            + d / (positions[i + 1] - positions[i - 1])
+                            * ((positions[i] - positions[i - 1] + d)
+                               * (heights[i + 1] - heights[i])
+                               / (positions[i + 1] - positions[i])
+                               + (positions[i + 1] - positions[i] - d)
+                               * (heights[i] - heights[i - 1])
+                               / (positions[i] - positions[i - 1]));
+            if (!(heights[i - 1] < height && height < heights[i + 1]))
+            {
+                height = heights[i]
+                         + d * (heights[i + d] - heights[i])
+                         / (positions[i + d] - positions[i]);
+            }
+            heights[i] = height;
+            positions[i] += d;
+        }
+    }
+}
+
+RBRInstrumentError RBRStatistics_push(RBRStatistics *statistics,
+                                      const RBRInstrumentSample *sample)
+{
+    int32_t channels = sample->channels;
+    if (channels > statistics->config.channels)
+    {
+        channels = statistics->config.channels;
+    }
+
+    /* Every channel gets the same arithmetic, with invalid readings
+     * substituted by values which leave the accumulators unchanged, so that
+     * this loop has no branches to keep it from being vectorized. The
+     * comparisons are the quiet kind, which don't raise floating-point
+     * exceptions for NaN, for the same reason. */
+    for (int32_t i = 0; i < channels; i++)
+    {
+        double reading = sample->readings[i];
+        double valid = isnan(reading) ? 0.0 : 1.0;
+        double mean = statistics->means[i];
+        double value = isnan(reading) ? mean : reading;
+        double count = statistics->counts[i] + valid;
+        double delta = value - mean;
+        /* The divisor is only the count when the reading is valid, but when
+         * it isn't, the delta is 0 anyway; this just avoids dividing by 0. */
+        double updated = mean + delta / (count + 1.0 - valid);
+
+        statistics->readings[i] += 1.0;
+        statistics->counts[i]    = count;
+        statistics->means[i]     = updated;
+        statistics->squares[i]  += delta * (value - updated);
+        statistics->mins[i]      = isless(reading, statistics->mins[i])
+                                   ? reading
+                                   : statistics->mins[i];
+        statistics->maxes[i]     = isgreater(reading, statistics->maxes[i])
+                                   ? reading
+                                   : statistics->maxes[i];
+    }
+
+    for (int32_t i = 0; i < channels; i++)
+    {
+        double reading = sample->readings[i];
+        if (isnan(reading))
+        {
+            RBRInstrumentReadingFlag flag =
+                RBRInstrumentReading_getFlag(reading);
+            if (flag < RBRINSTRUMENT_READING_FLAG_COUNT)
+            {
+                ++statistics->flags[flag][i];
+            }
+            continue;
+        }
+
+        for (int32_t q = 0; q < statistics->config.quantileCount; q++)
+        {
+            RBRStatistics_updateMarkers(
+                RBRStatistics_markers(statistics, i, q),
+                statistics->config.quantiles[q],
+                (int64_t) statistics->counts[i],
+                reading);
+        }
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+RBRInstrumentError RBRStatistics_getChannel(const RBRStatistics *statistics,
+                                            int32_t channel,
+                                            RBRStatisticsChannel *summary)
+{
+    if (channel < 0 || channel >= statistics->config.channels)
+    {
+        return RBRINSTRUMENT_INVALID_PARAMETER_VALUE;
+    }
+
+    memset(summary, 0, sizeof(RBRStatisticsChannel));
+    summary->readings = (int64_t) statistics->readings[channel];
+    summary->count    = (int64_t) statistics->counts[channel];
+    summary->nans     = summary->readings - summary->count;
+    for (int32_t i = 0; i < RBRINSTRUMENT_READING_FLAG_COUNT; i++)
+    {
+        summary->flags[i] = statistics->flags[i][channel];
+    }
+
+    if (summary->count == 0)
+    {
+        summary->min      = NAN;
+        summary->max      = NAN;
+        summary->mean     = NAN;
+        summary->variance = NAN;
+        for (int32_t q = 0; q < statistics->config.quantileCount; q++)
+        {
+            summary->quantiles[q] = NAN;
+        }
+        return RBRINSTRUMENT_SUCCESS;
+    }
+
+    summary->min      = statistics->mins[channel];
+    summary->max      = statistics->maxes[channel];
+    summary->mean     = statistics->means[channel];
+    summary->variance = (summary->count > 1)
+                        ? statistics->squares[channel] / (summary->count - 1)
+                        : 0.0;
+
+    for (int32_t q = 0; q < statistics->config.quantileCount; q++)
+    {
+        const RBRStatisticsMarkers *markers =
+            RBRStatistics_markers(statistics, channel, q);
+        if (summary->count > MARKERS)
+        {
+            summary->quantiles[q] = markers->heights[2];
+            continue;
+        }
+
+        /* Until the markers are set up, the readings are all there are. */
+        double sorted[MARKERS];
+        memcpy(sorted, markers->heights, sizeof(double) * summary->count);
+        RBRStatistics_sort(sorted, summary->count);
+        summary->quantiles[q] = RBRStatistics_interpolate(
+            sorted,
+            summary->count,
+            statistics->config.quantiles[q]);
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
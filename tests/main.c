@@ -109,6 +109,11 @@ RBRInstrumentError TestIOBuffers_read(
     {
         readLength = *size;
     }
+    if (buffers->readFragmentSize > 0
+        && readLength > buffers->readFragmentSize)
+    {
+        readLength = buffers->readFragmentSize;
+    }
     /* Otherwise, provide as much as we can from the read buffer. */
     memcpy(data, buffers->readBuffer + buffers->readBufferPos, readLength);
     *size = readLength;
@@ -189,6 +194,26 @@ RBRInstrumentError TestParserBuffers_event(
     return RBRINSTRUMENT_SUCCESS;
 }
 
+RBRInstrumentError TestParserBuffers_corruptEvent(
+    const struct RBRParser *parser,
+    const void *const data,
+    int32_t size,
+    RBRInstrumentError reason)
+{
+    /* Unused. */
+    (void) data;
+    (void) size;
+
+    TestParserBuffers *buffers;
+    buffers = (TestParserBuffers *) RBRParser_getUserData(parser);
+    if (buffers->corruptEventsLength >= TESTPARSERBUFFERS_EVENTS_MAX)
+    {
+        return RBRINSTRUMENT_CALLBACK_ERROR;
+    }
+    buffers->corruptEvents[buffers->corruptEventsLength++] = reason;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
 const char *bool_name(bool value)
 {
     if (value)
@@ -271,7 +296,8 @@ int main()
         .sample = TestParserBuffers_sample,
         .sampleBuffer = &parserSample,
         .event = TestParserBuffers_event,
-        .eventBuffer = &parserEvent
+        .eventBuffer = &parserEvent,
+        .corruptEvent = TestParserBuffers_corruptEvent
     };
 
     RBRParser parserBuffer;
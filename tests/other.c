@@ -367,3 +367,287 @@ TEST_LOGGER3(info_fwlock)
 
     return true;
 }
+
+TEST_LOGGER3(statistics)
+{
+    const char response[] =
+        "2018-07-26 14:56:24.000, 10.1325" COMMAND_TERMINATOR
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR;
+    RBRInstrumentError err;
+    RBRInstrumentStatistics statistics;
+    RBRInstrumentId id;
+
+#if RBRINSTRUMENT_STATISTICS
+    err = RBRInstrument_resetStatistics(instrument);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    TestIOBuffers_init(buffers, response, 0);
+    err = RBRInstrument_getId(instrument, &id);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    err = RBRInstrument_getStatistics(instrument, &statistics);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) sizeof(response) - 1,
+                   statistics.bytesRead,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) strlen("id" COMMAND_TERMINATOR),
+                   statistics.bytesWritten,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(2, statistics.responses, "%" PRIi32);
+    TEST_ASSERT_EQ(1, statistics.skippedResponses, "%" PRIi32);
+    TEST_ASSERT_EQ(0, statistics.commandRetries, "%" PRIi32);
+    TEST_ASSERT_EQ(0, statistics.responseBufferOverflows, "%" PRIi32);
+    TEST_ASSERT_EQ(1, statistics.commandsLength, "%" PRIi32);
+    TEST_ASSERT_STR_EQ("id", statistics.commands[0].command);
+    TEST_ASSERT_EQ(1, statistics.commands[0].count, "%" PRIi32);
+
+    TestIOBuffers_init(buffers, response, 0);
+    err = RBRInstrument_getId(instrument, &id);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    RBRInstrument_getStatistics(instrument, &statistics);
+    TEST_ASSERT_EQ(1, statistics.commandsLength, "%" PRIi32);
+    TEST_ASSERT_EQ(2, statistics.commands[0].count, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 0,
+                   statistics.commands[0].totalLatency,
+                   "%" PRIi64);
+#else
+    /* Unused. */
+    (void) response;
+    (void) id;
+
+    /* Statistics are compiled out of the library. */
+    err = RBRInstrument_resetStatistics(instrument);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_UNSUPPORTED, err, RBRInstrumentError);
+    err = RBRInstrument_getStatistics(instrument, &statistics);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_UNSUPPORTED, err, RBRInstrumentError);
+#endif
+
+    return true;
+}
+
+/** \brief The maximum number of trace records kept by traceRecorder(). */
+#define TRACE_RECORDS_MAX 16
+
+/** \brief Trace records seen by traceRecorder(). */
+static RBRInstrumentTraceRecord traceRecords[TRACE_RECORDS_MAX];
+
+/** \brief The number of records in traceRecords. */
+static int32_t traceRecordsLength;
+
+static RBRInstrumentError traceRecorder(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentTraceRecord *record)
+{
+    (void) instrument;
+
+    if (traceRecordsLength < TRACE_RECORDS_MAX)
+    {
+        traceRecords[traceRecordsLength] = *record;
+        traceRecords[traceRecordsLength].data = NULL;
+        ++traceRecordsLength;
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+TEST_LOGGER3(trace)
+{
+    const char response[] =
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR;
+    const RBRInstrumentTraceType expected[] = {
+        RBRINSTRUMENT_TRACE_WRITE,
+        RBRINSTRUMENT_TRACE_SLEEP,
+        RBRINSTRUMENT_TRACE_WRITE,
+        RBRINSTRUMENT_TRACE_SLEEP,
+        RBRINSTRUMENT_TRACE_WAKE,
+        RBRINSTRUMENT_TRACE_WRITE,
+        RBRINSTRUMENT_TRACE_READ
+    };
+    const int32_t expectedLength = sizeof(expected) / sizeof(expected[0]);
+    RBRInstrumentError err;
+    RBRInstrumentId id;
+
+    traceRecordsLength = 0;
+    instrument->callbacks.trace = traceRecorder;
+    /* Forget any previous activity to force a wake. */
+    instrument->lastActivityTime = -1;
+
+    TestIOBuffers_init(buffers, response, 0);
+    err = RBRInstrument_getId(instrument, &id);
+    instrument->callbacks.trace = NULL;
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    TEST_ASSERT_EQ(expectedLength, traceRecordsLength, "%" PRIi32);
+    for (int32_t i = 0; i < expectedLength; i++)
+    {
+        TEST_ASSERT_ENUM_EQ(expected[i],
+                            traceRecords[i].type,
+                            RBRInstrumentTraceType);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS,
+                            traceRecords[i].result,
+                            RBRInstrumentError);
+    }
+    TEST_ASSERT_EQ((int32_t) strlen("id" COMMAND_TERMINATOR),
+                   traceRecords[5].size,
+                   "%" PRIi32);
+    TEST_ASSERT_EQ((int32_t) sizeof(response) - 1,
+                   traceRecords[6].size,
+                   "%" PRIi32);
+
+    return true;
+}
+
+#if RBRINSTRUMENT_STATISTICS
+/** \brief The time reported by slowTime(). */
+static RBRInstrumentDateTime slowClock;
+
+/** \brief How far slowRead() advances slowClock on each read. */
+static RBRInstrumentDateTime slowReadDelay;
+
+static RBRInstrumentError slowTime(const struct RBRInstrument *instrument,
+                                   RBRInstrumentDateTime *time)
+{
+    (void) instrument;
+
+    *time = slowClock;
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError slowRead(const struct RBRInstrument *instrument,
+                                   void *data,
+                                   int32_t *size)
+{
+    slowClock += slowReadDelay;
+    return TestIOBuffers_read(instrument, data, size);
+}
+#endif
+
+TEST_LOGGER3(statistics_timeouts)
+{
+    const char response[] =
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR;
+    const char slowResponse[] =
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR;
+    RBRInstrumentAdaptiveTimeout adaptive = {
+        .enabled = true,
+        .percentile = 90,
+        .multiplier = 4,
+        .minObservations = 2,
+        .minimum = 50
+    };
+    RBRInstrumentAdaptiveTimeout disabled = {0};
+    RBRInstrumentError err;
+    RBRInstrumentStatistics statistics;
+    RBRInstrumentId id;
+
+    RBRInstrument_setCommandTimeout(instrument, 1000);
+#if RBRINSTRUMENT_STATISTICS
+    RBRInstrument_resetStatistics(instrument);
+    err = RBRInstrument_setAdaptiveTimeout(instrument, &adaptive);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* Not enough observations yet. */
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1000,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+
+    for (int32_t i = 0; i < 2; i++)
+    {
+        TestIOBuffers_init(buffers, response, 0);
+        err = RBRInstrument_getId(instrument, &id);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+
+    RBRInstrument_getStatistics(instrument, &statistics);
+    TEST_ASSERT_EQ(2, statistics.commands[0].histogram[0], "%" PRIi32);
+
+    /* The test clock never advances, so latency is always 0 and the
+     * minimum applies. */
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 50,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1000,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument,
+                                                            "memclear"),
+                   "%" PRIi64);
+
+    /* Overrides take precedence. */
+    err = RBRInstrument_setCommandTimeoutOverride(instrument, "id", 5000);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 5000,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+    err = RBRInstrument_setCommandTimeoutOverride(instrument, "id", -1);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 50,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+
+    /* The command gets slower than its learned timeout: each half of a
+     * response takes 60ms. The first attempt times out partway through its
+     * response. The command is sent again with the general timeout, the rest
+     * of the first response is passed over, and the learned timeout grows to
+     * suit the 180ms the second response took. */
+    slowClock = 0;
+    slowReadDelay = 60;
+    instrument->callbacks.time = slowTime;
+    instrument->callbacks.read = slowRead;
+    TestIOBuffers_init(buffers, slowResponse, 0);
+    buffers->readFragmentSize = (sizeof(response) - 1) / 2;
+    err = RBRInstrument_getId(instrument, &id);
+    instrument->callbacks.time = TestIOBuffers_time;
+    instrument->callbacks.read = TestIOBuffers_read;
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_STR_EQ("id" COMMAND_TERMINATOR "id" COMMAND_TERMINATOR,
+                       buffers->writeBuffer);
+
+    RBRInstrument_getStatistics(instrument, &statistics);
+    TEST_ASSERT_EQ(1, statistics.commandRetries, "%" PRIi32);
+    TEST_ASSERT_EQ(3, statistics.commands[0].count, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 180,
+                   statistics.commands[0].maxLatency,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 720,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+
+    adaptive.percentile = 0;
+    err = RBRInstrument_setAdaptiveTimeout(instrument, &adaptive);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    /* A 0ms minimum would let sub-millisecond latency yield a 0ms timeout. */
+    adaptive.percentile = 90;
+    adaptive.minimum = 0;
+    err = RBRInstrument_setAdaptiveTimeout(instrument, &adaptive);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    RBRInstrument_setAdaptiveTimeout(instrument, &disabled);
+#else
+    /* Unused. */
+    (void) response;
+    (void) slowResponse;
+    (void) disabled;
+    (void) statistics;
+    (void) id;
+
+    /* Adaptive timeouts depend on statistics, which are compiled out. */
+    err = RBRInstrument_setAdaptiveTimeout(instrument, &adaptive);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_UNSUPPORTED, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1000,
+                   RBRInstrument_getEffectiveCommandTimeout(instrument, "id"),
+                   "%" PRIi64);
+#endif
+    RBRInstrument_setCommandTimeout(instrument, 0);
+
+    return true;
+}
@@ -120,6 +120,86 @@ TEST_PARSER(events, two_channels)
     return true;
 }
 
+TEST_PARSER_CONFIG(validated_events) = {
+    .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+    .formatConfig = {
+        .easyParse = {
+            .channels = 2,
+            .validateEvents = true
+        }
+    }
+};
+
+TEST_PARSER(validated_events, validated_events)
+{
+    /* A good event; the same event with a flipped timestamp bit; and events
+     * with a bad marker and an unknown type, both with otherwise-valid
+     * CRCs. */
+    const char data[] =
+        "\xAE\x36\x1A\xF4\x90\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\xAE\x36\x1A\xF4\x91\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\xCD\x73\x1A\xF5\x90\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\x1A\x06\x7F\xF4\x90\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00";
+    int32_t size = sizeof(data) - 1;
+
+    RBRInstrumentError err = RBRParser_parse(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS,
+        data,
+        &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(64, size, "%" PRIi32);
+    TEST_ASSERT_EQ(1, buffers->eventsLength, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541619802000LL,
+                   buffers->events[0].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, buffers->corruptEventsLength, "%" PRIi32);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_CHECKSUM_ERROR,
+                        buffers->corruptEvents[0],
+                        RBRInstrumentError);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        buffers->corruptEvents[1],
+                        RBRInstrumentError);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        buffers->corruptEvents[2],
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_PARSER(next_validated_events, validated_events)
+{
+    /* A good event either side of one with a bad CRC. */
+    const char data[] =
+        "\xAE\x36\x1A\xF4\x90\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\xAE\x36\x1A\xF4\x91\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\xAE\x36\x1A\xF4\x90\x5F\xB3\xEF\x66\x01\x00\x00\x00\x00\x00\x00";
+
+    RBRInstrumentError err = RBRParser_setBuffer(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS,
+        data,
+        sizeof(data) - 1);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    RBRParserRecord record;
+    int32_t records = 0;
+    while ((err = RBRParser_next(parser, &record)) == RBRINSTRUMENT_SUCCESS)
+    {
+        ++records;
+    }
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_BUFFER_TOO_SMALL,
+                        err,
+                        RBRInstrumentError);
+    TEST_ASSERT_EQ(2, records, "%" PRIi32);
+    TEST_ASSERT_EQ(1, buffers->corruptEventsLength, "%" PRIi32);
+    TEST_ASSERT_EQ((int64_t) 48,
+                   RBRParser_getBufferOffset(parser),
+                   "%" PRIi64);
+
+    return true;
+}
+
 TEST_PARSER(samples, two_channels)
 {
     const char data[] =
@@ -187,3 +267,744 @@ TEST_PARSER(samples, two_channels)
 
     return true;
 }
+
+TEST_PARSER(sample_buffer, two_channels)
+{
+    /* Three samples followed by the start of a fourth. */
+    const char data[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x00\x40"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\x80\x40"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\xA0\x40\x00\x00\xC0\x40"
+        "\xF0\xB4\xB7\xEF\x66\x01\x00";
+    int64_t size = sizeof(data) - 1;
+
+    RBRInstrumentError err = RBRParser_parseBuffer(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+        data,
+        &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 48, size, "%" PRIi64);
+    TEST_ASSERT_EQ(3, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620085000LL,
+                   buffers->samples[2].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(6.0, buffers->samples[2].readings[1], "%f");
+
+    size = sizeof(data) - 1;
+    err = RBRParser_parseBuffer(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_DEPLOYMENT_HEADER,
+        data,
+        &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 0, size, "%" PRIi64);
+
+    return true;
+}
+
+TEST_PARSER(split_buffer, two_channels)
+{
+    /* Unused. */
+    (void) buffers;
+
+    int32_t recordSize;
+    RBRInstrumentError err = RBRParser_getRecordSize(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+        &recordSize);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(16, recordSize, "%" PRIi32);
+
+    /* Five samples and a partial sixth. */
+    int64_t boundaries[5];
+    err = RBRParser_splitBuffer(parser,
+                                RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                                83,
+                                3,
+                                boundaries);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 0, boundaries[0], "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 32, boundaries[1], "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 64, boundaries[2], "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 80, boundaries[3], "%" PRIi64);
+
+    /* More chunks than events. */
+    err = RBRParser_splitBuffer(parser,
+                                RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS,
+                                32,
+                                4,
+                                boundaries);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 16, boundaries[1], "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 32, boundaries[2], "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 32, boundaries[4], "%" PRIi64);
+
+    err = RBRParser_splitBuffer(parser,
+                                RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                                83,
+                                0,
+                                boundaries);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_PARSER(deployment_header, two_channels)
+{
+    /* Unused. */
+    (void) parser;
+    (void) buffers;
+
+    const char data[] =
+        "id model = RBRduo3, version = 1.090, serial = 999999, fwtype = 104"
+        COMMAND_TERMINATOR
+        "channel 1 type = temp09, module = 1, status = on, "
+        "userunits = C, label = temperature_00 || "
+        "channel 2 type = pres24, module = 2, status = off, "
+        "userunits = dbar, label = pressure_00 || "
+        "channel 3 type = cond10, module = 3, status = on, "
+        "userunits = mS/cm, label = conductivity_00"
+        COMMAND_TERMINATOR
+        "sampling mode = continuous, period = 500"
+        COMMAND_TERMINATOR
+        "deployment starttime = 20181107193000, "
+        "endtime = 20991231000000, status = logging"
+        COMMAND_TERMINATOR
+        "\0\0\0";
+    RBRParserDeploymentHeader header;
+    memset(&header, 0, sizeof(header));
+
+    /* Split the header partway through the channel line. */
+    int32_t first = 100;
+    int32_t size = first;
+    RBRInstrumentError err = RBRParser_parseDeploymentHeader(data,
+                                                             &size,
+                                                             &header);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(68, size, "%" PRIi32);
+    TEST_ASSERT_STR_EQ("RBRduo3", header.id.model);
+    TEST_ASSERT_EQ(0, header.channelCount, "%" PRIi32);
+
+    int32_t parsed = size;
+    size = sizeof(data) - 1 - parsed;
+    err = RBRParser_parseDeploymentHeader(data + parsed, &size, &header);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int32_t) sizeof(data) - 1 - parsed, size, "%" PRIi32);
+
+    TEST_ASSERT_EQ(999999, header.id.serial, "%" PRIu32);
+    TEST_ASSERT_EQ(104, header.id.fwtype, "%" PRIu16);
+    TEST_ASSERT_EQ(3, header.channelCount, "%" PRIi32);
+    TEST_ASSERT(header.channels[0].status);
+    TEST_ASSERT(!header.channels[1].status);
+    TEST_ASSERT_STR_EQ("pressure_00", header.channels[1].label);
+    TEST_ASSERT_STR_EQ("mS/cm", header.channels[2].userUnits);
+    TEST_ASSERT_EQ(500, header.period, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541619000000LL,
+                   header.startTime,
+                   "%" PRIi64);
+
+    RBRParserConfig config;
+    err = RBRParserDeploymentHeader_getConfig(&header, &config);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+                        config.format,
+                        RBRInstrumentMemoryFormat);
+    TEST_ASSERT_EQ(2, config.formatConfig.easyParse.channels, "%" PRIi32);
+
+    return true;
+}
+
+TEST_PARSER(deployment_header_logger2, two_channels)
+{
+    /* Unused. */
+    (void) parser;
+    (void) buffers;
+
+    /* Early Logger2 firmware doesn't report a firmware type at all, but its
+     * array members must still be split at the Logger2 separator. */
+    const char data[] =
+        "id model = RBRduo, version = 1.440, serial = 999999, fwtype = 0"
+        COMMAND_TERMINATOR
+        "channel 1 type = temp09, module = 1, status = on, "
+        "userunits = C, label = temperature_00 | "
+        "2 type = pres24, module = 2, status = off, "
+        "userunits = dbar, label = pressure_00"
+        COMMAND_TERMINATOR;
+    RBRParserDeploymentHeader header;
+    memset(&header, 0, sizeof(header));
+
+    int32_t size = sizeof(data) - 1;
+    RBRInstrumentError err = RBRParser_parseDeploymentHeader(data,
+                                                             &size,
+                                                             &header);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT(header.hasId);
+    TEST_ASSERT_EQ(0, header.id.fwtype, "%" PRIu16);
+    TEST_ASSERT_EQ(2, header.channelCount, "%" PRIi32);
+    TEST_ASSERT_STR_EQ("temperature_00", header.channels[0].label);
+    TEST_ASSERT(!header.channels[1].status);
+    TEST_ASSERT_STR_EQ("pressure_00", header.channels[1].label);
+
+    return true;
+}
+
+/* Records the order in which parseMerged delivers records: 'e' for each
+ * event and 's' for each sample. */
+typedef struct MergeOrder
+{
+    char order[16];
+    int32_t length;
+} MergeOrder;
+
+static RBRInstrumentError mergeOrderEvent(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentEvent *const event)
+{
+    /* Unused. */
+    (void) event;
+
+    MergeOrder *merge = RBRParser_getUserData(parser);
+    merge->order[merge->length++] = 'e';
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError mergeOrderSample(
+    const struct RBRParser *parser,
+    const struct RBRInstrumentSample *const sample)
+{
+    /* Unused. */
+    (void) sample;
+
+    MergeOrder *merge = RBRParser_getUserData(parser);
+    merge->order[merge->length++] = 's';
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+TEST_PARSER(merged, two_channels)
+{
+    /* Unused. */
+    (void) parser;
+    (void) buffers;
+
+    /* Five samples, one per second. */
+    const char samples[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x00\x40"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\x80\x40"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\xA0\x40\x00\x00\xC0\x40"
+        "\xF0\xB4\xB7\xEF\x66\x01\x00\x00\x00\x00\xE0\x40\x00\x00\x00\x41"
+        "\xD8\xB8\xB7\xEF\x66\x01\x00\x00\x00\x00\x10\x41\x00\x00\x20\x41";
+    /* Events at the time of the second sample, between the fourth and fifth,
+     * and after the last. */
+    const char events[] =
+        "\x00\x00\x1A\xF4\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\x00\x00\x1A\xF4\xE4\xB6\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x00"
+        "\x00\x00\x1A\xF4\x90\xC4\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x00";
+
+    MergeOrder merge = {0};
+    RBRInstrumentSample sample;
+    RBRInstrumentEvent event;
+    RBRParserCallbacks callbacks = {
+        .sample = mergeOrderSample,
+        .sampleBuffer = &sample,
+        .event = mergeOrderEvent,
+        .eventBuffer = &event
+    };
+    RBRParser mergeParserBuffer;
+    RBRParser *mergeParser = &mergeParserBuffer;
+    RBRInstrumentError err = RBRParser_init(&mergeParser,
+                                            &callbacks,
+                                            &test_two_channels_parser_config,
+                                            &merge);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* The last event can't be delivered until it's known that no more
+     * samples are coming. */
+    int64_t eventsSize = sizeof(events) - 1;
+    int64_t samplesSize = sizeof(samples) - 1;
+    err = RBRParser_parseMerged(mergeParser,
+                                events,
+                                &eventsSize,
+                                samples,
+                                &samplesSize,
+                                false);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 32, eventsSize, "%" PRIi64);
+    TEST_ASSERT_EQ((int64_t) 80, samplesSize, "%" PRIi64);
+
+    int64_t restSize = sizeof(events) - 1 - eventsSize;
+    int64_t noSamplesSize = 0;
+    err = RBRParser_parseMerged(mergeParser,
+                                events + eventsSize,
+                                &restSize,
+                                samples,
+                                &noSamplesSize,
+                                true);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 16, restSize, "%" PRIi64);
+
+    merge.order[merge.length] = '\0';
+    TEST_ASSERT_STR_EQ("sesssese", merge.order);
+
+    RBRParser_destroy(mergeParser);
+    return true;
+}
+
+TEST_PARSER(time_range, two_channels)
+{
+    /* Samples one second apart, with the first reading numbering them, until
+     * the clock is set back two and a half seconds before the sixth. */
+    const char data[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x00\x40"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x40\x00\x00\x80\x40"
+        "\xF0\xB4\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\xC0\x40"
+        "\xD8\xB8\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x40\x00\x00\x00\x41"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\xA0\x40\x00\x00\x20\x41"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\xC0\x40\x00\x00\x40\x41";
+    const int64_t dataSize = sizeof(data) - 1;
+
+    /* Within the first run, a plain binary search suffices. */
+    int64_t offset;
+    RBRInstrumentError err = RBRParser_findTime(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+        data,
+        80,
+        1541620084500LL,
+        &offset);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 32, offset, "%" PRIi64);
+
+    err = RBRParser_findTime(parser,
+                             RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                             data,
+                             80,
+                             1541620090000LL,
+                             &offset);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 80, offset, "%" PRIi64);
+
+    RBRParserIndexEntry index[4];
+    int32_t indexLength;
+    err = RBRParser_buildIndex(parser,
+                               RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                               data,
+                               dataSize,
+                               2,
+                               index,
+                               2,
+                               &indexLength);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_BUFFER_TOO_SMALL,
+                        err,
+                        RBRInstrumentError);
+    TEST_ASSERT_EQ(4, indexLength, "%" PRIi32);
+
+    err = RBRParser_buildIndex(parser,
+                               RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                               data,
+                               dataSize,
+                               2,
+                               index,
+                               4,
+                               &indexLength);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(4, indexLength, "%" PRIi32);
+    TEST_ASSERT(index[0].discontinuity);
+    TEST_ASSERT_EQ((int64_t) 32, index[1].offset, "%" PRIi64);
+    TEST_ASSERT(!index[1].discontinuity);
+    TEST_ASSERT_EQ((int64_t) 80, index[3].offset, "%" PRIi64);
+    TEST_ASSERT(index[3].discontinuity);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620084000LL,
+                   index[3].timestamp,
+                   "%" PRIi64);
+
+    /* Both runs overlap the range. */
+    err = RBRParser_parseTimeRange(parser,
+                                   RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                                   data,
+                                   dataSize,
+                                   1541620084000LL,
+                                   1541620086000LL,
+                                   index,
+                                   indexLength);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(4, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ(1.0, buffers->samples[0].readings[0], "%f");
+    TEST_ASSERT_EQ(2.0, buffers->samples[1].readings[0], "%f");
+    TEST_ASSERT_EQ(5.0, buffers->samples[2].readings[0], "%f");
+    TEST_ASSERT_EQ(6.0, buffers->samples[3].readings[0], "%f");
+
+    /* Only the first run reaches this far. */
+    err = RBRParser_parseTimeRange(parser,
+                                   RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                                   data,
+                                   dataSize,
+                                   1541620086000LL,
+                                   1541620099000LL,
+                                   index,
+                                   indexLength);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(6, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ(3.0, buffers->samples[4].readings[0], "%f");
+    TEST_ASSERT_EQ(4.0, buffers->samples[5].readings[0], "%f");
+
+    return true;
+}
+
+TEST_PARSER(next, two_channels)
+{
+    /* Two samples and part of a third. */
+    const char samples[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x00\x40"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\x80\x40"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00";
+    const char events[] =
+        "\x00\x00\x21\xF4\xD0\x3D\xA9\xEF\x66\x01\x00\x00\x48\x00\x00\x00";
+
+    RBRParserRecord record;
+    RBRInstrumentError err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_BUFFER_TOO_SMALL,
+                        err,
+                        RBRInstrumentError);
+
+    err = RBRParser_setBuffer(parser,
+                              RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                              samples,
+                              sizeof(samples) - 1);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                        record.dataset,
+                        RBRInstrumentDataset);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620083000LL,
+                   record.value.sample.timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(2.0, record.value.sample.readings[1], "%f");
+
+    err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(3.0, record.value.sample.readings[0], "%f");
+
+    err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_BUFFER_TOO_SMALL,
+                        err,
+                        RBRInstrumentError);
+    TEST_ASSERT_EQ((int64_t) 32,
+                   RBRParser_getBufferOffset(parser),
+                   "%" PRIi64);
+
+    err = RBRParser_setBuffer(parser,
+                              RBRINSTRUMENT_DATASET_EASYPARSE_EVENTS,
+                              events,
+                              sizeof(events) - 1);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST,
+                        record.value.event.type,
+                        RBRInstrumentEventType);
+    TEST_ASSERT_EQ(72, record.value.event.auxiliaryData[0], "%" PRIu32);
+
+    /* Nothing went through the callbacks. */
+    TEST_ASSERT_EQ(0, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ(0, buffers->eventsLength, "%" PRIi32);
+
+    return true;
+}
+
+TEST_PARSER(sample_columns, two_channels)
+{
+    const char data[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x00\x40"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\x80\x40"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\xA0\x40\x00\x00\xC0\x40"
+        "\xF0\xB4\xB7\xEF\x66\x01\x00\x00\x00\x00\xE0\x40\x00\x00\x00\x41"
+        "\xD8\xB8\xB7\xEF\x66\x01\x00\x00\x00\x00\x10\x41\x00\x00\x20\x41";
+
+    RBRInstrumentDateTime timestamps[5];
+    double first[5];
+    float second[5];
+    RBRParserColumns columns = {
+        .capacity = 3,
+        .length = 0,
+        .timestamps = timestamps,
+        .readings = {first},
+        .floatReadings = {NULL, second}
+    };
+
+    /* The first chunk ends part way through the fourth sample, and there's
+     * only room for three samples anyway. */
+    int32_t size = 56;
+    RBRInstrumentError err = RBRParser_parseColumns(parser,
+                                                    data,
+                                                    &size,
+                                                    &columns);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(48, size, "%" PRIi32);
+    TEST_ASSERT_EQ(3, columns.length, "%" PRIi32);
+
+    columns.capacity = 5;
+    size = sizeof(data) - 1 - 48;
+    err = RBRParser_parseColumns(parser, data + 48, &size, &columns);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(32, size, "%" PRIi32);
+    TEST_ASSERT_EQ(5, columns.length, "%" PRIi32);
+
+    for (int32_t sample = 0; sample < columns.length; ++sample)
+    {
+        TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620083000LL
+                       + sample * 1000,
+                       timestamps[sample],
+                       "%" PRIi64);
+        TEST_ASSERT_EQ(sample * 2.0 + 1.0, first[sample], "%f");
+        TEST_ASSERT_EQ(sample * 2.0f + 2.0f, second[sample], "%f");
+    }
+
+    /* Nothing more fits. */
+    size = sizeof(data) - 1;
+    err = RBRParser_parseColumns(parser, data, &size, &columns);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(0, size, "%" PRIi32);
+    TEST_ASSERT_EQ(5, columns.length, "%" PRIi32);
+
+    return true;
+}
+
+TEST_PARSER_CONFIG(selection) = {
+    .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+    .formatConfig = {
+        .easyParse = {
+            .channels = 3,
+            .selectedChannelCount = 2,
+            .selectedChannels = {2, 0},
+            .startTime = 1541620084000LL,
+            .filterReadings = true,
+            .filterChannel = 1,
+            .filterMinimum = 0.0f,
+            .filterMaximum = 25.0f
+        }
+    }
+};
+
+TEST_PARSER(selected_samples, selection)
+{
+    /* Four samples of three channels, one per second. */
+    const char data[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+        "\x00\x00\xC8\x42"
+        "\x20\xAD\xB7\xEF\x66\x01\x00\x00\x00\x00\x80\x3F\x00\x00\x20\x41"
+        "\x00\x00\xCA\x42"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00\x00\x00\x00\x40\x00\x00\xA0\x41"
+        "\x00\x00\xCC\x42"
+        "\xF0\xB4\xB7\xEF\x66\x01\x00\x00\x00\x00\x40\x40\x00\x00\xF0\x41"
+        "\x00\x00\xCE\x42";
+    int32_t size = sizeof(data) - 1;
+
+    /* The first sample is too early, and the last fails the filter. Skipped
+     * samples are still consumed. */
+    RBRInstrumentError err = RBRParser_parse(
+        parser,
+        RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+        data,
+        &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(80, size, "%" PRIi32);
+    TEST_ASSERT_EQ(2, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620084000LL,
+                   buffers->samples[0].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(2, buffers->samples[0].channels, "%" PRIi32);
+    TEST_ASSERT_EQ(101.0, buffers->samples[0].readings[0], "%f");
+    TEST_ASSERT_EQ(1.0, buffers->samples[0].readings[1], "%f");
+    TEST_ASSERT_EQ(0.0, buffers->samples[0].readings[2], "%f");
+    TEST_ASSERT_EQ(102.0, buffers->samples[1].readings[0], "%f");
+
+    /* The cursor skips the same samples. */
+    err = RBRParser_setBuffer(parser,
+                              RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                              data,
+                              sizeof(data) - 1);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    RBRParserRecord record;
+    err = RBRParser_next(parser, &record);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(1.0, record.value.sample.readings[1], "%f");
+
+    /* Channels must exist to be selected. */
+    RBRParserConfig config = test_selection_parser_config;
+    config.formatConfig.easyParse.selectedChannels[1] = 3;
+    RBRParserCallbacks callbacks = {0};
+    RBRParser selectionParserBuffer;
+    RBRParser *selectionParser = &selectionParserBuffer;
+    err = RBRParser_init(&selectionParser, &callbacks, &config, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_PARSER_CONFIG(postprocessing) = {
+    .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+    .formatConfig = {
+        .easyParse = {
+            .postprocessingChannels = 3
+        }
+    }
+};
+
+TEST_PARSER(postprocessing_bins, postprocessing)
+{
+    /* Sample count, mean, and standard deviation for two bins. */
+    const char data[] =
+        "\x38\xA9\xB7\xEF\x66\x01\x00\x00"
+        "\x00\x00\x70\x41\x00\x00\xA4\x41\x00\x00\x00\x3F"
+        "\x08\xB1\xB7\xEF\x66\x01\x00\x00"
+        "\x00\x00\x60\x41\x00\x00\xA0\x41\x00\x00\x80\x3E";
+    int32_t size = sizeof(data) - 1;
+
+    RBRInstrumentError err = RBRParser_parse(
+        parser,
+        RBRINSTRUMENT_DATASET_POSTPROCESSING_SAMPLE_DATA,
+        data,
+        &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(40, size, "%" PRIi32);
+    TEST_ASSERT_EQ(2, buffers->samplesLength, "%" PRIi32);
+    TEST_ASSERT_EQ((RBRInstrumentDateTime) 1541620085000LL,
+                   buffers->samples[1].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, buffers->samples[1].channels, "%" PRIi32);
+    TEST_ASSERT_EQ(15.0, buffers->samples[0].readings[0], "%f");
+    TEST_ASSERT_EQ(20.5, buffers->samples[0].readings[1], "%f");
+    TEST_ASSERT_EQ(0.25, buffers->samples[1].readings[2], "%f");
+
+    /* No sample channel count was configured. */
+    size = sizeof(data) - 1;
+    err = RBRParser_parse(parser,
+                          RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                          data,
+                          &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_PARSER_CONFIG(six_channels) = {
+    .format = RBRINSTRUMENT_MEMFORMAT_CALBIN00,
+    .formatConfig = {
+        .easyParse = {
+            .channels = 6
+        }
+    }
+};
+
+/* Seven samples of six channels: enough for one whole block of four samples
+ * by four channels plus leftovers in both directions. */
+#define BLOCK_SAMPLES 7
+#define BLOCK_CHANNELS 6
+#define BLOCK_SAMPLE_SIZE (8 + 4 * BLOCK_CHANNELS)
+
+TEST_PARSER(sample_columns_blocks, six_channels)
+{
+    uint8_t data[BLOCK_SAMPLES * BLOCK_SAMPLE_SIZE];
+    RBRInstrumentDateTime expectedTimestamps[BLOCK_SAMPLES] = {
+        1541620083000LL,
+        1541620084000LL,
+        1541620085000LL,
+        /* Out of order. */
+        1541620084500LL,
+        1541620086000LL,
+        /* Out of range, and therefore also out of order. */
+        0,
+        1541620087000LL
+    };
+    for (int32_t sample = 0; sample < BLOCK_SAMPLES; ++sample)
+    {
+        uint8_t *s = data + sample * BLOCK_SAMPLE_SIZE;
+        memcpy(s, &expectedTimestamps[sample], 8);
+        for (int32_t channel = 0; channel < BLOCK_CHANNELS; ++channel)
+        {
+            float reading = sample * 10.0f + channel + 0.25f;
+            memcpy(s + 8 + channel * 4, &reading, 4);
+        }
+    }
+
+    RBRInstrumentDateTime timestamps[BLOCK_SAMPLES];
+    double readings[BLOCK_CHANNELS][BLOCK_SAMPLES];
+    float floatReadings[BLOCK_CHANNELS][BLOCK_SAMPLES];
+    RBRParserColumns columns = {
+        .capacity = BLOCK_SAMPLES,
+        .timestamps = timestamps
+    };
+    for (int32_t channel = 0; channel < BLOCK_CHANNELS; ++channel)
+    {
+        columns.readings[channel] = readings[channel];
+        columns.floatReadings[channel] = floatReadings[channel];
+    }
+
+    int32_t size = sizeof(data);
+    RBRInstrumentError err = RBRParser_parseColumns(parser,
+                                                    data,
+                                                    &size,
+                                                    &columns);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ((int32_t) sizeof(data), size, "%" PRIi32);
+    TEST_ASSERT_EQ(BLOCK_SAMPLES, columns.length, "%" PRIi32);
+    TEST_ASSERT_EQ(1, columns.invalidTimestamps, "%" PRIi32);
+    TEST_ASSERT_EQ(2, columns.unorderedTimestamps, "%" PRIi32);
+
+    /* The column parse must agree with the sample-at-a-time parse. */
+    size = sizeof(data);
+    err = RBRParser_parse(parser,
+                          RBRINSTRUMENT_DATASET_EASYPARSE_SAMPLE_DATA,
+                          data,
+                          &size);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(BLOCK_SAMPLES, buffers->samplesLength, "%" PRIi32);
+
+    for (int32_t sample = 0; sample < BLOCK_SAMPLES; ++sample)
+    {
+        TEST_ASSERT_EQ(buffers->samples[sample].timestamp,
+                       timestamps[sample],
+                       "%" PRIi64);
+        for (int32_t channel = 0; channel < BLOCK_CHANNELS; ++channel)
+        {
+            TEST_ASSERT_EQ(buffers->samples[sample].readings[channel],
+                           readings[channel][sample],
+                           "%f");
+            TEST_ASSERT_EQ((float) buffers->samples[sample].readings[channel],
+                           floatReadings[channel][sample],
+                           "%f");
+        }
+    }
+
+    /* Continuing into the same columns compares against the last timestamp
+     * already decoded. */
+    RBRInstrumentDateTime moreTimestamps[BLOCK_SAMPLES + 1];
+    memcpy(moreTimestamps, timestamps, sizeof(timestamps));
+    columns.timestamps = moreTimestamps;
+    memset(columns.readings, 0, sizeof(columns.readings));
+    memset(columns.floatReadings, 0, sizeof(columns.floatReadings));
+    columns.capacity = BLOCK_SAMPLES + 1;
+    size = BLOCK_SAMPLE_SIZE;
+    err = RBRParser_parseColumns(parser, data, &size, &columns);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(BLOCK_SAMPLES + 1, columns.length, "%" PRIi32);
+    TEST_ASSERT_EQ(expectedTimestamps[0],
+                   moreTimestamps[BLOCK_SAMPLES],
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, columns.unorderedTimestamps, "%" PRIi32);
+
+    return true;
+}
@@ -8,7 +8,13 @@
  * Licensed under the Apache License, Version 2.0.
  */
 
+#include <math.h>
 #include "tests.h"
+#include "RBRBinner.h"
+#include "RBRCastDetector.h"
+#include "RBRDownsampler.h"
+#include "RBRSampleQueue.h"
+#include "RBRStatistics.h"
 
 TEST_LOGGER2(outputformat_channelslist)
 {
@@ -362,3 +368,841 @@ TEST_LOGGER3(stream_sample_parse)
 
     return true;
 }
+
+TEST_LOGGER3(stream_sample_fragmented)
+{
+    const char response[] =
+        "2018-07-26 14:56:24.000, 10.1325, 5.4321" COMMAND_TERMINATOR
+        "id model = RBRduo3, version = 1.092, "
+        "serial = 923456, fwtype = 104" COMMAND_TERMINATOR;
+    const int32_t fragmentSizes[] = {1, 2, 3, 7, 16};
+    RBRInstrumentError err;
+    RBRInstrumentId id;
+
+    for (size_t i = 0;
+         i < sizeof(fragmentSizes) / sizeof(fragmentSizes[0]);
+         i++)
+    {
+        TestIOBuffers_init(buffers, response, 0);
+        buffers->readFragmentSize = fragmentSizes[i];
+
+        err = RBRInstrument_readSample(instrument);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+        TEST_ASSERT_EQ(2, buffers->streamSample.channels, "%" PRIi32);
+        TEST_ASSERT_EQ(5.4321, buffers->streamSample.readings[1], "%lf");
+
+        err = RBRInstrument_getId(instrument, &id);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+        TEST_ASSERT_STR_EQ("RBRduo3", id.model);
+        TEST_ASSERT_EQ(923456, id.serial, "%" PRIi32);
+    }
+
+    return true;
+}
+
+/** \brief The number of times sampleBatchCallback() has been called. */
+static int32_t sampleBatchCalls;
+/** \brief The sample counts passed to sampleBatchCallback(). */
+static int32_t sampleBatchCounts[4];
+/** \brief The first reading of each sample passed to sampleBatchCallback(). */
+static double sampleBatchReadings[8];
+/** \brief The number of populated entries in sampleBatchReadings. */
+static int32_t sampleBatchReadingsLength;
+
+static RBRInstrumentError sampleBatchCallback(
+    const struct RBRInstrument *instrument,
+    const struct RBRInstrumentSample *const samples,
+    int32_t count)
+{
+    if (sampleBatchCalls >= 4)
+    {
+        return RBRINSTRUMENT_CALLBACK_ERROR;
+    }
+    sampleBatchCounts[sampleBatchCalls++] = count;
+
+    for (int32_t i = 0; i < count && sampleBatchReadingsLength < 8; i++)
+    {
+        sampleBatchReadings[sampleBatchReadingsLength++] =
+            samples[i].readings[0];
+    }
+
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+TEST_LOGGER3(stream_sample_batch)
+{
+    RBRInstrumentError err;
+    RBRInstrumentSample batch[2];
+    RBRInstrumentCallbacks callbacks = {
+        .time = TestIOBuffers_time,
+        .sleep = TestIOBuffers_sleep,
+        .read = TestIOBuffers_read,
+        .write = TestIOBuffers_write,
+        .sampleBatch = sampleBatchCallback,
+        .sampleBatchBuffer = batch,
+        .sampleBatchSize = 2
+    };
+    RBRInstrument batchedBuffer;
+    RBRInstrument *batched = &batchedBuffer;
+
+    sampleBatchCalls = 0;
+    sampleBatchReadingsLength = 0;
+
+    TestIOBuffers_init(
+        buffers,
+        "id model = RBRduo3, version = 1.090, serial = 999999, fwtype = 104"
+        COMMAND_TERMINATOR
+        "2018-07-26 14:56:24.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:25.000, 2.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:26.000, 3.0" COMMAND_TERMINATOR,
+        0);
+    err = RBRInstrument_open(&batched, &callbacks, 0, buffers);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    err = RBRInstrument_readSample(batched);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(0, sampleBatchCalls, "%" PRIi32);
+
+    err = RBRInstrument_readSample(batched);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(1, sampleBatchCalls, "%" PRIi32);
+    TEST_ASSERT_EQ(2, sampleBatchCounts[0], "%" PRIi32);
+
+    err = RBRInstrument_readSample(batched);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(1, sampleBatchCalls, "%" PRIi32);
+
+    err = RBRInstrument_flushSamples(batched);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(2, sampleBatchCalls, "%" PRIi32);
+    TEST_ASSERT_EQ(1, sampleBatchCounts[1], "%" PRIi32);
+
+    /* Nothing left to flush. */
+    err = RBRInstrument_flushSamples(batched);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(2, sampleBatchCalls, "%" PRIi32);
+
+    TEST_ASSERT_EQ(3, sampleBatchReadingsLength, "%" PRIi32);
+    TEST_ASSERT_EQ(1.0, sampleBatchReadings[0], "%lf");
+    TEST_ASSERT_EQ(2.0, sampleBatchReadings[1], "%lf");
+    TEST_ASSERT_EQ(3.0, sampleBatchReadings[2], "%lf");
+
+    RBRInstrument_close(batched);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_sample_compact)
+{
+    RBRInstrumentError err;
+
+    TestIOBuffers_init(
+        buffers,
+        "2018-07-26 14:56:24.000, 1.5, ###, Error-004" COMMAND_TERMINATOR,
+        0);
+    err = RBRInstrument_readSample(instrument);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(3, buffers->streamSample.channels, "%" PRIi32);
+
+    uint8_t storage[RBRINSTRUMENT_COMPACT_SAMPLE_SIZE(3)];
+    RBRInstrumentCompactSample *compact =
+        (RBRInstrumentCompactSample *) storage;
+    TEST_ASSERT(sizeof(storage) < sizeof(RBRInstrumentSample) / 8);
+
+    RBRInstrumentCompactSample_fromSample(compact, &buffers->streamSample);
+    TEST_ASSERT_EQ(buffers->streamSample.timestamp,
+                   compact->timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, compact->channels, "%" PRIi32);
+    TEST_ASSERT_EQ(1.5f, compact->readings[0], "%f");
+
+    RBRInstrumentSample sample;
+    RBRInstrumentCompactSample_toSample(&sample, compact);
+    TEST_ASSERT_EQ(buffers->streamSample.timestamp,
+                   sample.timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, sample.channels, "%" PRIi32);
+    TEST_ASSERT_EQ(1.5, sample.readings[0], "%lf");
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_READING_FLAG_UNCALIBRATED,
+                        RBRInstrumentReading_getFlag(sample.readings[1]),
+                        RBRInstrumentReadingFlag);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_READING_FLAG_ERROR,
+                        RBRInstrumentReading_getFlag(sample.readings[2]),
+                        RBRInstrumentReadingFlag);
+    TEST_ASSERT_EQ(4,
+                   RBRInstrumentReading_getError(sample.readings[2]),
+                   "%" PRIu8);
+    TEST_ASSERT_EQ(0.0, sample.readings[3], "%lf");
+
+    return true;
+}
+
+TEST_LOGGER3(stream_sample_queue)
+{
+    RBRInstrumentError err;
+    RBRSampleQueueConfig config = {
+        .capacity = 2,
+        .channels = 1,
+        .overflowPolicy = RBRSAMPLEQUEUE_DROP_OLDEST
+    };
+    RBRSampleQueue *queue = NULL;
+    RBRSampleQueueStatistics statistics;
+    RBRInstrumentSample samples[4];
+    int32_t count;
+
+    err = RBRSampleQueue_init(&queue, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    TestIOBuffers_init(
+        buffers,
+        "2018-07-26 14:56:24.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:25.000, 2.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:26.000, 3.0" COMMAND_TERMINATOR,
+        0);
+    for (int32_t i = 0; i < 3; i++)
+    {
+        err = RBRInstrument_readSample(instrument);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+        err = RBRSampleQueue_push(queue, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+
+    RBRSampleQueue_getStatistics(queue, &statistics);
+    TEST_ASSERT_EQ(3, statistics.pushed, "%" PRIu32);
+    TEST_ASSERT_EQ(1, statistics.dropped, "%" PRIu32);
+    TEST_ASSERT_EQ(2, statistics.highWaterMark, "%" PRIi32);
+    TEST_ASSERT_EQ(2, statistics.length, "%" PRIi32);
+
+    count = 4;
+    err = RBRSampleQueue_pop(queue, samples, &count);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(2, count, "%" PRIi32);
+    TEST_ASSERT_EQ(2.0, samples[0].readings[0], "%lf");
+    TEST_ASSERT_EQ(3.0, samples[1].readings[0], "%lf");
+    TEST_ASSERT_EQ(1, samples[1].channels, "%" PRIi32);
+
+    count = 4;
+    err = RBRSampleQueue_pop(queue, samples, &count);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(0, count, "%" PRIi32);
+
+    RBRSampleQueue_getStatistics(queue, &statistics);
+    TEST_ASSERT_EQ(2, statistics.popped, "%" PRIu32);
+    TEST_ASSERT_EQ(0, statistics.length, "%" PRIi32);
+
+    RBRSampleQueue_destroy(queue);
+
+    /* Dropping the newest sample keeps the oldest ones. */
+    config.overflowPolicy = RBRSAMPLEQUEUE_DROP_NEWEST;
+    queue = NULL;
+    err = RBRSampleQueue_init(&queue, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    for (int32_t i = 0; i < 3; i++)
+    {
+        buffers->streamSample.readings[0] = i;
+        err = RBRSampleQueue_push(queue, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+    count = 4;
+    err = RBRSampleQueue_pop(queue, samples, &count);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(2, count, "%" PRIi32);
+    TEST_ASSERT_EQ(0.0, samples[0].readings[0], "%lf");
+    TEST_ASSERT_EQ(1.0, samples[1].readings[0], "%lf");
+    RBRSampleQueue_destroy(queue);
+
+    config.capacity = 3;
+    queue = NULL;
+    err = RBRSampleQueue_init(&queue, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_downsample_decimate)
+{
+    RBRInstrumentError err;
+    RBRDownsamplerConfig config = {
+        .method = RBRDOWNSAMPLER_DECIMATE,
+        .channels = 2,
+        .capacity = 4,
+        .bucketSize = 1
+    };
+    RBRDownsampler *downsampler = NULL;
+    const RBRDownsamplerPoint *points;
+    int32_t length;
+
+    err = RBRDownsampler_init(&downsampler, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    buffers->streamSample.channels = 2;
+    for (int32_t i = 0; i < 8; i++)
+    {
+        buffers->streamSample.timestamp = 1532617000000LL + i * 1000;
+        buffers->streamSample.readings[0] = i;
+        buffers->streamSample.readings[1] = (i == 3) ? 7.0 : NAN;
+        err = RBRDownsampler_push(downsampler, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+    RBRDownsampler_flush(downsampler);
+
+    /* Four points fill up after four samples, so the remainder are in
+     * buckets of two. */
+    points = RBRDownsampler_getPoints(downsampler, 0, &length);
+    TEST_ASSERT_EQ(4, length, "%" PRIi32);
+    TEST_ASSERT_EQ(0.0, points[0].value, "%lf");
+    TEST_ASSERT_EQ(2.0, points[1].value, "%lf");
+    TEST_ASSERT_EQ(4.0, points[2].value, "%lf");
+    TEST_ASSERT_EQ(6.0, points[3].value, "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532617006000),
+                   (int64_t) points[3].timestamp,
+                   "%" PRIi64);
+
+    /* NaN readings don't displace real ones, but buckets of nothing but NaN
+     * still have a point. */
+    points = RBRDownsampler_getPoints(downsampler, 1, &length);
+    TEST_ASSERT_EQ(4, length, "%" PRIi32);
+    TEST_ASSERT(isnan(points[0].value));
+    TEST_ASSERT_EQ(7.0, points[1].value, "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532617003000),
+                   (int64_t) points[1].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT(isnan(points[2].value));
+    TEST_ASSERT_EQ(INT64_C(1532617004000),
+                   (int64_t) points[2].timestamp,
+                   "%" PRIi64);
+
+    TEST_ASSERT(RBRDownsampler_getPoints(downsampler, 2, &length) == NULL);
+    RBRDownsampler_destroy(downsampler);
+
+    config.capacity = 6;
+    downsampler = NULL;
+    err = RBRDownsampler_init(&downsampler, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_downsample_min_max)
+{
+    RBRInstrumentError err;
+    RBRDownsamplerConfig config = {
+        .method = RBRDOWNSAMPLER_MIN_MAX,
+        .channels = 1,
+        .capacity = 4,
+        .bucketSize = 1
+    };
+    RBRDownsampler *downsampler = NULL;
+    const RBRDownsamplerPoint *points;
+    int32_t length;
+
+    err = RBRDownsampler_init(&downsampler, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    TestIOBuffers_init(
+        buffers,
+        "2018-07-26 14:56:20.000, 0.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:21.000, 5.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:22.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:23.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:24.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:25.000, -3.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:26.000, 1.0" COMMAND_TERMINATOR
+        "2018-07-26 14:56:27.000, 2.0" COMMAND_TERMINATOR,
+        0);
+    for (int32_t i = 0; i < 8; i++)
+    {
+        err = RBRInstrument_readSample(instrument);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+        err = RBRDownsampler_push(downsampler, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+    RBRDownsampler_flush(downsampler);
+
+    /* Buckets have been merged twice, but the spikes survive. */
+    points = RBRDownsampler_getPoints(downsampler, 0, &length);
+    TEST_ASSERT_EQ(4, length, "%" PRIi32);
+    TEST_ASSERT_EQ(0.0, points[0].value, "%lf");
+    TEST_ASSERT_EQ(5.0, points[1].value, "%lf");
+    TEST_ASSERT_EQ(-3.0, points[2].value, "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532616985000),
+                   (int64_t) points[2].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(2.0, points[3].value, "%lf");
+
+    RBRDownsampler_destroy(downsampler);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_downsample_lttb)
+{
+    RBRInstrumentError err;
+    RBRDownsamplerConfig config = {
+        .method = RBRDOWNSAMPLER_LTTB,
+        .channels = 1,
+        .capacity = 4,
+        .bucketSize = 2
+    };
+    RBRDownsampler *downsampler = NULL;
+    const RBRDownsamplerPoint *points;
+    int32_t length;
+    double readings[] = {0.0, 5.0, 1.0, 1.0, 1.0, -3.0, 1.0, 2.0};
+
+    err = RBRDownsampler_init(&downsampler, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    buffers->streamSample.channels = 1;
+    for (int32_t i = 0; i < 8; i++)
+    {
+        buffers->streamSample.timestamp = 1532617000000LL + i * 1000;
+        buffers->streamSample.readings[0] = readings[i];
+        err = RBRDownsampler_push(downsampler, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+
+    /* The first sample is kept as it is. After it, the buckets of
+     * {5.0, 1.0} and {1.0, 1.0} have been merged to make room, and the last
+     * bucket is held back until there's a bucket after it. */
+    points = RBRDownsampler_getPoints(downsampler, 0, &length);
+    TEST_ASSERT_EQ(2, length, "%" PRIi32);
+    RBRDownsampler_flush(downsampler);
+
+    /* The plot runs from the first sample to the last. */
+    points = RBRDownsampler_getPoints(downsampler, 0, &length);
+    TEST_ASSERT_EQ(4, length, "%" PRIi32);
+    TEST_ASSERT_EQ(0.0, points[0].value, "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532617000000),
+                   (int64_t) points[0].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(5.0, points[1].value, "%lf");
+    TEST_ASSERT_EQ(-3.0, points[2].value, "%lf");
+    TEST_ASSERT_EQ(2.0, points[3].value, "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532617007000),
+                   (int64_t) points[3].timestamp,
+                   "%" PRIi64);
+
+    /* With nothing new pushed, there's nothing more to add. */
+    RBRDownsampler_flush(downsampler);
+    points = RBRDownsampler_getPoints(downsampler, 0, &length);
+    TEST_ASSERT_EQ(4, length, "%" PRIi32);
+
+    RBRDownsampler_destroy(downsampler);
+
+    return true;
+}
+
+#define TEST_CAPTURE_MAX 8
+
+/* The bins or events handed to a binner or cast detector callback. */
+typedef struct TestCapture
+{
+    int32_t count;
+    RBRInstrumentSample samples[TEST_CAPTURE_MAX];
+    RBRInstrumentEvent events[TEST_CAPTURE_MAX];
+} TestCapture;
+
+static RBRInstrumentError TestCapture_add(TestCapture *capture,
+                                          void *records,
+                                          const void *record,
+                                          size_t size)
+{
+    if (capture->count < TEST_CAPTURE_MAX)
+    {
+        memcpy((uint8_t *) records + size * capture->count++, record, size);
+    }
+    return RBRINSTRUMENT_SUCCESS;
+}
+
+static RBRInstrumentError TestCapture_bin(
+    const struct RBRBinner *binner,
+    const struct RBRInstrumentSample *const bin)
+{
+    TestCapture *capture = RBRBinner_getUserData(binner);
+    return TestCapture_add(capture,
+                           capture->samples,
+                           bin,
+                           sizeof(RBRInstrumentSample));
+}
+
+static RBRInstrumentError TestCapture_event(
+    const struct RBRCastDetector *detector,
+    const struct RBRInstrumentEvent *const event)
+{
+    TestCapture *capture = RBRCastDetector_getUserData(detector);
+    return TestCapture_add(capture,
+                           capture->events,
+                           event,
+                           sizeof(RBRInstrumentEvent));
+}
+
+TEST_LOGGER3(stream_bin_time)
+{
+    RBRBinnerConfig config = {
+        .postprocessing = {
+            .channels = {
+                .count = 3,
+                .channels = {
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_MEAN,
+                        .label = "temperature_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_STD,
+                        .label = "temperature_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_SAMPLE_COUNT,
+                        .label = "temperature_00"
+                    }
+                }
+            },
+            .binReference = "tstamp",
+            .binFilter = RBRINSTRUMENT_POSTPROCESSING_BINFILTER_NONE,
+            .binSize = 2000.0,
+            .tstampMin = 1532617000000LL,
+            .tstampMax = RBRINSTRUMENT_DATETIME_MAX
+        },
+        .channels = 2,
+        .labels = {"temperature_00", "pressure_00"},
+        .bin = TestCapture_bin
+    };
+    double temperatures[] = {0.0, 1.0, 3.0, NAN, 5.0, 7.0};
+    TestCapture capture;
+    RBRBinner *binner = NULL;
+    RBRInstrumentError err;
+
+    memset(&capture, 0, sizeof(capture));
+    err = RBRBinner_init(&binner, &config, NULL, &capture);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* The first sample is before the minimum timestamp. */
+    buffers->streamSample.channels = 2;
+    for (int32_t i = 0; i < 6; i++)
+    {
+        buffers->streamSample.timestamp = 1532616999000LL + i * 1000;
+        buffers->streamSample.readings[0] = temperatures[i];
+        buffers->streamSample.readings[1] = 10.0;
+        err = RBRBinner_push(binner, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+
+    /* Bins are delivered once they're complete... */
+    TEST_ASSERT_EQ(2, capture.count, "%" PRIi32);
+    err = RBRBinner_flush(binner);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    /* ...or when flushed. */
+    TEST_ASSERT_EQ(3, capture.count, "%" PRIi32);
+
+    TEST_ASSERT_EQ(INT64_C(1532617000000),
+                   (int64_t) capture.samples[0].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(3, capture.samples[0].channels, "%" PRIi32);
+    TEST_ASSERT_EQ(2.0, capture.samples[0].readings[0], "%lf");
+    TEST_ASSERT(fabs(capture.samples[0].readings[1] - sqrt(2.0)) < 1e-9);
+    TEST_ASSERT_EQ(2.0, capture.samples[0].readings[2], "%lf");
+
+    /* NaN readings are left out. */
+    TEST_ASSERT_EQ(INT64_C(1532617002000),
+                   (int64_t) capture.samples[1].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(5.0, capture.samples[1].readings[0], "%lf");
+    TEST_ASSERT_EQ(0.0, capture.samples[1].readings[1], "%lf");
+    TEST_ASSERT_EQ(1.0, capture.samples[1].readings[2], "%lf");
+
+    TEST_ASSERT_EQ(7.0, capture.samples[2].readings[0], "%lf");
+
+    RBRBinner_destroy(binner);
+
+    /* Like the instrument, only depth can be filtered by direction. */
+    config.postprocessing.binFilter =
+        RBRINSTRUMENT_POSTPROCESSING_BINFILTER_ASCENTONLY;
+    binner = NULL;
+    err = RBRBinner_init(&binner, &config, NULL, &capture);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_bin_depth)
+{
+    RBRBinnerConfig config = {
+        .postprocessing = {
+            .channels = {
+                .count = 2,
+                .channels = {
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_MEAN,
+                        .label = "temperature_00"
+                    },
+                    {
+                        .function =
+                            RBRINSTRUMENT_POSTPROCESSING_AGGREGATE_SAMPLE_COUNT,
+                        .label = "pressure_00"
+                    }
+                }
+            },
+            .binReference = "pressure_00",
+            .binFilter = RBRINSTRUMENT_POSTPROCESSING_BINFILTER_DESCENTONLY,
+            .binSize = 1.0,
+            .tstampMin = RBRINSTRUMENT_DATETIME_MIN,
+            .tstampMax = RBRINSTRUMENT_DATETIME_MAX,
+            .depthMin = 0.0,
+            .depthMax = 3.0
+        },
+        .channels = 2,
+        .labels = {"temperature_00", "pressure_00"},
+        .bin = TestCapture_bin
+    };
+    double readings[][2] = {
+        {10.0, 0.5},
+        {11.0, 0.7},
+        {13.0, 0.9},
+        {12.0, 1.2},
+        {99.0, 1.1},
+        {14.0, 2.5},
+        {15.0, 3.5}
+    };
+    TestCapture capture;
+    RBRBinner *binner = NULL;
+    RBRInstrumentError err;
+
+    memset(&capture, 0, sizeof(capture));
+    TEST_ASSERT_EQ((int32_t) (3 * (2 * sizeof(int64_t) + 6 * sizeof(double))),
+                   RBRBinner_bufferSize(&config),
+                   "%" PRIi32);
+    err = RBRBinner_init(&binner, &config, NULL, &capture);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    buffers->streamSample.channels = 2;
+    for (int32_t i = 0; i < 7; i++)
+    {
+        buffers->streamSample.timestamp = 1532617000000LL + i * 1000;
+        buffers->streamSample.readings[0] = readings[i][0];
+        buffers->streamSample.readings[1] = readings[i][1];
+        err = RBRBinner_push(binner, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+    TEST_ASSERT_EQ(0, capture.count, "%" PRIi32);
+    err = RBRBinner_flush(binner);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* The first sample has no direction, the fifth is going up, and the last
+     * is too deep. */
+    TEST_ASSERT_EQ(3, capture.count, "%" PRIi32);
+    TEST_ASSERT_EQ(12.0, capture.samples[0].readings[0], "%lf");
+    TEST_ASSERT_EQ(2.0, capture.samples[0].readings[1], "%lf");
+    TEST_ASSERT_EQ(INT64_C(1532617001000),
+                   (int64_t) capture.samples[0].timestamp,
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(12.0, capture.samples[1].readings[0], "%lf");
+    TEST_ASSERT_EQ(1.0, capture.samples[1].readings[1], "%lf");
+    TEST_ASSERT_EQ(14.0, capture.samples[2].readings[0], "%lf");
+
+    /* Flushing starts over. */
+    err = RBRBinner_flush(binner);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(3, capture.count, "%" PRIi32);
+
+    RBRBinner_destroy(binner);
+
+    strcpy(config.postprocessing.binReference, "pressure_01");
+    binner = NULL;
+    err = RBRBinner_init(&binner, &config, NULL, &capture);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_castdetection)
+{
+    RBRCastDetectorConfig config = {
+        .channel = 1,
+        .castThreshold = 2.0,
+        .soakThreshold = 0.2,
+        .soakDuration = 10000,
+        .event = TestCapture_event
+    };
+    RBRInstrumentEventType expectedTypes[] = {
+        RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST,
+        RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST,
+        RBRINSTRUMENT_EVENT_BEGIN_PROFILING_UP_CAST,
+        RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST,
+        RBRINSTRUMENT_EVENT_BEGIN_PROFILING_DOWN_CAST,
+        RBRINSTRUMENT_EVENT_END_OF_PROFILING_CAST
+    };
+    int32_t expectedSeconds[] = {19, 39, 39, 59, 79, 89};
+    TestCapture capture;
+    RBRCastDetector *detector = NULL;
+    RBRInstrumentError err;
+
+    memset(&capture, 0, sizeof(capture));
+    err = RBRCastDetector_init(&detector, &config, &capture);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* Soak at the surface, descend to 20.5dbar at 1dbar/s, come straight
+     * back up, soak again, then start another descent. */
+    buffers->streamSample.channels = 2;
+    buffers->streamSample.readings[0] = 10.0;
+    for (int32_t t = 0; t < 90; t++)
+    {
+        double pressure = 0.5;
+        if (t >= 20 && t < 40)
+        {
+            pressure += t - 19;
+        }
+        else if (t >= 40 && t < 60)
+        {
+            pressure += 59 - t;
+        }
+        else if (t >= 80)
+        {
+            pressure += t - 79;
+        }
+
+        buffers->streamSample.timestamp = 1532617000000LL + t * 1000;
+        buffers->streamSample.readings[1] = pressure;
+        err = RBRCastDetector_push(detector, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+        /* NaN readings are ignored. */
+        buffers->streamSample.readings[1] = NAN;
+        err = RBRCastDetector_push(detector, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+        if (t == 30)
+        {
+            TEST_ASSERT_ENUM_EQ(RBRCASTDETECTOR_DOWN_CAST,
+                                RBRCastDetector_getState(detector),
+                                RBRCastDetectorState);
+        }
+        else if (t == 75)
+        {
+            TEST_ASSERT_ENUM_EQ(RBRCASTDETECTOR_SOAK,
+                                RBRCastDetector_getState(detector),
+                                RBRCastDetectorState);
+        }
+    }
+
+    /* The cast in progress is ended by flushing. */
+    TEST_ASSERT_EQ(5, capture.count, "%" PRIi32);
+    err = RBRCastDetector_flush(detector);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(6, capture.count, "%" PRIi32);
+
+    /* Events are timestamped at the extremes the casts turned on. */
+    for (int32_t i = 0; i < capture.count; i++)
+    {
+        TEST_ASSERT_ENUM_EQ(expectedTypes[i],
+                            capture.events[i].type,
+                            RBRInstrumentEventType);
+        TEST_ASSERT_EQ(INT64_C(1532617000000) + expectedSeconds[i] * 1000,
+                       (int64_t) capture.events[i].timestamp,
+                       "%" PRIi64);
+        TEST_ASSERT_EQ(0, capture.events[i].auxiliaryDataLength, "%" PRIi32);
+    }
+
+    RBRCastDetector_destroy(detector);
+
+    return true;
+}
+
+TEST_LOGGER3(stream_statistics)
+{
+    RBRInstrumentError err;
+    RBRStatisticsConfig config = {
+        .channels = 3,
+        .quantileCount = 2,
+        .quantiles = {0.5, 0.9}
+    };
+    RBRStatistics *statistics = NULL;
+    RBRStatisticsChannel summary;
+    double error = RBRInstrumentReading_setError(
+        RBRINSTRUMENT_READING_FLAG_ERROR,
+        3);
+
+    err = RBRStatistics_init(&statistics, &config, NULL, NULL);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+
+    /* Channel 0 has every value from 1 to 100, out of order. One in ten
+     * readings of channel 1 is missing, and one in twenty is an error. Only
+     * the first three samples have channel 2. */
+    for (int32_t i = 0; i < 100; i++)
+    {
+        buffers->streamSample.timestamp = 1532617000000LL + i * 1000;
+        buffers->streamSample.channels = (i < 3) ? 3 : 2;
+        buffers->streamSample.readings[0] = (i * 37) % 100 + 1;
+        buffers->streamSample.readings[1] = 5.0;
+        if (i % 20 == 0)
+        {
+            buffers->streamSample.readings[1] = error;
+        }
+        else if (i % 10 == 0)
+        {
+            buffers->streamSample.readings[1] = NAN;
+        }
+        buffers->streamSample.readings[2] = 3 - i;
+        err = RBRStatistics_push(statistics, &buffers->streamSample);
+        TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    }
+
+    err = RBRStatistics_getChannel(statistics, 0, &summary);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(INT64_C(100), summary.count, "%" PRIi64);
+    TEST_ASSERT_EQ(INT64_C(0), summary.nans, "%" PRIi64);
+    TEST_ASSERT_EQ(1.0, summary.min, "%lf");
+    TEST_ASSERT_EQ(100.0, summary.max, "%lf");
+    TEST_ASSERT(fabs(summary.mean - 50.5) < 1e-9);
+    TEST_ASSERT(fabs(summary.variance - 100.0 * 101.0 / 12.0) < 1e-9);
+    /* Quantiles are only estimates. */
+    TEST_ASSERT(fabs(summary.quantiles[0] - 50.5) < 3.0);
+    TEST_ASSERT(fabs(summary.quantiles[1] - 90.1) < 3.0);
+
+    err = RBRStatistics_getChannel(statistics, 1, &summary);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(INT64_C(100), summary.readings, "%" PRIi64);
+    TEST_ASSERT_EQ(INT64_C(90), summary.count, "%" PRIi64);
+    TEST_ASSERT_EQ(INT64_C(10), summary.nans, "%" PRIi64);
+    TEST_ASSERT_EQ(INT64_C(5),
+                   summary.flags[RBRINSTRUMENT_READING_FLAG_ERROR],
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(INT64_C(5),
+                   summary.flags[RBRINSTRUMENT_READING_FLAG_NONE],
+                   "%" PRIi64);
+    TEST_ASSERT_EQ(5.0, summary.mean, "%lf");
+    TEST_ASSERT_EQ(0.0, summary.variance, "%lf");
+
+    /* With few readings, quantiles are exact. */
+    err = RBRStatistics_getChannel(statistics, 2, &summary);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(INT64_C(3), summary.readings, "%" PRIi64);
+    TEST_ASSERT_EQ(2.0, summary.quantiles[0], "%lf");
+    TEST_ASSERT(fabs(summary.quantiles[1] - 2.8) < 1e-9);
+
+    err = RBRStatistics_getChannel(statistics, 3, &summary);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_INVALID_PARAMETER_VALUE,
+                        err,
+                        RBRInstrumentError);
+
+    RBRStatistics_reset(statistics);
+    err = RBRStatistics_getChannel(statistics, 0, &summary);
+    TEST_ASSERT_ENUM_EQ(RBRINSTRUMENT_SUCCESS, err, RBRInstrumentError);
+    TEST_ASSERT_EQ(INT64_C(0), summary.readings, "%" PRIi64);
+    TEST_ASSERT(isnan(summary.mean));
+
+    RBRStatistics_destroy(statistics);
+
+    return true;
+}
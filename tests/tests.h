@@ -186,6 +186,14 @@ typedef struct TestIOBuffers
     int32_t readBufferSize;
     /** \brief How far into the read buffer the instrument has read. */
     int32_t readBufferPos;
+    /**
+     * \brief The most data to return from any one read.
+     *
+     * Reset to 0, meaning no limit, by TestIOBuffers_init(). Tests can set it
+     * afterwards to check that parsing doesn't depend on how instrument data
+     * is split across reads.
+     */
+    int32_t readFragmentSize;
     /** \brief The instrument under test will write back into this buffer. */
     char writeBuffer[TESTIOBUFFERS_WRITE_BUFFER_SIZE];
     /** \brief How far into the write buffer the instrument has written. */
@@ -208,6 +216,48 @@ void TestIOBuffers_init(TestIOBuffers *buffers,
                         const char *readBuffer,
                         int32_t readBufferSize);
 
+/**
+ * \brief Test instrument time callback.
+ *
+ * Always reports a time of 0.
+ *
+ * Exposed so that tests can open their own instrument connections with
+ * nonstandard callbacks. The instrument user data must be a TestIOBuffers.
+ *
+ * \see RBRInstrumentTimeCallback()
+ */
+RBRInstrumentError TestIOBuffers_time(const struct RBRInstrument *instrument,
+                                      RBRInstrumentDateTime *time);
+
+/**
+ * \brief Test instrument sleep callback. A no-op.
+ *
+ * \see TestIOBuffers_time()
+ * \see RBRInstrumentSleepCallback()
+ */
+RBRInstrumentError TestIOBuffers_sleep(const struct RBRInstrument *instrument,
+                                       RBRInstrumentDateTime time);
+
+/**
+ * \brief Test instrument read callback. Reads from TestIOBuffers.readBuffer.
+ *
+ * \see TestIOBuffers_time()
+ * \see RBRInstrumentReadCallback()
+ */
+RBRInstrumentError TestIOBuffers_read(const struct RBRInstrument *instrument,
+                                      void *data,
+                                      int32_t *size);
+
+/**
+ * \brief Test instrument write callback. Writes to TestIOBuffers.writeBuffer.
+ *
+ * \see TestIOBuffers_time()
+ * \see RBRInstrumentWriteCallback()
+ */
+RBRInstrumentError TestIOBuffers_write(const struct RBRInstrument *instrument,
+                                       const void *const data,
+                                       int32_t size);
+
 /**
  * \brief Get a string name for a boolean value.
  *
@@ -307,6 +357,10 @@ typedef struct TestParserBuffers
     int32_t eventsLength;
     /** \brief Parsed events. */
     RBRInstrumentEvent events[TESTPARSERBUFFERS_EVENTS_MAX];
+    /** \brief The length of TestParserBuffers.corruptEvents. */
+    int32_t corruptEventsLength;
+    /** \brief The reasons given for corrupt events. */
+    RBRInstrumentError corruptEvents[TESTPARSERBUFFERS_EVENTS_MAX];
 } TestParserBuffers;
 
 /**